@@ -7,6 +7,22 @@ Console::Console(QWidget *parent) : QDialog(parent), ui(new Ui::Console)
 
     ui->output->setStyleSheet("font: 9pt \"Consolas\";");
 
+    printBanner();
+
+    connect(this, SIGNAL(rejected()), parent, SLOT(consoleToggle()));
+
+    _flushTimer = new QTimer(this);
+    connect(_flushTimer, SIGNAL(timeout()), this, SLOT(flushEvent()));
+    _flushTimer->start(50);
+}
+
+Console::~Console()
+{
+    delete ui;
+}
+
+void Console::printBanner()
+{
     ui->output->append("========================================");
     ui->output->append("== LuaFrontend v1.10S - Powered by QT ==");
     ui->output->append("======= Copyright 2021 - TopazTK =======");
@@ -14,16 +30,65 @@ Console::Console(QWidget *parent) : QDialog(parent), ui(new Ui::Console)
     ui->output->append("==== Compatible with LuaEngine v5.0 ====");
     ui->output->append("========================================");
     ui->output->append("");
-
-    connect(this, SIGNAL(rejected()), parent, SLOT(consoleToggle()));
 }
 
-Console::~Console()
+void Console::clearMessages()
 {
-    delete ui;
+    // Start over, as if the console was just made. Anything
+    // still waiting to be shown goes away with the rest.
+
+    pair<QString, int> _message;
+
+    while (_messageQueue.Pop(_message))
+        continue;
+
+    ui->output->clear();
+    printBanner();
 }
 
 void Console::printMessage(QString inputTxt, int type)
+{
+    // Not on the GUI thread? Leave it for the flush timer.
+    // If the queue is full, the message is dropped rather than wait.
+
+    if (QThread::currentThread() != thread())
+    {
+        _messageQueue.Push({ inputTxt, type });
+        return;
+    }
+
+    // Keep the order, anything queued before this goes first.
+
+    flushEvent();
+    appendMessage(inputTxt, type);
+}
+
+void Console::writeMessage(const string& inputTxt, int type)
+{
+    printMessage(QString::fromStdString(inputTxt), type);
+}
+
+void Console::flushEvent()
+{
+    pair<QString, int> _message;
+
+    auto _traced = TimelineTrace::Enabled.load();
+    auto _start = _traced ? TimelineTrace::Now() : 0;
+    uint64_t _count = 0;
+
+    while (_messageQueue.Pop(_message))
+    {
+        appendMessage(_message.first, _message.second);
+        _count++;
+    }
+
+    // Only the flushes which had anything to flush make the timeline.
+
+    if (_count != 0 && _traced)
+        TimelineTrace::Record("Flush", "console", _start, TimelineTrace::Now() - _start, _count, "messages");
+}
+
+void Console::appendMessage(QString inputTxt, int type)
 {
     QString _colors[] = { "CADETBLUE", "GREEN", "ORANGE", "RED" };
     QString _titles[] = { "MESSAGE", "SUCCESS", "WARNING", "ERROR" };
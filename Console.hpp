@@ -1,22 +1,42 @@
 #ifndef CONSOLE_H
 #define CONSOLE_H
 
+#include <QTimer>
+#include <QThread>
 #include <QDialog>
 
+#include <RingQueue.hpp>
+#include <MessageSink.hpp>
+#include <TimelineTrace.hpp>
+
 namespace Ui { class Console; }
 
-class Console : public QDialog
+class Console : public QDialog, public MessageSink
 {
     Q_OBJECT
 
     public:
         void printMessage(QString, int type = 0);
+        void writeMessage(const string&, int type = 0) override;
+        void clearMessages();
 
         explicit Console(QWidget *parent = nullptr);
         ~Console();
 
     private:
         Ui::Console *ui;
+
+        // Messages from other threads wait here until the GUI thread
+        // picks them up, since only it may touch the widgets.
+
+        RingQueue<pair<QString, int>, 4096> _messageQueue;
+        QTimer* _flushTimer;
+
+        void appendMessage(QString, int);
+        void printBanner();
+
+    private slots:
+        void flushEvent();
 };
 
 #endif // CONSOLE_H
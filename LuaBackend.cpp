@@ -2,205 +2,1215 @@
 
 LuaBackend::LuaBackend() { }
 
-LuaBackend::LuaBackend(const char* ScrPath, uint64_t BaseInput, Console* TargetConsole)
+LuaBackend::LuaBackend(const char* ScrPath, uint64_t BaseInput, MessageSink* TargetConsole, size_t MemoryLimit, bool SharedMode)
 {
-    frameLimit = 1000 / 60;
+    frameLimit = 1000.0F / 60;
+    memoryLimit = MemoryLimit;
 	loadedScripts = vector<LuaScript*>();
     scrPath = ScrPath;
+    baseAddress = BaseInput;
+
+    sharedMode = SharedMode;
+    sharedBaseline = 0;
+
+    framePacer.pacePolicy = PacePolicy;
+    framePacer.catchUpLimit = CatchUpLimit;
+    idleWatch.MaxFactor = IdleMaxFactor;
+
+    _startTime = LuaClock::now();
 
     _outputConsole = TargetConsole;
 
 	LoadScripts(ScrPath, BaseInput);
 }
 
+LuaBackend::~LuaBackend()
+{
+    // The workers must be done with the scripts before they go away.
+
+    _workerPool.reset();
+
+    ReleaseScripts(_scriptStore);
+
+    while (!_retiredStore.empty())
+        ReleaseRetired();
+}
+
+void LuaBackend::ReleaseScripts(vector<unique_ptr<LuaScript>>& InputStore)
+{
+    // What a script file returned sits on the VM's stack, and comes off of it
+    // when the script goes away. In shared mode, every script's result is on
+    // the same stack, so they have to go in the opposite order they came in.
+
+    while (!InputStore.empty())
+        InputStore.pop_back();
+}
+
+shared_ptr<LuaBackend::LuaVM> LuaBackend::CreateVM(const char* ScrPath, uint64_t BaseInput)
+{
+    auto _luaVM = make_shared<LuaVM>(memoryLimit);
+    auto& _state = _luaVM->luaState;
+
+    _state.open_libraries
+    (
+        lib::base,
+        lib::package,
+        lib::coroutine,
+        lib::string,
+        lib::os,
+        lib::math,
+        lib::table,
+        lib::io,
+        lib::bit32,
+        lib::utf8
+    );
+
+    _state.set_exception_handler(&ExceptionHandle);
+
+    SetFunctions(&_state);
+
+    string _luaPath = ScrPath;
+    _luaPath.append("\\io_packages\\?.lua");
+
+    string _dllPath = ScrPath;
+    _dllPath.append("\\io_packages\\?.dll");
+
+    _state["package"]["path"] = _luaPath;
+    _state["package"]["cpath"] = _dllPath;
+
+    string _loadPath = ScrPath;
+    _loadPath.append("\\io_load");
+
+    _state["LOAD_PATH"] = _loadPath;
+    _state["SCRIPT_PATH"] = ScrPath;
+    _state["CHEATS_PATH"] = "NOT_AVAILABLE";
+
+    string _pathFull = MemoryLib::PName;
+    auto _pathExe = _pathFull.substr(_pathFull.find_last_of("\\") + 1);
+
+    _state["ENGINE_VERSION"] = 5;
+    _state["ENGINE_TYPE"] = "BACKEND";
+    _state["GAME_ID"] = CRC::Calculate(_pathExe.c_str(), _pathExe.length(), CRC::CRC_32());
+    _state["BASE_ADDR"] = BaseInput;
+
+    // The garbage collector is only ever ran by CollectGarbage from now on,
+    // in the idle time between frames.
+
+    lua_gc(_state.lua_state(), LUA_GCSTOP);
+
+    return _luaVM;
+}
+
+sol::table LuaBackend::SharedView(LuaState& InputState)
+{
+    // Only the tables themselves are guarded, not the tables within them,
+    // nor the string metatable. Enough to keep a script from breaking
+    // the others by accident, not to keep one out on purpose.
+
+    auto _readOnly = [](lua_State* L) -> int
+    {
+        return luaL_error(L, "The libraries are shared between scripts in Shared VM mode, and can't be changed.");
+    };
+
+    auto _pairs = [](lua_State* L) -> int
+    {
+        lua_getglobal(L, "next");
+        luaL_getmetafield(L, 1, "__index");
+        lua_pushnil(L);
+
+        return 3;
+    };
+
+    auto _globals = InputState.globals();
+    auto _view = InputState.create_table();
+
+    for (auto& _entry : _globals)
+    {
+        if (_entry.second.get_type() != sol::type::table || _entry.second == _globals)
+            continue;
+
+        auto _proxy = InputState.create_table();
+
+        _proxy[sol::metatable_key] = InputState.create_table_with(
+            "__index", _entry.second,
+            "__newindex", (lua_CFunction)_readOnly,
+            "__pairs", (lua_CFunction)_pairs,
+            "__metatable", false);
+
+        _view[_entry.first] = _proxy;
+    }
+
+    // Everything else is read from the globals as it is.
+
+    _view[sol::metatable_key] = InputState.create_table_with("__index", _globals);
+    return _view;
+}
+
 void LuaBackend::LoadScripts(const char* ScrPath, uint64_t BaseInput)
 {
 	loadedScripts.clear();
-    auto _iterator = QDirIterator(ScrPath, QDirIterator::Subdirectories);
+    stoppedScripts.clear();
+
+    ReleaseScripts(_scriptStore);
+
+    // Sorted, so that the scripts load in the same order every time.
+
+    vector<string> _pathList;
+
+    for (auto& _entry : filesystem::recursive_directory_iterator(ScrPath, filesystem::directory_options::skip_permission_denied))
+    {
+        if (_entry.is_regular_file())
+            _pathList.push_back(_entry.path().generic_string());
+    }
+
+    sort(_pathList.begin(), _pathList.end());
+
+    // In shared mode, there is only one VM to go around. Remember
+    // how much a bare one costs, to tell how much we saved later.
 
-    while (_iterator.hasNext())
+    if (sharedMode)
+    {
+        _sharedVM = CreateVM(ScrPath, BaseInput);
+        sharedBaseline = _sharedVM->luaAlloc.LiveBytes;
+
+        _sharedVM->sharedView = SharedView(_sharedVM->luaState);
+    }
+
+    for (auto& _path : _pathList)
 	{
-        auto _path = _iterator.next();
+        auto _contains = [&](const char* _text) { return _path.find(_text) != string::npos; };
 
-        if (_path.contains(".lua") && !_path.contains("io_packages") && !_path.contains("io_load"))
+        if (_contains(".lua") && !_contains("io_packages") && !_contains("io_load"))
         {
-            LuaScript* _script = new LuaScript();
+            _scriptStore.push_back(make_unique<LuaScript>());
+            LuaScript* _script = _scriptStore.back().get();
 
             _script->scriptPath = _path;
+            _script->scriptIndex = loadedScripts.size();
+
+            RunningScript = _script;
+
+            if (sharedMode)
+            {
+                // Every script gets its own _ENV, which falls back to the shared
+                // globals for reading. Anything the script defines stays in its _ENV,
+                // and the libraries everyone shares can't be written to.
+
+                auto& _state = _sharedVM->luaState;
+                auto _scriptEnv = sol::environment(_state, sol::create, _sharedVM->sharedView);
+
+                _scriptEnv["_G"] = _scriptEnv;
+
+                _script->luaVM = _sharedVM;
+                _script->luaGlobals = _scriptEnv;
 
-            _script->luaState.open_libraries
-            (
-                lib::base,
-                lib::package,
-                lib::coroutine,
-                lib::string,
-                lib::os,
-                lib::math,
-                lib::table,
-                lib::io,
-                lib::bit32,
-                lib::utf8
-            );
+                _script->parseResult = _state.script_file(_path, _scriptEnv, &sol::script_pass_on_error);
+            }
 
-            _script->luaState.set_exception_handler(&ExceptionHandle);
+            else
+            {
+                _script->luaVM = CreateVM(ScrPath, BaseInput);
+                _script->luaGlobals = _script->luaVM->luaState.globals();
 
-            SetFunctions(&_script->luaState);
+                _script->parseResult = _script->luaVM->luaState.script_file(_path, &sol::script_pass_on_error);
+            }
 
-            string _luaPath = ScrPath;
-            _luaPath.append("\\io_packages\\?.lua");
+            _script->initFunction = _script->luaGlobals["_OnInit"];
+            _script->frameFunction = _script->luaGlobals["_OnFrame"];
+            _script->frameThread = sol::thread::create(_script->luaVM->luaState);
 
-            string _dllPath = ScrPath;
-            _dllPath.append("\\io_packages\\?.dll");
+            // Keep an eye on how long _OnFrame runs for. Coroutines
+            // created within it inherit the hook as well.
 
-            _script->luaState["package"]["path"] = _luaPath;
-            _script->luaState["package"]["cpath"] = _dllPath;
+            lua_sethook(_script->frameThread.thread_state(), &BudgetHook, LUA_MASKCOUNT, 1000);
 
-            string _loadPath = ScrPath;
-            _loadPath.append("\\io_load");
+            RunningScript = nullptr;
 
-            _script->luaState["LOAD_PATH"] = _loadPath;
-            _script->luaState["SCRIPT_PATH"] = ScrPath;
-            _script->luaState["CHEATS_PATH"] = "NOT_AVAILABLE";
+            LuaObject _budgetValue = _script->luaGlobals["LUAGUI_BUDGET"];
 
-            string _pathFull = MemoryLib::PName;
-            auto _pathExe = _pathFull.substr(_pathFull.find_last_of("\\") + 1);
+            if (_budgetValue.is<double>() && _budgetValue.as<double>() > 0)
+                _script->budgetTime = _budgetValue.as<float>();
 
-            _script->luaState["ENGINE_VERSION"] = 5;
-            _script->luaState["ENGINE_TYPE"] = "BACKEND";
-            _script->luaState["GAME_ID"] = CRC::Calculate(_pathExe.c_str(), _pathExe.length(), CRC::CRC_32());
-            _script->luaState["BASE_ADDR"] = BaseInput;
+            LuaObject _hzValue = _script->luaGlobals["LUAGUI_HZ"];
 
-            _script->parseResult = _script->luaState.script_file(_path.toStdString(), &sol::script_pass_on_error);
+            if (_hzValue.is<double>() && _hzValue.as<double>() > 0)
+                _script->frameLimit = 1000.0F / _hzValue.as<float>();
 
-            _script->initFunction = _script->luaState["_OnInit"];
-            _script->frameFunction = _script->luaState["_OnFrame"];
+            // If the script has a VM to itself, it gets to pick the GC mode.
 
-            string _luaName = _path.split('/').last().toStdString();
-            _script->luaState["LUA_NAME"] = _luaName.substr(0, _luaName.size() - 4);
+            if (!sharedMode)
+            {
+                LuaObject _gcMode = _script->luaGlobals["LUAGUI_GC"];
+                auto _luaHandle = _script->luaVM->luaState.lua_state();
+
+                _script->luaVM->gcGenerational = _gcMode.is<string>() && _gcMode.as<string>() == "generational";
+                _script->luaVM->gcGenerational ? lua_gc(_luaHandle, LUA_GCGEN, 0, 0) : lua_gc(_luaHandle, LUA_GCINC, 0, 0, 0);
+
+                _script->luaVM->gcBaseline = lua_gc(_luaHandle, LUA_GCCOUNT) * 1024;
+            }
+
+            string _luaName = filesystem::path(_path).filename().string();
+
+            _script->scriptName = _luaName.substr(0, _luaName.size() - 4);
+            _script->luaGlobals["LUA_NAME"] = _script->scriptName;
+            _script->traceName = TimelineTrace::Intern(_script->scriptName);
+
+            // The scripts which have to run before this one, by name.
+
+            LuaObject _afterValue = _script->luaGlobals["LUAGUI_AFTER"];
+
+            if (_afterValue.is<string>())
+                _script->afterList.push_back(_afterValue.as<string>());
+
+            else if (_afterValue.is<sol::table>())
+                for (auto& _entry : _afterValue.as<sol::table>())
+                    if (_entry.second.is<string>())
+                        _script->afterList.push_back(_entry.second.as<string>());
+
+            ReadRanges(_script->luaGlobals["LUAGUI_READS"], _script->readList);
+            ReadRanges(_script->luaGlobals["LUAGUI_WRITES"], _script->writeList);
 
             loadedScripts.push_back(_script);
         }
 	}
+
+    if (sharedMode)
+        _sharedVM->gcBaseline = lua_gc(_sharedVM->luaState.lua_state(), LUA_GCCOUNT) * 1024;
 }
 
-void LuaBackend::SetFunctions(LuaState* _state)
+void LuaBackend::ReloadScripts(const set<size_t>& InputWanted)
 {
-    // Reader Functions
+    // Load everything again from the disk, but only keep the scripts
+    // which are wanted, by their place in the script folder. The old
+    // ones stay around until ReleaseRetired, even if none were loaded,
+    // so every reload is released by exactly one call.
 
-    _state->set_function("ReadByte",
-    sol::overload
-    (
-        [](uint64_t _addr) { return MemoryLib::ReadByte(_addr); },
-        [](uint64_t _addr, bool _absolute) { return MemoryLib::ReadByte(_addr, _absolute); }
-    ));
+    _retiredStore.push_back(std::move(_scriptStore));
+    _scriptStore.clear();
 
-    _state->set_function("ReadShort",
-    sol::overload
-    (
-        [](uint64_t _addr) { return MemoryLib::ReadShort(_addr); },
-        [](uint64_t _addr, bool _absolute) { return MemoryLib::ReadShort(_addr, _absolute); }
-    ));
+    LoadScripts(scrPath.c_str(), baseAddress);
 
-    _state->set_function("ReadInt",
-    sol::overload
-    (
-        [](uint64_t _addr) { return MemoryLib::ReadInt(_addr); },
-        [](uint64_t _addr, bool _absolute) { return MemoryLib::ReadInt(_addr, _absolute); }
-    ));
+    vector<LuaScript*> _keepList;
 
-    _state->set_function("ReadLong",
-    sol::overload
-    (
-        [](uint64_t _addr) { return MemoryLib::ReadLong(_addr); },
-        [](uint64_t _addr, bool _absolute) { return MemoryLib::ReadLong(_addr, _absolute); }
-    ));
+    for (auto _script : loadedScripts)
+        if (InputWanted.count(_script->scriptIndex) != 0)
+            _keepList.push_back(_script);
 
-    _state->set_function("ReadFloat",
-    sol::overload
-    (
-        [](uint64_t _addr) { return MemoryLib::ReadFloat(_addr); },
-        [](uint64_t _addr, bool _absolute) { return MemoryLib::ReadFloat(_addr, _absolute); }
-    ));
+    loadedScripts = _keepList;
 
-    _state->set_function("ReadBoolean",
-    sol::overload
-    (
-        [](uint64_t _addr) { return MemoryLib::ReadBool(_addr); },
-        [](uint64_t _addr, bool _absolute) { return MemoryLib::ReadBool(_addr, _absolute); }
-    ));
+    // Start ticking from scratch.
 
-    _state->set_function("ReadArray",
-    sol::overload
-    (
-        [](uint64_t _addr, int _len) { return MemoryLib::ReadBytes(_addr, _len); },
-        [](uint64_t _addr, int _len, bool _absolute) { return MemoryLib::ReadBytes(_addr, _len, _absolute); }
-    ));
+    _frameWheel.Clear();
+    _frameStarted = false;
 
-    _state->set_function("ReadString",
-    sol::overload
-    (
-        [](uint64_t _addr, int _len) { return MemoryLib::ReadString(_addr, _len); },
-        [](uint64_t _addr, int _len, bool _absolute) { return MemoryLib::ReadString(_addr, _len, _absolute); }
-    ));
+    BuildGraph();
+}
 
-    // Writer Functions
+void LuaBackend::ReleaseRetired()
+{
+    // Reloads are heard of in the order they happened, so the
+    // oldest one is the one which nobody holds anymore.
 
-    _state->set_function("WriteByte",
-    sol::overload
-    (
-        [](uint64_t _addr, uint8_t _val) { MemoryLib::WriteByte(_addr, _val); },
-        [](uint64_t _addr, uint8_t _val, bool _absolute) { MemoryLib::WriteByte(_addr, _val, _absolute); }
-    ));
+    if (_retiredStore.empty())
+        return;
 
-    _state->set_function("WriteShort",
-    sol::overload
-    (
-        [](uint64_t _addr, uint16_t _val) { MemoryLib::WriteShort(_addr, _val); },
-        [](uint64_t _addr, uint16_t _val, bool _absolute) { MemoryLib::WriteShort(_addr, _val, _absolute); }
-    ));
+    ReleaseScripts(_retiredStore.front());
+    _retiredStore.pop_front();
+}
 
-    _state->set_function("WriteInt",
-    sol::overload
-    (
-        [](uint64_t _addr, uint32_t _val) { MemoryLib::WriteInt(_addr, _val); },
-        [](uint64_t _addr, uint32_t _val, bool _absolute) { MemoryLib::WriteInt(_addr, _val, _absolute); }
-    ));
+void LuaBackend::InitScripts()
+{
+    // Execute the initialization functions.
 
-    _state->set_function("WriteLong",
-    sol::overload
-    (
-        [](uint64_t _addr, uint64_t _val) { MemoryLib::WriteLong(_addr, _val); },
-        [](uint64_t _addr, uint64_t _val, bool _absolute) { MemoryLib::WriteLong(_addr, _val, _absolute); }
-    ));
+    for (auto _script : loadedScripts)
+    {
+        if (_script->initFunction)
+        {
+            _script->luaVM->luaAlloc.LimitHit = false;
 
-    _state->set_function("WriteFloat",
-    sol::overload
-    (
-        [](uint64_t _addr, float _val) { MemoryLib::WriteFloat(_addr, _val); },
-        [](uint64_t _addr, float _val, bool _absolute) { MemoryLib::WriteFloat(_addr, _val, _absolute); }
-    ));
+            RunningScript = _script;
+            auto _result = _script->initFunction();
+            RunningScript = nullptr;
 
-    _state->set_function("WriteBoolean",
-    sol::overload
-    (
-        [](uint64_t _addr, bool _val) { MemoryLib::WriteBool(_addr, _val); },
-        [](uint64_t _addr, bool _val, bool _absolute) { MemoryLib::WriteBool(_addr, _val, _absolute); }
-    ));
+            if (!_result.valid())
+            {
+                sol::error _err = _result;
+                _outputConsole->writeMessage(string(_err.what()) + "<br>", 3);
+            }
+        }
+    }
+}
 
-    _state->set_function("WriteArray",
-    sol::overload
-    (
-        [](uint64_t _addr, vector<uint8_t> _val) { MemoryLib::WriteBytes(_addr, _val); },
-        [](uint64_t _addr, vector<uint8_t> _val, bool _absolute) { MemoryLib::WriteBytes(_addr, _val, _absolute); }
+void LuaBackend::PrintMessage(const string& InputMessage, int MessageType)
+{
+    _outputConsole->writeMessage(InputMessage, MessageType);
+}
 
-    ));
+void LuaBackend::ReadRanges(const LuaObject& InputValue, vector<pair<uint64_t, uint64_t>>& OutRanges)
+{
+    // Either an address, which is a single byte, or { address, size }.
 
-    _state->set_function("WriteString",
-    sol::overload
-    (
-        [](uint64_t _addr, string _val) { MemoryLib::WriteString(_addr, _val); },
-        [](uint64_t _addr, string _val, bool _absolute) { MemoryLib::WriteString(_addr, _val, _absolute); }
-    ));
+    if (!InputValue.is<sol::table>())
+        return;
+
+    for (auto& _entry : InputValue.as<sol::table>())
+    {
+        if (_entry.second.is<uint64_t>())
+            OutRanges.push_back({ _entry.second.as<uint64_t>(), 1 });
+
+        else if (_entry.second.is<sol::table>())
+        {
+            auto _range = _entry.second.as<sol::table>();
+            OutRanges.push_back({ _range.get_or<uint64_t>(1, 0), _range.get_or<uint64_t>(2, 1) });
+        }
+    }
+}
+
+bool LuaBackend::BuildGraph()
+{
+    auto _count = loadedScripts.size();
+
+    vector<vector<size_t>> _nextList(_count);
+    vector<vector<size_t>> _prevList(_count);
+
+    auto _addEdge = [&](size_t _from, size_t _to)
+    {
+        if (_from == _to || find(_nextList[_from].begin(), _nextList[_from].end(), _to) != _nextList[_from].end())
+            return;
+
+        _nextList[_from].push_back(_to);
+        _prevList[_to].push_back(_from);
+    };
+
+    auto _overlaps = [](const vector<pair<uint64_t, uint64_t>>& _left, const vector<pair<uint64_t, uint64_t>>& _right)
+    {
+        for (auto& _a : _left)
+            for (auto& _b : _right)
+                if (_a.first < _b.first + _b.second && _b.first < _a.first + _a.second)
+                    return true;
+
+        return false;
+    };
+
+    // Declared edges first, then the implied ones: whoever writes
+    // something has to run before whoever reads it.
+
+    for (size_t i = 0; i < _count; i++)
+    {
+        for (auto& _name : loadedScripts[i]->afterList)
+        {
+            auto _found = find_if(loadedScripts.begin(), loadedScripts.end(), [&](LuaScript* _script) { return _script->scriptName == _name; });
+
+            if (_found == loadedScripts.end())
+            {
+                _outputConsole->writeMessage("The script \"" + loadedScripts[i]->scriptName + "\" runs after \"" + _name + "\", which is not loaded.<br>", 2);
+                continue;
+            }
+
+            _addEdge(_found - loadedScripts.begin(), i);
+        }
+
+        for (size_t j = 0; j < _count; j++)
+            if (i != j && _overlaps(loadedScripts[i]->writeList, loadedScripts[j]->readList))
+                _addEdge(i, j);
+    }
+
+    // Sort them topologically. Out of everything which is free to run,
+    // the earliest loaded script goes first, so unrelated scripts keep
+    // their load order.
+
+    vector<size_t> _waitList(_count);
+    vector<size_t> _orderList;
+    vector<bool> _doneList(_count, false);
+
+    priority_queue<size_t, vector<size_t>, greater<size_t>> _readyQueue;
+
+    for (size_t i = 0; i < _count; i++)
+    {
+        _waitList[i] = _prevList[i].size();
+
+        if (_waitList[i] == 0)
+            _readyQueue.push(i);
+    }
+
+    while (_orderList.size() < _count)
+    {
+        while (!_readyQueue.empty())
+        {
+            auto _node = _readyQueue.top();
+            _readyQueue.pop();
+
+            _doneList[_node] = true;
+            _orderList.push_back(_node);
+
+            for (auto _next : _nextList[_node])
+                if (--_waitList[_next] == 0)
+                    _readyQueue.push(_next);
+        }
+
+        if (_orderList.size() == _count)
+            break;
+
+        // Whatever is left waits on something else which is left, so walking
+        // backwards from any of them has to run in circles eventually.
+
+        vector<size_t> _walkList;
+        vector<size_t> _walkSeen(_count, SIZE_MAX);
+
+        auto _node = (size_t)(find(_doneList.begin(), _doneList.end(), false) - _doneList.begin());
+
+        while (_walkSeen[_node] == SIZE_MAX)
+        {
+            _walkSeen[_node] = _walkList.size();
+            _walkList.push_back(_node);
+
+            _node = *find_if(_prevList[_node].begin(), _prevList[_node].end(), [&](size_t _prev) { return !_doneList[_prev]; });
+        }
+
+        vector<size_t> _cycleList(_walkList.rbegin(), _walkList.rend() - _walkSeen[_node]);
+
+        string _cycleText;
+
+        for (auto _member : _cycleList)
+            _cycleText += "\"" + loadedScripts[_member]->scriptName + "\" -> ";
+
+        _cycleText += "\"" + loadedScripts[_cycleList[0]]->scriptName + "\"";
+
+        // Break the cycle before its earliest loaded script.
+
+        auto _first = min_element(_cycleList.begin(), _cycleList.end());
+        auto _prev = _first == _cycleList.begin() ? _cycleList.back() : *(_first - 1);
+
+        _nextList[_prev].erase(find(_nextList[_prev].begin(), _nextList[_prev].end(), *_first));
+        _prevList[*_first].erase(find(_prevList[*_first].begin(), _prevList[*_first].end(), _prev));
+
+        _outputConsole->writeMessage("Scripts depend on each other in a cycle: " + _cycleText + ". \"" + loadedScripts[*_first]->scriptName +
+                                     "\" will no longer wait on \"" + loadedScripts[_prev]->scriptName + "\".<br>", 2);
+
+        if (--_waitList[*_first] == 0)
+            _readyQueue.push(*_first);
+    }
+
+    // Everything downstream of a script has to wait on it, even if the
+    // scripts in between are not due on the same tick.
+
+    bool _hasEdges = false;
+
+    for (size_t i = 0; i < _count; i++)
+    {
+        auto _script = loadedScripts[_orderList[i]];
+
+        _script->graphRank = i;
+        _script->graphNext.clear();
+
+        vector<size_t> _stackList = _nextList[_orderList[i]];
+        vector<bool> _seenList(_count, false);
+
+        while (!_stackList.empty())
+        {
+            auto _node = _stackList.back();
+            _stackList.pop_back();
+
+            if (_seenList[_node])
+                continue;
+
+            _seenList[_node] = true;
+            _script->graphNext.push_back(loadedScripts[_node]);
+
+            for (auto _next : _nextList[_node])
+                _stackList.push_back(_next);
+        }
+
+        _hasEdges = _hasEdges || !_script->graphNext.empty();
+    }
+
+    return _hasEdges;
+}
+
+void LuaBackend::RunFrame(double InputTime)
+{
+    // First frame? Everyone is due right away, and every deadline
+    // from here on is counted from now, same as the pacer's.
+
+    if (!_frameStarted)
+    {
+        _frameStarted = true;
+        _startTime = LuaClock::now();
+
+        for (auto _script : loadedScripts)
+        {
+            if (!_script->frameFunction)
+                continue;
+
+            _script->frameDeadline = 0;
+            _frameWheel.Schedule(_script, 0);
+        }
+    }
+
+    auto _timeNow = InputTime >= 0 ? InputTime : std::chrono::duration<double, std::milli>(LuaClock::now() - _startTime).count();
+
+    // Recording, or playing back? Then the trace needs to know where frames start.
+
+    if (MemoryLib::Source != nullptr)
+        MemoryLib::Source->NextFrame(_timeNow);
+
+    _dueList.clear();
+    _frameWheel.Advance(WheelTick(_timeNow), _dueList);
+
+    // Scripts which are due together run in dependency order,
+    // and otherwise in the order they were loaded.
+
+    sort(_dueList.begin(), _dueList.end(), [](LuaScript* _left, LuaScript* _right)
+    {
+        if (_left->graphRank != _right->graphRank)
+            return _left->graphRank < _right->graphRank;
+
+        return _left->scriptIndex < _right->scriptIndex;
+    });
+
+    _runList.clear();
+
+    for (auto _script : _dueList)
+    {
+        // A script sleeping for frames is only dispatched once those frames
+        // have passed, so catch its frame count up instead of counting them.
+
+        if (_script->waitType == WAIT_FRAMES && !FrameSynced(_script))
+            _script->frameCount = _script->waitFrame;
+
+        else
+            _script->frameCount++;
+
+        // The frames it waited for are over, whether it runs now or is disabled.
+
+        if (_script->waitType == WAIT_FRAMES && _script->frameCount >= _script->waitFrame)
+            _script->waitType = WAIT_NONE;
+
+        if (!_script->frameEnabled || IsWaiting(_script))
+        {
+            ScheduleFrame(_script, _timeNow);
+            continue;
+        }
+
+        _runList.push_back(_script);
+    }
+
+    // Every script has its own VM, so their frames can run side by side.
+    // A script always goes to the same worker, unless that one is busy.
+
+    if (_workerPool && _runList.size() > 1)
+    {
+        // Only the edges between scripts which run this tick matter.
+
+        bool _hasEdges = false;
+
+        _runNext.resize(_runList.size());
+
+        for (size_t i = 0; i < _runList.size(); i++)
+        {
+            _runList[i]->runSlot = i;
+            _runNext[i].clear();
+        }
+
+        for (size_t i = 0; i < _runList.size(); i++)
+        {
+            for (auto _next : _runList[i]->graphNext)
+            {
+                if (_next->runSlot != SIZE_MAX)
+                {
+                    _runNext[i].push_back(_next->runSlot);
+                    _hasEdges = true;
+                }
+            }
+        }
+
+        for (auto _script : _runList)
+            _script->runSlot = SIZE_MAX;
+
+        _workerPool->Run(_runList.size(),
+            [this](size_t _index) { return _runList[_index]->scriptIndex; },
+            [this](size_t _index)
+            {
+                auto _script = _runList[_index];
+                _script->frameError.clear();
+                _script->frameResult = ResumeFrame(_script, _script->frameError);
+            },
+            _hasEdges ? &_runNext : nullptr);
+    }
+
+    else
+    {
+        for (auto _script : _runList)
+        {
+            _script->frameError.clear();
+            _script->frameResult = ResumeFrame(_script, _script->frameError);
+        }
+    }
+
+    // Errors are only handled past the barrier, so that the console and
+    // the script list are never touched by more than one thread.
+
+    for (auto _script : _runList)
+    {
+        if (!_script->frameResult)
+        {
+            PrintError(_outputConsole, _script, _script->frameError);
+
+            if (!_script->frameOverrun || !HandleOverrun(_outputConsole, _script, ScriptInterval(_script)))
+            {
+                loadedScripts.erase(find(loadedScripts.begin(), loadedScripts.end(), _script));
+                stoppedScripts.push_back(_script);
+                continue;
+            }
+        }
+
+        ScheduleFrame(_script, _timeNow);
+    }
+}
+
+void LuaBackend::EnablePool(size_t InputCount)
+{
+    // A shared VM can only ever run one script at a time.
+
+    if (sharedMode)
+    {
+        _outputConsole->writeMessage("The worker pool cannot be used with a shared VM. Running single-threaded.<br>", 2);
+        return;
+    }
+
+    _workerPool = make_unique<WorkerPool>(InputCount);
+}
+
+size_t LuaBackend::PoolSize()
+{
+    return _workerPool ? _workerPool->Size() : 0;
+}
+
+void LuaBackend::ScheduleFrame(LuaScript* InputScript, double InputTime)
+{
+    // Synced to the game? Then the next tick is the next game frame,
+    // unless the script is sleeping for a while.
+
+    if (FrameSynced(InputScript) && InputScript->waitType != WAIT_TIME)
+    {
+        InputScript->frameDeadline = InputTime;
+        _frameWheel.Schedule(InputScript, 0);
+
+        return;
+    }
+
+    auto _interval = ScriptInterval(InputScript);
+
+    // Deadlines are absolute, so the rate does not drift. But if we fell
+    // more than a whole frame behind, skip the missed frames. When catching
+    // up, keep up to catchUpLimit of them, to run on the ticks which the
+    // pacer runs back to back.
+
+    auto _keepCount = framePacer.pacePolicy == FramePacer::PACE_CATCHUP ? (double)framePacer.catchUpLimit : 0.0;
+
+    InputScript->frameDeadline += _interval;
+
+    if (InputScript->frameDeadline + _interval * (_keepCount + 1) < InputTime)
+        InputScript->frameDeadline += _interval * (floor((InputTime - InputScript->frameDeadline) / _interval) - _keepCount);
+
+    switch (InputScript->waitType)
+    {
+        case WAIT_FRAMES:
+        {
+            // The frame counts are unsigned, and a wait may be over already.
+
+            auto _extraCount = (int64_t)InputScript->waitFrame - (int64_t)InputScript->frameCount - 1;
+
+            if (_extraCount > 0)
+                InputScript->frameDeadline += _interval * _extraCount;
+
+            break;
+        }
+
+        case WAIT_TIME:
+        {
+            auto _wakeTime = std::chrono::duration<double, std::milli>(InputScript->waitTime - _startTime).count();
+
+            if (_wakeTime > InputScript->frameDeadline)
+                InputScript->frameDeadline = _wakeTime;
+
+            // Waking up a little late beats waking up early and waiting a whole frame.
+
+            _frameWheel.Schedule(InputScript, (uint64_t)ceil(InputScript->frameDeadline * WheelScale));
+            return;
+        }
+
+        default:
+            break;
+    }
+
+    _frameWheel.Schedule(InputScript, WheelTick(InputScript->frameDeadline));
+}
+
+float LuaBackend::ScriptInterval(LuaScript* InputScript)
+{
+    return InputScript->frameLimit > 0 ? InputScript->frameLimit : frameLimit;
+}
+
+bool LuaBackend::FrameSynced(LuaScript* InputScript)
+{
+    return frameSync.Enabled() && InputScript->frameLimit <= 0;
+}
+
+float LuaBackend::TickInterval()
+{
+    // The driving timer has to tick as fast as the fastest script.
+
+    auto _interval = frameLimit;
+
+    for (auto _script : loadedScripts)
+        _interval = std::min(_interval, ScriptInterval(_script));
+
+    return std::max(_interval, 1.0F);
+}
+
+string LuaBackend::ProfileSummary(const vector<LuaScript*>& InputList, size_t InputCount)
+{
+    // The slowest ones first, by how long their slowest calls took.
+
+    vector<LuaScript*> _sortList;
+
+    for (auto _script : InputList)
+        if (_script->frameProfile.WindowFrames != 0)
+            _sortList.push_back(_script);
+
+    if (_sortList.empty())
+        return MemorySummary();
+
+    sort(_sortList.begin(), _sortList.end(), [](LuaScript* _left, LuaScript* _right)
+    {
+        return _left->frameProfile.WindowHigh > _right->frameProfile.WindowHigh;
+    });
+
+    _sortList.resize(min(_sortList.size(), InputCount));
+
+    string _return = "Slowest scripts (median, 95%, max) with the I/O of a frame:<br>";
+    char _line[256];
+
+    for (auto _script : _sortList)
+    {
+        auto& _profile = _script->frameProfile;
+
+        snprintf(_line, sizeof(_line), "%s: %.3fms, %.3fms, %.3fms. %.1f reads (%.0fB), %.1f writes (%.0fB).<br>",
+                 _script->scriptName.c_str(), _profile.WindowMedian / 1000, _profile.WindowHigh / 1000, _profile.WindowMax / 1000,
+                 _profile.WindowReads.load(), _profile.WindowReadBytes.load(), _profile.WindowWrites.load(), _profile.WindowWriteBytes.load());
+
+        _return += _line;
+    }
+
+    return _return + MemorySummary();
+}
+
+string LuaBackend::MemorySummary()
+{
+    auto _report = MemoryStats::Current();
+    auto& _read = _report.opList[MemoryStats::OP_READ];
+    auto& _write = _report.opList[MemoryStats::OP_WRITE];
+
+    if (_read.total.calls == 0 && _write.total.calls == 0)
+        return "";
+
+    char _line[512];
+
+    snprintf(_line, sizeof(_line), "Game memory, per second: %.0f reads (%.1fKB, %.0f failed, median %.1fus, 95%% %.1fus), "
+             "%.0f writes (%.1fKB, %.0f failed, %.0f unprotected, median %.1fus, 95%% %.1fus).<br>",
+             _read.callRate, _read.byteRate / 1024, _read.failureRate, _read.medianTime, _read.highTime,
+             _write.callRate, _write.byteRate / 1024, _write.failureRate, _write.fallbackRate, _write.medianTime, _write.highTime);
+
+    return _line;
+}
+
+bool LuaBackend::ResumeFrame(LuaScript* InputScript, string& OutError)
+{
+    auto _thread = InputScript->frameThread.thread_state();
+    auto _prevScript = RunningScript;
+
+    // Not sleeping? Start a brand new _OnFrame call.
+
+    if (!InputScript->frameSuspended)
+        InputScript->frameFunction.push(_thread);
+
+    int _resultCount = 0;
+
+    // Only a limit hit during this call is what an error of this call is about.
+    // One which a pcall got the script through before has nothing to do with it.
+
+    InputScript->luaVM->luaAlloc.LimitHit = false;
+
+    auto _budgetTime = InputScript->budgetTime > 0 ? InputScript->budgetTime : BudgetTime;
+
+    InputScript->budgetUsed = 0;
+    InputScript->frameOverrun = false;
+    InputScript->budgetDeadline = LuaClock::time_point::max();
+
+    auto _callStart = LuaClock::now();
+
+    if (_budgetTime > 0)
+        InputScript->budgetDeadline = _callStart + std::chrono::duration_cast<LuaClock::duration>(std::chrono::duration<float, std::milli>(_budgetTime));
+
+    // The memory functions count what they do into this.
+
+    ScriptProfile::FrameIO _frameIO;
+    auto _prevIO = ScriptProfile::CurrentIO;
+
+    if (ProfileFrames)
+        ScriptProfile::CurrentIO = &_frameIO;
+
+    if (InputScript->frameSampler.Enabled)
+        InputScript->frameSampler.Begin(_callStart);
+
+    RunningScript = InputScript;
+
+    int _status;
+
+    {
+        TimelineTrace::Span _span(InputScript->traceName, "frame", InputScript->frameCount, "frame");
+        _status = lua_resume(_thread, nullptr, 0, &_resultCount);
+    }
+
+    RunningScript = _prevScript;
+
+    ScriptProfile::CurrentIO = _prevIO;
+
+    // An aborted call leaves the hook raising on every instruction. Should
+    // it have finished or yielded anyway, say from C, it's aborted all the same.
+
+    if (InputScript->frameOverrun)
+    {
+        lua_sethook(_thread, &BudgetHook, LUA_MASKCOUNT, 1000);
+
+        if (_status == LUA_OK || _status == LUA_YIELD)
+        {
+            lua_pop(_thread, _resultCount);
+            lua_pushstring(_thread, InputScript->overrunError.c_str());
+
+            _status = LUA_ERRRUN;
+        }
+    }
+
+    if (ProfileFrames)
+        InputScript->frameProfile.Record(_callStart, LuaClock::now(), _frameIO);
+
+    if (_status == LUA_OK)
+    {
+        lua_pop(_thread, _resultCount);
+        InputScript->frameSuspended = false;
+
+        return true;
+    }
+
+    if (_status == LUA_YIELD)
+    {
+        // Whatever the Wait function yielded tells us what to wait for.
+        // Any other yield, with values or not, just waits for the next frame.
+
+        auto _tagged = _resultCount > 1 && lua_touserdata(_thread, -_resultCount) == &WaitTag;
+        auto _type = _tagged ? (WaitType)lua_tointeger(_thread, 1 - _resultCount) : WAIT_NONE;
+        auto _arg = [&](int _index) { return _index + 1 < _resultCount ? (uint64_t)lua_tointeger(_thread, _index + 1 - _resultCount) : 0; };
+
+        InputScript->frameSuspended = true;
+
+        switch (_type)
+        {
+            case WAIT_TIME:
+                InputScript->waitType = WAIT_TIME;
+                InputScript->waitTime = LuaClock::now() + std::chrono::milliseconds(_arg(1));
+                break;
+
+            case WAIT_VALUE:
+                InputScript->waitType = WAIT_VALUE;
+                InputScript->waitAddress = _arg(1);
+                InputScript->waitValue = _arg(2);
+                InputScript->waitSize = (int)_arg(3);
+                InputScript->waitAbsolute = _arg(4) != 0;
+                break;
+
+            default:
+                InputScript->waitType = WAIT_FRAMES;
+                InputScript->waitFrame = InputScript->frameCount + (_type == WAIT_FRAMES ? std::max(_arg(1), (uint64_t)1) : 1);
+                break;
+        }
+
+        lua_pop(_thread, _resultCount);
+        return true;
+    }
+
+    OutError = luaL_tolstring(_thread, -1, nullptr);
+
+    lua_resetthread(_thread);
+    InputScript->frameSuspended = false;
+
+    return false;
+}
+
+bool LuaBackend::IsWaiting(LuaScript* InputScript)
+{
+    switch (InputScript->waitType)
+    {
+        case WAIT_FRAMES:
+            if (InputScript->frameCount < InputScript->waitFrame)
+                return true;
+            break;
+
+        case WAIT_TIME:
+            if (LuaClock::now() < InputScript->waitTime)
+                return true;
+            break;
+
+        case WAIT_VALUE:
+        {
+            auto _addr = InputScript->waitAddress;
+            auto _absolute = InputScript->waitAbsolute;
+
+            uint64_t _value = 0;
+
+            switch (InputScript->waitSize)
+            {
+                case 2: _value = MemoryLib::ReadShort(_addr, _absolute); break;
+                case 4: _value = MemoryLib::ReadInt(_addr, _absolute); break;
+                case 8: _value = MemoryLib::ReadLong(_addr, _absolute); break;
+                default: _value = MemoryLib::ReadByte(_addr, _absolute); break;
+            }
+
+            if (_value != InputScript->waitValue)
+                return true;
+            break;
+        }
+
+        default:
+            return false;
+    }
+
+    InputScript->waitType = WAIT_NONE;
+    return false;
+}
+
+void LuaBackend::PrintError(MessageSink* InputConsole, LuaScript* InputScript, const string& InputError)
+{
+    InputConsole->writeMessage(InputError + "<br>", 3);
+
+    // Taken, so an allocation which was refused once and recovered from
+    // does not get blamed for every error after it.
+
+    if (InputScript->luaVM->luaAlloc.LimitHit.exchange(false))
+        InputConsole->writeMessage("The script \"" + InputScript->scriptPath + "\" has exceeded its memory limit of " +
+                                   to_string(InputScript->luaVM->luaAlloc.ByteLimit / 1024) + "KB and has been stopped.<br>", 3);
+}
+
+bool LuaBackend::HandleOverrun(MessageSink* InputConsole, LuaScript* InputScript, float InputInterval)
+{
+    // The call was aborted already. Decide what to do with the script.
+    // Returns false if it should be stopped.
+
+    InputScript->overrunCount++;
+
+    auto _name = InputScript->scriptPath;
+    auto _count = to_string(InputScript->overrunCount);
+
+    if (InputScript->overrunCount >= OverrunLimit)
+    {
+        InputConsole->writeMessage("The script \"" + _name + "\" went over its budget " + _count + " times and has been stopped.<br>", 3);
+        return false;
+    }
+
+    if (InputScript->overrunCount % OverrunDemote == 0)
+    {
+        InputScript->frameLimit = InputInterval * 2;
+
+        char _hertz[32];
+        snprintf(_hertz, sizeof(_hertz), "%.1f", 1000 / InputScript->frameLimit);
+
+        InputConsole->writeMessage("The script \"" + _name + "\" went over its budget " + _count + " times and has been slowed down to " + _hertz + "Hz.<br>", 2);
+    }
+
+    else
+        InputConsole->writeMessage("The script \"" + _name + "\" went over its budget (" + _count + " of " + to_string(OverrunLimit - 1) + " allowed).<br>", 2);
+
+    return true;
+}
+
+void LuaBackend::BudgetHook(lua_State* L, lua_Debug*)
+{
+    auto _script = RunningScript;
+
+    if (_script == nullptr)
+        return;
+
+    if (!_script->frameOverrun)
+    {
+        _script->budgetUsed += 1000;
+
+        auto _hookTime = LuaClock::now();
+
+        if (_script->frameSampler.Enabled)
+            _script->frameSampler.Tick(L, _hookTime);
+
+        auto _overTime = _hookTime > _script->budgetDeadline;
+        auto _overCount = BudgetInstructions != 0 && _script->budgetUsed > BudgetInstructions;
+
+        if (!_overTime && !_overCount)
+            return;
+
+        char _text[128];
+
+        if (_overTime)
+            snprintf(_text, sizeof(_text), "_OnFrame ran for longer than its budget of %.1fms and was aborted.",
+                     _script->budgetTime > 0 ? _script->budgetTime : BudgetTime);
+
+        else
+            snprintf(_text, sizeof(_text), "_OnFrame ran for more than its budget of %llu instructions and was aborted.",
+                     (unsigned long long)BudgetInstructions);
+
+        _script->frameOverrun = true;
+        _script->overrunError = _text;
+
+        // A pcall within _OnFrame would catch the error and carry on. So from
+        // now on, it's raised again on every instruction, of this coroutine and
+        // of _OnFrame's, until nothing is left to catch it.
+
+        lua_sethook(L, &BudgetHook, LUA_MASKCOUNT, 1);
+        lua_sethook(_script->frameThread.thread_state(), &BudgetHook, LUA_MASKCOUNT, 1);
+    }
+
+    luaL_error(L, "%s", _script->overrunError.c_str());
+}
+
+// The Wait functions do not wait by themselves. They yield the frame
+// coroutine along with WaitTag and what to wait for, and ResumeFrame
+// takes it from there.
+
+int LuaBackend::WaitFrames(lua_State* L)
+{
+    auto _count = luaL_optinteger(L, 1, 1);
+
+    luaL_argcheck(L, _count >= 0, 1, "count must not be negative");
+
+    lua_pushlightuserdata(L, &WaitTag);
+    lua_pushinteger(L, WAIT_FRAMES);
+    lua_pushinteger(L, _count);
+
+    return lua_yield(L, 3);
+}
+
+int LuaBackend::WaitMs(lua_State* L)
+{
+    auto _time = luaL_checkinteger(L, 1);
+
+    luaL_argcheck(L, _time >= 0, 1, "time must not be negative");
+
+    lua_pushlightuserdata(L, &WaitTag);
+    lua_pushinteger(L, WAIT_TIME);
+    lua_pushinteger(L, _time);
+
+    return lua_yield(L, 3);
+}
+
+int LuaBackend::WaitUntil(lua_State* L)
+{
+    auto _addr = luaL_checkinteger(L, 1);
+    auto _value = luaL_checkinteger(L, 2);
+    auto _size = luaL_optinteger(L, 3, 1);
+    auto _absolute = lua_toboolean(L, 4);
+
+    luaL_argcheck(L, _size == 1 || _size == 2 || _size == 4 || _size == 8, 3, "size must be 1, 2, 4 or 8");
+
+    // The value read is never negative, nor bigger than what fits in the size.
+    // A value like that would never come, and the script would wait forever.
+
+    if (_value < 0 || (_size < 8 && (uint64_t)_value >> (_size * 8) != 0))
+        luaL_argerror(L, 2, "value must not be negative, nor bigger than what fits in size");
+
+    lua_pushlightuserdata(L, &WaitTag);
+    lua_pushinteger(L, WAIT_VALUE);
+    lua_pushinteger(L, _addr);
+    lua_pushinteger(L, _value);
+    lua_pushinteger(L, _size);
+    lua_pushinteger(L, _absolute);
+
+    return lua_yield(L, 6);
+}
+
+float LuaBackend::CollectGarbage(LuaClock::time_point InputDeadline)
+{
+    if (sharedMode)
+        return CollectGarbage(_sharedVM.get(), InputDeadline);
+
+    // Go through the scripts round-robin, starting where
+    // we left off last frame, so that everyone gets a turn.
+
+    float _total = 0;
+    auto _count = loadedScripts.size();
+
+    for (size_t i = 0; i < _count; i++)
+    {
+        auto _script = loadedScripts[(_gcCursor + i) % _count];
+        _total += CollectGarbage(_script->luaVM.get(), InputDeadline);
+
+        if (LuaClock::now() >= InputDeadline)
+        {
+            _gcCursor = (_gcCursor + i + 1) % _count;
+            break;
+        }
+    }
+
+    return _total;
+}
+
+float LuaBackend::CollectGarbage(LuaVM* InputVM, LuaClock::time_point InputDeadline)
+{
+    // A VM only gets collected once it grew by half since the
+    // last finished cycle. If it grew four-fold, it's been starved of
+    // idle time, so force a full collection regardless of the deadline.
+
+    auto _start = LuaClock::now();
+    auto _luaHandle = InputVM->luaState.lua_state();
+
+    auto _used = (size_t)lua_gc(_luaHandle, LUA_GCCOUNT) * 1024;
+    auto _baseline = std::max(InputVM->gcBaseline, (size_t)256 * 1024);
+
+    if (_used > _baseline * 4)
+    {
+        lua_gc(_luaHandle, LUA_GCCOLLECT);
+        InputVM->gcBaseline = lua_gc(_luaHandle, LUA_GCCOUNT) * 1024;
+    }
+
+    else if (_used > _baseline + _baseline / 2)
+    {
+        // In generational mode, a step is a whole minor collection.
+        // In incremental mode, keep stepping until the cycle is over or we run out of time.
+
+        if (InputVM->gcGenerational)
+        {
+            lua_gc(_luaHandle, LUA_GCSTEP, 0);
+            InputVM->gcBaseline = lua_gc(_luaHandle, LUA_GCCOUNT) * 1024;
+        }
+
+        else while (LuaClock::now() < InputDeadline)
+        {
+            if (lua_gc(_luaHandle, LUA_GCSTEP, 0))
+            {
+                InputVM->gcBaseline = lua_gc(_luaHandle, LUA_GCCOUNT) * 1024;
+                break;
+            }
+        }
+    }
+
+    auto _time = std::chrono::duration<float, std::milli>(LuaClock::now() - _start).count();
+    InputVM->gcTime = _time;
+
+    return _time;
+}
+
+void LuaBackend::SetFunctions(LuaState* _state)
+{
+    // Memory Functions
+
+    LuaMemoryLib::Register(_state->lua_state());
 
 	_state->set_function("WriteExec", MemoryLib::WriteExec);
 
@@ -210,130 +1220,196 @@ void LuaBackend::SetFunctions(LuaState* _state)
 		sol::overload(
             [this](LuaObject Text)
 			{
-                 auto _text = QString::fromStdString(Text.as<string>());
-                 _outputConsole->printMessage(_text, 0);
+                 _outputConsole->writeMessage(Text.as<string>(), 0);
 			}, 
 
             [this](LuaObject Text, int MessageType)
 			{
-                auto _text = QString::fromStdString(Text.as<string>());
-                _outputConsole->printMessage(_text, MessageType);
+                _outputConsole->writeMessage(Text.as<string>(), MessageType);
 			}
 		)
 	);
 
-    _state->set_function("GetHertz", [this]() { return floor(1000 / frameLimit); });
-    _state->set_function("SetHertz", [this](int _input) { frameLimit = floor(1000 / _input); });
+    // Both work on the script calling them. Only when called
+    // outside of any script do they work on the backend's rate.
+
+    _state->set_function("GetHertz", [this]()
+    {
+        if (RunningScript != nullptr)
+            return round(1000 / ScriptInterval(RunningScript));
+
+        return round(1000 / frameLimit);
+    });
+
+    _state->set_function("SetHertz", [this](int _input)
+    {
+        if (_input <= 0)
+            return;
+
+        if (RunningScript != nullptr)
+            RunningScript->frameLimit = 1000.0F / _input;
+
+        else
+            frameLimit = 1000.0F / _input;
+    });
 
     _state->set_function("ULShift32", Operator32Lib::UnsignedShift32);
 
-    // Discord Functions
+    // How well the engine keeps to its rate. The jitter values are
+    // in microseconds, the percentiles are histogram bucket edges.
 
-    _state->set_function("InitializeRPC", DCInstance::InitializeRPC);
-    _state->set_function("UpdateDetails", DCInstance::UpdateDetails);
-    _state->set_function("UpdateState", DCInstance::UpdateState);
-    _state->set_function("UpdateLImage", DCInstance::UpdateLImage);
-    _state->set_function("UpdateSImage", DCInstance::UpdateSImage);
+    _state->set_function("GetFrameStats", [this](sol::this_state _this)
+    {
+        sol::state_view _state(_this);
+        auto _stats = _state.create_table();
 
-    // Absolute Functions
-    // === DEPRECATED, TO BE REMOVED ===
+        _stats["Hertz"] = framePacer.Hertz();
+        _stats["Frames"] = framePacer.FrameCount.load();
+        _stats["Late"] = framePacer.LateCount.load();
+        _stats["Skipped"] = framePacer.SkipCount.load();
+        _stats["CaughtUp"] = framePacer.CatchUpCount.load();
 
-    _state->set_function("ReadByteA",
-    sol::overload
-    (
-        [](uint64_t _addr) { return MemoryLib::ReadByte(_addr, true); }
-    ));
+        _stats["JitterMean"] = framePacer.JitterMean();
+        _stats["JitterMedian"] = framePacer.JitterPercentile(0.5);
+        _stats["Jitter99"] = framePacer.JitterPercentile(0.99);
+        _stats["JitterMax"] = framePacer.JitterMax.load();
 
-    _state->set_function("ReadShortA",
-    sol::overload
-    (
-        [](uint64_t _addr) { return MemoryLib::ReadShort(_addr, true); }
-    ));
+        auto _histogram = _state.create_table();
 
-    _state->set_function("ReadIntA",
-    sol::overload
-    (
-        [](uint64_t _addr) { return MemoryLib::ReadInt(_addr, true); }
-    ));
+        for (size_t i = 0; i < FramePacer::BucketCount; i++)
+            _histogram[i + 1] = framePacer.BucketList[i].load();
 
-    _state->set_function("ReadLongA",
-    sol::overload
-    (
-        [](uint64_t _addr) { return MemoryLib::ReadLong(_addr, true); }
-    ));
+        _stats["Histogram"] = _histogram;
 
-    _state->set_function("ReadFloatA",
-    sol::overload
-    (
-        [](uint64_t _addr) { return MemoryLib::ReadFloat(_addr, true); }
-    ));
+        // Only there if the engine follows the game's frame counter.
 
-    _state->set_function("ReadBooleanA",
-    sol::overload
-    (
-        [](uint64_t _addr) { return MemoryLib::ReadBool(_addr, true); }
-    ));
+        if (frameSync.Enabled())
+        {
+            _stats["Hertz"] = frameSync.Hertz();
+            _stats["GameFrames"] = frameSync.GameFrames.load();
+            _stats["Missed"] = frameSync.MissedFrames.load();
+            _stats["Duplicated"] = frameSync.DuplicateFrames.load();
+        }
 
-    _state->set_function("ReadArrayA",
-    sol::overload
-    (
-        [](uint64_t _addr, int _len) { return MemoryLib::ReadBytes(_addr, _len, true); }
-    ));
+        // How long the game sat idle, and how much slower we ticked for it.
 
-    _state->set_function("ReadStringA",
-    sol::overload
-    (
-        [](uint64_t _addr, int _len) { return MemoryLib::ReadString(_addr, _len, true); }
-    ));
+        auto _idle = _state.create_table();
 
-    // Writer Functions
+        _idle["State"] = IdleWatch::StateName(idleWatch.State);
+        _idle["Factor"] = idleWatch.Factor.load();
+        _idle["Active"] = idleWatch.StateSeconds(IdleWatch::IDLE_ACTIVE);
+        _idle["Still"] = idleWatch.StateSeconds(IdleWatch::IDLE_STILL);
+        _idle["Hidden"] = idleWatch.StateSeconds(IdleWatch::IDLE_HIDDEN);
 
-    _state->set_function("WriteByteA",
-    sol::overload
-    (
-        [](uint64_t _addr, uint8_t _val) { MemoryLib::WriteByte(_addr, _val, true); }
-    ));
+        _stats["Idle"] = _idle;
 
-    _state->set_function("WriteShortA",
-    sol::overload
-    (
-        [](uint64_t _addr, uint16_t _val) { MemoryLib::WriteShort(_addr, _val, true); }
-    ));
+        return _stats;
+    });
 
-    _state->set_function("WriteIntA",
-    sol::overload
-    (
-        [](uint64_t _addr, uint32_t _val) { MemoryLib::WriteInt(_addr, _val, true); }
-    ));
+    // How long the calling script's frames take, or the named script's.
+    // Times are in milliseconds, the I/O is per frame.
 
-    _state->set_function("WriteLongA",
-    sol::overload
-    (
-        [](uint64_t _addr, uint64_t _val) { MemoryLib::WriteLong(_addr, _val, true); }
-    ));
+    _state->set_function("GetProfile", [this](sol::this_state _this, sol::optional<string> _name) -> LuaObject
+    {
+        sol::state_view _state(_this);
+        LuaScript* _script = RunningScript;
 
-    _state->set_function("WriteFloatA",
-    sol::overload
-    (
-        [](uint64_t _addr, float _val) { MemoryLib::WriteFloat(_addr, _val, true); }
-    ));
+        if (_name)
+        {
+            _script = nullptr;
 
-    _state->set_function("WriteBooleanA",
-    sol::overload
-    (
-        [](uint64_t _addr, bool _val) { MemoryLib::WriteBool(_addr, _val, true); }
-    ));
+            for (auto _loaded : loadedScripts)
+                if (_loaded->scriptName == *_name)
+                    _script = _loaded;
+        }
 
-    _state->set_function("WriteArrayA",
-    sol::overload
-    (
-        [](uint64_t _addr, vector<uint8_t> _val) { MemoryLib::WriteBytes(_addr, _val, true); }
+        if (_script == nullptr)
+            return sol::lua_nil;
 
-    ));
+        auto& _profile = _script->frameProfile;
+        auto _stats = _state.create_table();
 
-    _state->set_function("WriteStringA",
-    sol::overload
-    (
-        [](uint64_t _addr, string _val) { MemoryLib::WriteString(_addr, _val, true); }
-    ));
+        _stats["Frames"] = _profile.FrameCount.load();
+        _stats["Mean"] = _profile.MeanTime() / 1000;
+        _stats["Reads"] = _profile.ReadCalls.load();
+        _stats["Writes"] = _profile.WriteCalls.load();
+        _stats["ReadBytes"] = _profile.ReadBytes.load();
+        _stats["WriteBytes"] = _profile.WriteBytes.load();
+
+        auto _window = _state.create_table();
+
+        _window["Frames"] = _profile.WindowFrames.load();
+        _window["Mean"] = _profile.WindowMean / 1000;
+        _window["Median"] = _profile.WindowMedian / 1000;
+        _window["High"] = _profile.WindowHigh / 1000;
+        _window["Max"] = _profile.WindowMax / 1000;
+        _window["Reads"] = _profile.WindowReads.load();
+        _window["Writes"] = _profile.WindowWrites.load();
+        _window["ReadBytes"] = _profile.WindowReadBytes.load();
+        _window["WriteBytes"] = _profile.WindowWriteBytes.load();
+
+        _stats["Window"] = _window;
+
+        return _stats;
+    });
+
+    _state->set_function("GetMemoryStats", [](sol::this_state _this)
+    {
+        sol::state_view _state(_this);
+
+        auto _report = MemoryStats::Current();
+        auto _stats = _state.create_table();
+
+        for (size_t i = 0; i < MemoryStats::OP_COUNT; i++)
+        {
+            auto& _op = _report.opList[i];
+            auto _table = _state.create_table();
+
+            _table["Calls"] = _op.total.calls;
+            _table["Bytes"] = _op.total.bytes;
+            _table["Failures"] = _op.total.failures;
+            _table["Fallbacks"] = _op.total.fallbacks;
+
+            _table["CallRate"] = _op.callRate;
+            _table["ByteRate"] = _op.byteRate;
+            _table["FailureRate"] = _op.failureRate;
+            _table["FallbackRate"] = _op.fallbackRate;
+
+            _table["Mean"] = _op.meanTime;
+            _table["Median"] = _op.medianTime;
+            _table["High"] = _op.highTime;
+
+            _stats[i == MemoryStats::OP_READ ? "Read" : "Write"] = _table;
+        }
+
+        _stats["Window"] = _report.windowLength;
+
+        return _stats;
+    });
+
+    // Wait Functions
+
+    lua_register(_state->lua_state(), "WaitFrames", WaitFrames);
+    lua_register(_state->lua_state(), "WaitMs", WaitMs);
+    lua_register(_state->lua_state(), "WaitUntil", WaitUntil);
+
+    _state->set_function("GetMemoryUsage", [](sol::this_state _this)
+    {
+        void* _user = nullptr;
+        auto _allocFunc = lua_getallocf(_this, &_user);
+
+        if (_allocFunc != &LuaAllocator::Allocate)
+            return std::make_tuple((size_t)lua_gc(_this, LUA_GCCOUNT) * 1024, (size_t)0);
+
+        auto _alloc = (LuaAllocator*)_user;
+        return std::make_tuple(_alloc->LiveBytes.load(), _alloc->PeakBytes.load());
+    });
+
+    // Discord Functions
+
+    _state->set_function("InitializeRPC", DCInstance::InitializeRPC);
+    _state->set_function("UpdateDetails", DCInstance::UpdateDetails);
+    _state->set_function("UpdateState", DCInstance::UpdateState);
+    _state->set_function("UpdateLImage", DCInstance::UpdateLImage);
+    _state->set_function("UpdateSImage", DCInstance::UpdateSImage);
 }
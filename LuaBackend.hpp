@@ -1,17 +1,32 @@
 #ifndef LUABACKEND
 #define LUABACKEND
 
+#include <set>
+#include <deque>
+#include <queue>
+#include <chrono>
 #include <iostream>
 #include <sol.hpp>
 
 #include <CRC32.h>
-#include <Console.hpp>
+#include <MessageSink.hpp>
 
 #include <MemoryLib.hpp>
 #include <DCInstance.hpp>
+#include <LuaMemoryLib.hpp>
+#include <LuaAllocator.hpp>
+#include <FrameSync.hpp>
+#include <IdleWatch.hpp>
+#include <FramePacer.hpp>
+#include <TimingWheel.hpp>
+#include <WorkerPool.hpp>
+#include <ScriptProfile.hpp>
+#include <ScriptSampler.hpp>
+#include <TimelineTrace.hpp>
+#include <MemoryStats.hpp>
 #include <Operator32Lib.hpp>
 
-#include <QDirIterator>
+#include <filesystem>
 
 using namespace sol;
 using namespace std;
@@ -22,24 +37,143 @@ using LuaObject = sol::object;
 using LuaFunction = sol::safe_function;
 using LuaResult = sol::protected_function_result;
 
+using LuaClock = std::chrono::steady_clock;
+
 class LuaBackend
 {
 	public:
-		struct LuaScript
+        enum WaitType { WAIT_NONE, WAIT_FRAMES, WAIT_TIME, WAIT_VALUE };
+
+		struct LuaVM
 		{
+			LuaAllocator luaAlloc;
 			LuaState luaState;
+
+            bool gcGenerational = false;
+            size_t gcBaseline = 0;
+            atomic<float> gcTime = 0;
+
+            // In shared mode, what the scripts' _ENV falls back to: the globals,
+            // with every library table behind a read-only proxy.
+
+            sol::table sharedView;
+
+            LuaVM(size_t MemoryLimit = 0) : luaAlloc(MemoryLimit), luaState(&sol::default_at_panic, &LuaAllocator::Allocate, &luaAlloc) { }
+		};
+
+		struct LuaScript
+		{
+            // In shared mode, every script points to the same VM and "luaGlobals"
+            // is the script's own _ENV. Otherwise, it's just the VM's globals.
+
+            shared_ptr<LuaVM> luaVM;
+            sol::table luaGlobals;
+
             LuaResult parseResult;
 			LuaFunction initFunction;
 			LuaFunction frameFunction;
 
-            QString scriptPath;
+            string scriptPath;
+            string scriptName;
+            size_t scriptIndex = 0;
+
+            // The script's name, for the timeline, which may outlive it.
+
+            const char* traceName = "_OnFrame";
+
+            // What the script has to run after in the same tick, from LUAGUI_AFTER,
+            // and the memory it reads and writes, from LUAGUI_READS and LUAGUI_WRITES.
+            // "graphNext" is every script which has to wait on this one, directly or not.
+
+            vector<string> afterList;
+            vector<pair<uint64_t, uint64_t>> readList;
+            vector<pair<uint64_t, uint64_t>> writeList;
+
+            vector<LuaScript*> graphNext;
+            size_t graphRank = 0;
+            size_t runSlot = SIZE_MAX;
+
+            // The script's own tick rate, from LUAGUI_HZ or SetHertz.
+            // Zero means it runs at the backend's rate.
+
+            float frameLimit = 0;
+            double frameDeadline = 0;
+            uint64_t frameCount = 0;
+
+            // _OnFrame runs inside this coroutine, so that it can
+            // sleep with WaitFrames/WaitMs/WaitUntil.
+
+            sol::thread frameThread;
+            bool frameSuspended = false;
+
+            WaitType waitType = WAIT_NONE;
+            uint64_t waitFrame = 0;
+            LuaClock::time_point waitTime;
+
+            uint64_t waitAddress = 0;
+            uint64_t waitValue = 0;
+            int waitSize = 1;
+            bool waitAbsolute = false;
+
+            // How long a single _OnFrame call may run for, from LUAGUI_BUDGET.
+            // Zero means the backend-wide BudgetTime applies.
+
+            float budgetTime = 0;
+            uint64_t budgetUsed = 0;
+            LuaClock::time_point budgetDeadline;
+
+            bool frameOverrun = false;
+            string overrunError;
+            int overrunCount = 0;
+
+            // What the last _OnFrame call returned. In pool mode, the calls
+            // run on the workers, and the results are handled after the barrier.
+
+            bool frameResult = true;
+            string frameError;
+
+            // How long its _OnFrame calls take, and what they read and write.
+
+            ScriptProfile frameProfile;
+
+            // Which lines those calls spend their time on, while it's on.
+
+            ScriptSampler frameSampler;
+
+            // A disabled script stays loaded, but its frames are skipped.
+
+            bool frameEnabled = true;
 		};
 
         float frameLimit;
+        size_t memoryLimit;
         string scrPath;
+        uint64_t baseAddress;
+
+        bool sharedMode;
+        size_t sharedBaseline;
+
+        // The scripts which run. The backend owns every script it loaded,
+        // this, and "stoppedScripts" below, only point into them.
 
 		std::vector<LuaScript*> loadedScripts;
 
+        // Scripts which RunFrame took out of "loadedScripts" because of an error,
+        // for whoever drives the backend to pick up.
+
+        std::vector<LuaScript*> stoppedScripts;
+
+        static int WaitFrames(lua_State*);
+        static int WaitMs(lua_State*);
+        static int WaitUntil(lua_State*);
+
+        // What the Wait functions yield first, so ResumeFrame can tell them
+        // apart from any other yield. Only its address matters.
+
+        static inline char WaitTag = 0;
+
+        static void BudgetHook(lua_State*, lua_Debug*);
+
         static int ExceptionHandle(lua_State* luaState, sol::optional<const std::exception&> thrownException, sol::string_view)
 		{
             const std::exception _ex = *thrownException;
@@ -48,12 +182,121 @@ class LuaBackend
 
 		void SetFunctions(LuaState*);
 		void LoadScripts(const char*, uint64_t);
+        void ReloadScripts(const set<size_t>&);
+        void ReleaseRetired();
+        void InitScripts();
+        void PrintMessage(const string&, int);
+
+        static inline thread_local LuaScript* RunningScript = nullptr;
+
+        // The budget of every _OnFrame call, in milliseconds and in Lua
+        // instructions. Zero, the default, means no limit, unless the script
+        // asks for one with LUAGUI_BUDGET. A script which overruns it
+        // OverrunDemote times has its rate halved, OverrunLimit times is stopped.
+
+        static inline float BudgetTime = 0;
+        static inline uint64_t BudgetInstructions = 0;
+
+        static inline int OverrunDemote = 3;
+        static inline int OverrunLimit = 9;
+
+        // Whether every _OnFrame call is timed and its I/O counted, and how
+        // often, in seconds, the slowest scripts are listed in the console.
+        // Zero never lists them.
+
+        static inline bool ProfileFrames = true;
+        static inline float ProfileInterval = 60;
+
+        static string ProfileSummary(const vector<LuaScript*>&, size_t);
+        static string MemorySummary();
+
+        // How the engine thread catches up after a tick which ran long.
+
+        static inline FramePacer::PacePolicy PacePolicy = FramePacer::PACE_SKIP;
+        static inline uint32_t CatchUpLimit = 3;
+
+        FramePacer framePacer;
+
+        // If the game has a frame counter, the engine ticks on every game frame
+        // instead. Scripts without a rate of their own then run once per frame.
+
+        FrameSync frameSync;
+
+        // Slows the engine thread down while the game sits idle. At most
+        // IdleMaxFactor times slower, 1 turns it off.
+
+        static inline uint32_t IdleMaxFactor = 8;
+
+        IdleWatch idleWatch;
+
+        // InputTime is in milliseconds since the first frame, and only ever given
+        // when replaying a trace at full speed. Otherwise, it's the clock.
+
+        void RunFrame(double InputTime = -1);
+        bool BuildGraph();
+        void EnablePool(size_t);
+        size_t PoolSize();
+        float TickInterval();
+        float ScriptInterval(LuaScript*);
+        bool FrameSynced(LuaScript*);
+
+        static bool ResumeFrame(LuaScript*, string&);
+        static bool IsWaiting(LuaScript*);
+        static void PrintError(MessageSink*, LuaScript*, const string&);
+        static bool HandleOverrun(MessageSink*, LuaScript*, float);
+
+        float CollectGarbage(LuaClock::time_point);
+        static float CollectGarbage(LuaVM*, LuaClock::time_point);
 
         LuaBackend();
-        LuaBackend(const char*, uint64_t, Console*);
+        LuaBackend(const char*, uint64_t, MessageSink*, size_t MemoryLimit = 0, bool SharedMode = false);
+        ~LuaBackend();
+
+        LuaBackend(const LuaBackend&) = delete;
+        LuaBackend& operator=(const LuaBackend&) = delete;
 
     private:
-        Console* _outputConsole;
+        MessageSink* _outputConsole;
+        size_t _gcCursor = 0;
+
+        shared_ptr<LuaVM> _sharedVM;
+
+        // Every script of the last load, and those of every reload before it
+        // which whoever drives the backend did not hear of yet. It may still
+        // hold those, so they only go away once it says so with ReleaseRetired.
+
+        vector<unique_ptr<LuaScript>> _scriptStore;
+        deque<vector<unique_ptr<LuaScript>>> _retiredStore;
+
+        // Every script with a frame function sits in the wheel until its
+        // next frame is due, be it because of its tick rate or because
+        // it is sleeping. Only the ones which are due are ever touched.
+
+        LuaClock::time_point _startTime;
+        bool _frameStarted = false;
+
+        // The wheel turns in tenths of a millisecond, so fractional
+        // rates like 60Hz land where they should.
+
+        static constexpr double WheelScale = 10;
+        static uint64_t WheelTick(double InputTime) { return (uint64_t)(InputTime * WheelScale); }
+
+        TimingWheel<LuaScript*> _frameWheel;
+        vector<LuaScript*> _dueList;
+        vector<LuaScript*> _runList;
+        vector<vector<size_t>> _runNext;
+
+        // In pool mode, the due scripts of a tick are fanned out to the
+        // workers, and the tick ends once all of them are done.
+
+        unique_ptr<WorkerPool> _workerPool;
+
+        void ScheduleFrame(LuaScript*, double);
+        static void ReleaseScripts(vector<unique_ptr<LuaScript>>&);
+        static void ReadRanges(const LuaObject&, vector<pair<uint64_t, uint64_t>>&);
+
+        shared_ptr<LuaVM> CreateVM(const char*, uint64_t);
+        static sol::table SharedView(LuaState&);
 };
 
 #endif
@@ -0,0 +1,283 @@
+#include "LuaEngine.hpp"
+
+LuaEngine::LuaEngine(LuaBackend* InputBackend)
+{
+    _backend = InputBackend;
+
+    for (auto _script : _backend->loadedScripts)
+        _wantedList.insert(_script->scriptIndex);
+
+    _engineThread = std::thread(&LuaEngine::EngineLoop, this);
+}
+
+LuaEngine::~LuaEngine()
+{
+    Post({ CMD_STOP });
+    _engineThread.join();
+}
+
+void LuaEngine::Post(Command InputCommand)
+{
+    // The engine drains the queue every tick, so it is never full for long.
+
+    while (!_commandQueue.Push(InputCommand))
+        this_thread::yield();
+}
+
+bool LuaEngine::Poll(Event& OutEvent)
+{
+    {
+        lock_guard<std::mutex> _lock(_lifeMutex);
+
+        if (!_lifeQueue.empty())
+        {
+            OutEvent = _lifeQueue.front();
+            _lifeQueue.pop_front();
+
+            return true;
+        }
+    }
+
+    return _eventQueue.Pop(OutEvent);
+}
+
+void LuaEngine::PostEvent(Event InputEvent)
+{
+    // Never wait on the GUI. If it has not picked up 1024 statistics,
+    // it is not going to miss one more. Everything else is kept.
+
+    if (InputEvent.eventType == EVT_JITTER)
+    {
+        _eventQueue.Push(InputEvent);
+        return;
+    }
+
+    lock_guard<std::mutex> _lock(_lifeMutex);
+    _lifeQueue.push_back(InputEvent);
+}
+
+bool LuaEngine::HandleCommands()
+{
+    Command _command;
+
+    while (_commandQueue.Pop(_command))
+    {
+        switch (_command.commandType)
+        {
+            case CMD_START:
+            {
+                if (_running)
+                    break;
+
+                _backend->InitScripts();
+
+                for (auto _script : _backend->loadedScripts)
+                    PostEvent({ EVT_SCRIPT_STARTED, _script });
+
+                _running = true;
+                _jitterStart = LuaClock::now();
+                _profileStart = _jitterStart;
+
+                _backend->framePacer.Reset();
+
+                if (_backend->frameSync.Enabled())
+                    _backend->frameSync.Reset();
+
+                if (_backend->idleWatch.Enabled())
+                    _backend->idleWatch.Reset();
+
+                break;
+            }
+
+            case CMD_STOP:
+                return false;
+
+            case CMD_RELOAD:
+            {
+                PostEvent({ EVT_RELOADED });
+
+                _backend->ReloadScripts(_wantedList);
+                _backend->InitScripts();
+
+                for (auto _script : _backend->loadedScripts)
+                    PostEvent({ EVT_SCRIPT_STARTED, _script });
+
+                _backend->framePacer.Reset();
+
+                if (_backend->frameSync.Enabled())
+                    _backend->frameSync.Reset();
+
+                if (_backend->idleWatch.Enabled())
+                    _backend->idleWatch.Reset();
+
+                break;
+            }
+
+            case CMD_TOGGLE:
+            {
+                if (_command.scriptEnabled)
+                    _wantedList.insert(_command.scriptIndex);
+
+                else
+                    _wantedList.erase(_command.scriptIndex);
+
+                bool _found = false;
+
+                for (auto _script : _backend->loadedScripts)
+                {
+                    if (_script->scriptIndex == _command.scriptIndex)
+                    {
+                        _script->frameEnabled = _command.scriptEnabled;
+                        _found = true;
+                    }
+                }
+
+                // Scripts which were not loaded at the start need a reload to run.
+
+                if (!_found && _command.scriptEnabled)
+                    _backend->PrintMessage("This script was not loaded. Reload the engine to run it.<br>", 2);
+
+                break;
+            }
+
+            // Whoever polls the events is done with the scripts of the
+            // oldest reload it heard of. Until then, events point into them.
+
+            case CMD_RELEASE:
+                _backend->ReleaseRetired();
+                break;
+        }
+    }
+
+    return true;
+}
+
+void LuaEngine::EngineLoop()
+{
+    TimelineTrace::NameThread("Engine");
+
+    auto& _pacer = _backend->framePacer;
+
+    while (HandleCommands())
+    {
+        if (!_running)
+        {
+            this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        // Following the game? Then wait for it to draw a frame. If it does not
+        // for a while, see to the commands and come back to it.
+
+        auto _frameSync = _backend->frameSync.Enabled();
+
+        if (_frameSync && !_backend->frameSync.WaitFrame())
+            continue;
+
+        auto _interval = _frameSync ? (float)_backend->frameSync.FramePeriod() : _backend->TickInterval();
+
+        // Sitting idle? Then tick slower, by skipping ticks, or game frames if we
+        // follow them. The watch is still looked at on every one of them, so
+        // the scripts run again at most one tick after the game wakes up.
+
+        auto _idleFactor = _backend->idleWatch.Enabled() ? _backend->idleWatch.Update() : 1;
+
+        if (++_idleCount % _idleFactor != 0)
+        {
+            if (!_frameSync)
+            {
+                TimelineTrace::Span _span("Wait", "scheduler", _idleFactor, "idleFactor");
+                _pacer.Wait(_interval);
+            }
+
+            continue;
+        }
+
+        auto _frameStart = LuaClock::now();
+
+        {
+            TimelineTrace::Span _span("Tick", "scheduler", _backend->loadedScripts.size(), "scripts");
+            _backend->RunFrame();
+        }
+
+        for (auto _script : _backend->stoppedScripts)
+            PostEvent({ EVT_SCRIPT_STOPPED, _script });
+
+        _backend->stoppedScripts.clear();
+
+        // Collect garbage in whatever time is left before the next frame.
+        // Leave a quarter of the frame as headroom.
+
+        auto _frameSlack = std::chrono::duration<float, std::milli>(_interval * 0.75F);
+        {
+            TimelineTrace::Span _span("GC", "scheduler");
+            _backend->CollectGarbage(_frameStart + std::chrono::duration_cast<LuaClock::duration>(_frameSlack));
+        }
+
+        ReportJitter();
+        ReportProfile();
+
+        if (!_frameSync)
+        {
+            TimelineTrace::Span _span("Wait", "scheduler", _idleFactor, "idleFactor");
+            _pacer.Wait(_interval);
+        }
+    }
+
+    PostEvent({ EVT_STOPPED });
+}
+
+void LuaEngine::ReportJitter()
+{
+    auto _timeNow = LuaClock::now();
+
+    if (_timeNow - _jitterStart < std::chrono::seconds(1))
+        return;
+
+    auto& _pacer = _backend->framePacer;
+
+    Event _event = { EVT_JITTER };
+
+    _event.frameHertz = _pacer.Hertz();
+    _event.jitterMedian = _pacer.JitterPercentile(0.5);
+    _event.jitterHigh = _pacer.JitterPercentile(0.99);
+    _event.jitterMax = _pacer.JitterMax;
+    _event.lateCount = _pacer.LateCount;
+
+    auto& _sync = _backend->frameSync;
+
+    if (_sync.Enabled())
+    {
+        _event.frameSync = true;
+        _event.frameHertz = _sync.Hertz();
+        _event.missedCount = _sync.MissedFrames;
+        _event.duplicateCount = _sync.DuplicateFrames;
+    }
+
+    _event.idleFactor = _backend->idleWatch.Factor;
+    _event.idleState = _backend->idleWatch.State;
+
+    PostEvent(_event);
+
+    _jitterStart = _timeNow;
+}
+
+void LuaEngine::ReportProfile()
+{
+    auto _interval = LuaBackend::ProfileInterval;
+
+    if (_interval <= 0 || !LuaBackend::ProfileFrames)
+        return;
+
+    auto _timeNow = LuaClock::now();
+
+    if (_timeNow - _profileStart < std::chrono::duration<float>(_interval))
+        return;
+
+    auto _summary = LuaBackend::ProfileSummary(_backend->loadedScripts, 5);
+
+    if (!_summary.empty())
+        _backend->PrintMessage(_summary, 0);
+
+    _profileStart = _timeNow;
+}
@@ -0,0 +1,94 @@
+#ifndef LUAENGINE_H
+#define LUAENGINE_H
+
+#include <set>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <RingQueue.hpp>
+#include <LuaBackend.hpp>
+
+// Runs a backend's frames on a thread of its own, so that nothing the GUI
+// does can hold up a tick, and no tick can hold up the GUI. The GUI only ever
+// talks to it through queues: commands going in, events coming out. Only the
+// events which must never be lost, and are rare, take a lock.
+
+class LuaEngine
+{
+    public:
+        enum CommandType { CMD_START, CMD_STOP, CMD_RELOAD, CMD_TOGGLE, CMD_RELEASE };
+        enum EventType { EVT_SCRIPT_STARTED, EVT_SCRIPT_STOPPED, EVT_RELOADED, EVT_STOPPED, EVT_JITTER };
+
+        struct Command
+        {
+            CommandType commandType;
+
+            size_t scriptIndex = 0;
+            bool scriptEnabled = false;
+        };
+
+        struct Event
+        {
+            EventType eventType;
+            LuaBackend::LuaScript* eventScript = nullptr;
+
+            // How well the ticks kept to their rate so far. The jitter is how late
+            // they started, in microseconds, and the percentiles are bucket edges.
+
+            float frameHertz = 0;
+            float jitterMedian = 0;
+            float jitterHigh = 0;
+            float jitterMax = 0;
+            uint64_t lateCount = 0;
+
+            // Same, but when following the game's frame counter.
+
+            bool frameSync = false;
+            uint64_t missedCount = 0;
+            uint64_t duplicateCount = 0;
+
+            // How many times slower we tick because the game sits idle.
+
+            uint32_t idleFactor = 1;
+            IdleWatch::IdleState idleState = IdleWatch::IDLE_ACTIVE;
+        };
+
+        LuaEngine(LuaBackend*);
+        ~LuaEngine();
+
+        void Post(Command);
+        bool Poll(Event&);
+
+    private:
+        LuaBackend* _backend;
+
+        RingQueue<Command, 256> _commandQueue;
+        RingQueue<Event, 1024> _eventQueue;
+
+        // The scripts starting and stopping, and the reloads. Losing one of
+        // these would leave the GUI with the wrong scripts, or the backend
+        // with old ones it never hears are released, so they never drop.
+
+        std::mutex _lifeMutex;
+        deque<Event> _lifeQueue;
+
+        std::thread _engineThread;
+
+        // Everything below belongs to the engine thread.
+
+        bool _running = false;
+        set<size_t> _wantedList;
+
+        LuaClock::time_point _jitterStart;
+        LuaClock::time_point _profileStart;
+        uint64_t _idleCount = 0;
+
+        void EngineLoop();
+        bool HandleCommands();
+        void ReportJitter();
+        void ReportProfile();
+        void PostEvent(Event);
+};
+
+#endif // LUAENGINE_H
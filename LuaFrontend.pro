@@ -2,8 +2,15 @@ QT += core gui widgets network
 
 CONFIG += c++17
 
-LIBS += -L$$PWD/libraries/ -llua -ldiscord-rpc
-PRE_TARGETDEPS += $$PWD/libraries/discord-rpc.lib
+# The engine itself lives in engine/LuaEngineLib.pro, build that first.
+
+LIBS += -L$$PWD/libraries/ -lluaengine -llua -ldiscord-rpc
+
+win32: LIBS += -lwinmm
+unix: LIBS += -lpthread -ldl
+
+win32: PRE_TARGETDEPS += $$PWD/libraries/luaengine.lib $$PWD/libraries/discord-rpc.lib
+unix: PRE_TARGETDEPS += $$PWD/libraries/libluaengine.a $$PWD/libraries/libdiscord-rpc.a
 
 RC_ICONS = resources/iconMain.ico
 RC_FILE = Windows.rc
@@ -13,23 +20,26 @@ SOURCES += \
     LuaThread.cpp \
     Main.cpp \
     Console.cpp \
-    LuaBackend.cpp \
     MainWindow.cpp \
+    ProfileWindow.cpp \
     WaitDialog.cpp \
 
 HEADERS += \
     AboutFrontend.hpp \
     Console.hpp \
+    LuaEngine.hpp \
     LuaThread.hpp \
     WaitDialog.hpp \
     LuaBackend.hpp \
     MainWindow.hpp \
+    ProfileWindow.hpp \
     version.h
 
 FORMS += \
     AboutFrontend.ui \
     Console.ui \
     MainWindow.ui \
+    ProfileWindow.ui \
     WaitDialog.ui
 
 INCLUDEPATH += \
@@ -0,0 +1,33 @@
+TEMPLATE = subdirs
+
+# Builds the engine library first, then everything linking to it.
+
+SUBDIRS += \
+    engine \
+    frontend \
+    cli \
+    tickbench \
+    bindingbench \
+    loadbench \
+    microbench \
+    latencybench
+
+engine.file = engine/LuaEngineLib.pro
+
+frontend.file = LuaFrontend.pro
+frontend.depends = engine
+
+cli.file = cli/FrontendCLI.pro
+cli.depends = engine
+
+tickbench.file = benchmarks/TickBench.pro
+bindingbench.file = benchmarks/BindingBench.pro
+
+loadbench.file = benchmarks/LoadBench.pro
+loadbench.depends = engine
+
+microbench.file = benchmarks/MicroBench.pro
+microbench.depends = engine
+
+latencybench.file = benchmarks/LatencyBench.pro
+latencybench.depends = engine
@@ -4,10 +4,19 @@ LuaThread::LuaThread(Console* consoleInput)
 {
     _thread = new QThread(this);
     _runTimer = new QTimer(this);
+    _runTimer->setTimerType(Qt::PreciseTimer);
 
     _console = consoleInput;
 }
 
+LuaThread::~LuaThread()
+{
+    // The script must be done running before
+    // anything, including us, can go away.
+
+    stop();
+}
+
 void LuaThread::start()
 {
     this->moveToThread(_thread);
@@ -15,6 +24,7 @@ void LuaThread::start()
     _runTimer->moveToThread(_thread);
 
     connect(_thread, SIGNAL(started()), this, SLOT(startEvent()));
+    connect(_thread, SIGNAL(finished()), _runTimer, SLOT(stop()));
     connect(_runTimer, SIGNAL(timeout()), this, SLOT(runEvent()));
 
     _thread->start();
@@ -22,33 +32,58 @@ void LuaThread::start()
 
 void LuaThread::stop()
 {
-    _runTimer->stop();
+    // The timer lives on the script's thread, so it's stopped
+    // there, once the thread is done. Wait for that to happen.
+
     _thread->exit();
+    _thread->wait();
 }
 
 void LuaThread::startEvent()
 {
-    _runTimer->start(runInterval);
+    TimelineTrace::NameThread(exeScript->traceName);
+
+    _runTimer->start(qRound(exeScript->frameLimit > 0 ? exeScript->frameLimit : runInterval.load()));
 }
 
 void LuaThread::runEvent()
 {
-    if (exeScript->frameFunction)
+    auto _frameStart = LuaClock::now();
+
+    exeScript->frameCount++;
+
+    if (exeScript->frameFunction && !LuaBackend::IsWaiting(exeScript))
     {
-        auto _result = exeScript->frameFunction();
+        string _error;
 
-        if (!_result.valid())
+        if (!LuaBackend::ResumeFrame(exeScript, _error))
         {
-            sol::error _err = _result;
+            LuaBackend::PrintError(_console, exeScript, _error);
 
-            auto _errStr = QString(_err.what());
-            _console->printMessage(_errStr + "<br>", 3);
+            auto _interval = exeScript->frameLimit > 0 ? exeScript->frameLimit : runInterval.load();
 
-            _runTimer->stop();
-            _thread->exit();
+            if (!exeScript->frameOverrun || !LuaBackend::HandleOverrun(_console, exeScript, _interval))
+            {
+                _runTimer->stop();
+                _thread->exit();
+
+                return;
+            }
         }
     }
 
-    if (_runTimer->interval() != runInterval)
-        _runTimer->setInterval(runInterval);
+    // The script's own rate wins over the backend's rate.
+
+    auto _interval = exeScript->frameLimit > 0 ? exeScript->frameLimit : runInterval.load();
+    auto _frameSlack = std::chrono::duration<float, std::milli>(_interval * 0.75F);
+
+    {
+        TimelineTrace::Span _span("GC", "scheduler");
+        LuaBackend::CollectGarbage(exeScript->luaVM.get(), _frameStart + std::chrono::duration_cast<LuaClock::duration>(_frameSlack));
+    }
+
+    // QTimer only does whole milliseconds, so round rather than truncate.
+
+    if (_runTimer->interval() != qRound(_interval))
+        _runTimer->setInterval(qRound(_interval));
 }
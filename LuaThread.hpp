@@ -11,10 +11,14 @@ class LuaThread : public QObject
 {
     Q_OBJECT
     public:
-        int runInterval;
+        // The backend's rate, in milliseconds. The GUI may change it
+        // while the script's thread reads it.
+
+        atomic<float> runInterval = 0;
         LuaBackend::LuaScript* exeScript;
 
         LuaThread(Console*);
+        ~LuaThread();
 
         void start();
         void stop();
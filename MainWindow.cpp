@@ -7,23 +7,43 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWi
 
     ui->setupUi(this);
 
-    QStringList _labelList = { "Title", "Author(s)", "Description" };
+    QStringList _labelList = { "Title", "Author(s)", "Description", "Memory", "GC Time" };
     ui->scriptWidget->setHeaderLabels(_labelList);
     ui->scriptWidget->setColumnWidth(0, 128);
 
+    TimelineTrace::NameThread("GUI");
+
     // VARIABLE INITIALIZATION
 
     _autoBool = false;
     _threadBool = false;
+    _sharedBool = false;
+    _poolBool = false;
+    _traceBool = false;
     _darkPalBool = false;
     _consoleBool = false;
 
+    _memoryLimit = 0;
+    _poolWorkers = 0;
+
+    _engine = nullptr;
+    _statCount = 0;
+    _recorder = nullptr;
+
+    _dumpTotal = 0;
+    _dumpProgress = 0;
+    _dumpFinished = false;
+    _dumpCancel = false;
+
     _aboutDiag = new AboutFrontend(this);
+    _profileWindow = new ProfileWindow(this);
 
     _console = new Console(this);
     _waitWindow = new WaitDialog(this);
 
     _runTimer = new QTimer(this);
+    _statTimer = new QTimer(this);
+    _dumpTimer = new QTimer(this);
     latchTimer = new QTimer(this);
 
     _runTimer->moveToThread(this->thread());
@@ -34,12 +54,22 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWi
     // SIGNAL CONSTRUCTOR
 
     connect(_runTimer, SIGNAL(timeout()), this, SLOT(runEvent()));
+    connect(_statTimer, SIGNAL(timeout()), this, SLOT(statEvent()));
+    connect(_dumpTimer, SIGNAL(timeout()), this, SLOT(dumpProgressEvent()));
     connect(latchTimer, SIGNAL(timeout()), this, SLOT(latchEvent()));
 
     connect(ui->actionDark, SIGNAL(triggered()), this, SLOT(darkToggle()));
     connect(ui->actionAutoReload, SIGNAL(triggered()), this, SLOT(autoToggle()));
     connect(ui->actionConsole, SIGNAL(triggered()), this, SLOT(consoleToggle()));
     connect(ui->actionThreading, SIGNAL(triggered()), this, SLOT(threadToggle()));
+    connect(ui->actionShared, SIGNAL(triggered()), this, SLOT(sharedToggle()));
+    connect(ui->actionPool, SIGNAL(triggered()), this, SLOT(poolToggle()));
+    connect(ui->actionTrace, SIGNAL(triggered()), this, SLOT(traceToggle()));
+    connect(ui->actionTimeline, SIGNAL(triggered()), this, SLOT(timelineToggle()));
+    connect(ui->actionSaveTimeline, SIGNAL(triggered()), this, SLOT(timelineEvent()));
+    connect(ui->actionStats, SIGNAL(triggered()), this, SLOT(frameStatsEvent()));
+    connect(ui->actionProfile, SIGNAL(triggered()), this, SLOT(profileEvent()));
+    connect(ui->actionDump, SIGNAL(triggered()), this, SLOT(dumpEvent()));
 
     connect(ui->actionStop, SIGNAL(triggered()), this, SLOT(stopEvent()));
     connect(ui->actionStart, SIGNAL(triggered()), this, SLOT(startEvent()));
@@ -47,6 +77,7 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWi
 
     connect(ui->gameWidget, SIGNAL(currentRowChanged(int)), this, SLOT(gameClickEvent(int)));
     connect(ui->scriptWidget, SIGNAL(itemDoubleClicked(QTreeWidgetItem*,int)), this, SLOT(scriptClickEvent(QTreeWidgetItem*,int)));
+    connect(ui->scriptWidget, SIGNAL(itemChanged(QTreeWidgetItem*,int)), this, SLOT(scriptCheckEvent(QTreeWidgetItem*,int)));
 
     QAction *aboutAction = ui->mainMenu->addAction("About");
     connect(aboutAction, SIGNAL(triggered()), this, SLOT(showAbout()));
@@ -98,12 +129,65 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWi
         auto _darkPalTemp = toml::find(_prefTable, "darkPalBool").as_boolean();
         auto _consoleTemp = toml::find(_prefTable, "consoleBool").as_boolean();
 
+        // Optional. The per-script memory cap in megabytes, 0 means no cap.
+
+        _memoryLimit = toml::find_or<size_t>(_prefTable, "memoryLimit", 0) * 1024 * 1024;
+
+        auto _sharedTemp = toml::find_or<bool>(_prefTable, "sharedBool", false);
+        auto _poolTemp = toml::find_or<bool>(_prefTable, "poolBool", false);
+
+        // Optional. How many workers the pool has, 0 means one per core.
+
+        _poolWorkers = toml::find_or<size_t>(_prefTable, "poolWorkers", 0);
+
+        // Optional. How long a single _OnFrame call may run for, in milliseconds
+        // and in Lua instructions, before it is aborted. 0 means no limit.
+
+        LuaBackend::BudgetTime = toml::find_or<float>(_prefTable, "frameBudget", LuaBackend::BudgetTime);
+        LuaBackend::BudgetInstructions = toml::find_or<uint64_t>(_prefTable, "instructionBudget", LuaBackend::BudgetInstructions);
+
+        // Optional. Whether a tick which ran long is followed by the missed ticks
+        // back to back ("catchup"), or they are dropped ("skip", the default).
+
+        auto _paceTemp = toml::find_or<std::string>(_prefTable, "framePolicy", "skip");
+
+        LuaBackend::PacePolicy = _paceTemp == "catchup" ? FramePacer::PACE_CATCHUP : FramePacer::PACE_SKIP;
+        LuaBackend::CatchUpLimit = toml::find_or<uint32_t>(_prefTable, "catchUpLimit", LuaBackend::CatchUpLimit);
+
+        // Optional. How many times slower the engine may tick while the game sits idle, 1 means never.
+
+        LuaBackend::IdleMaxFactor = toml::find_or<uint32_t>(_prefTable, "idleMaxFactor", LuaBackend::IdleMaxFactor);
+
+        // Optional. Whether every script's frames are timed, and how often the
+        // slowest scripts are listed in the console, in seconds. 0 means never.
+
+        LuaBackend::ProfileFrames = toml::find_or<bool>(_prefTable, "frameProfile", LuaBackend::ProfileFrames);
+        LuaBackend::ProfileInterval = toml::find_or<float>(_prefTable, "profileInterval", LuaBackend::ProfileInterval);
+
+        // Optional. How much of a script's running time a sample stands for, in microseconds.
+
+        ScriptSampler::SamplePeriod = toml::find_or<uint32_t>(_prefTable, "samplePeriod", ScriptSampler::SamplePeriod);
+
+        // Optional. How many spans the timeline keeps for every thread.
+
+        TimelineTrace::Capacity = toml::find_or<size_t>(_prefTable, "timelineCapacity", TimelineTrace::Capacity);
+
+        // Optional. Whether every read and write of the game's memory is timed. They are counted regardless.
+
+        MemoryStats::Timed = toml::find_or<bool>(_prefTable, "memoryTiming", true);
+
         if (_autoTemp)
             autoToggle();
 
         if (_threadTemp)
             threadToggle();
 
+        if (_sharedTemp)
+            sharedToggle();
+
+        if (_poolTemp)
+            poolToggle();
+
         if (_darkPalTemp)
             darkToggle();
 
@@ -134,7 +218,17 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWi
     parseScript();
 }
 
-MainWindow::~MainWindow() { delete ui; }
+MainWindow::~MainWindow()
+{
+    if (_dumpThread.joinable())
+    {
+        _dumpCancel = true;
+        _dumpThread.join();
+    }
+
+    stopEngine();
+    delete ui;
+}
 
 // GENERAL FUNCTIONS
 
@@ -193,6 +287,17 @@ int MainWindow::parseGame()
 
             _currGame.offset = _tmpOffset.toULong(nullptr, 16);
             _currGame.baseAddress = _tmpAddress.toULong(nullptr, 16);
+
+            // Optional. Where the game keeps its frame counter, and how wide it is.
+
+            auto _tmpCounter = QString::fromStdString(toml::find_or<std::string>(_table, "FrameCounter", "0"));
+
+            _currGame.frameCounter = _tmpCounter.toULongLong(nullptr, 16);
+            _currGame.counterSize = toml::find_or<int>(_table, "FrameCounterSize", 4);
+
+            // Optional. Regions which only stay the same while the game sits idle, as "ADDRESS:SIZE".
+
+            _currGame.idleRegions = parseIdleRegions(toml::find_or<std::vector<std::string>>(_table, "IdleWatch", std::vector<std::string>()));
         }
 
         auto _name = toml::find(_table, "Title").as_string().str;
@@ -205,6 +310,23 @@ int MainWindow::parseGame()
     return 0;
 }
 
+QList<IdleWatch::Region> MainWindow::parseIdleRegions(const std::vector<std::string>& InputList)
+{
+    QList<IdleWatch::Region> _return;
+
+    for (auto& _entry : InputList)
+    {
+        auto _split = QString::fromStdString(_entry).split(':');
+
+        if (_split.size() != 2)
+            continue;
+
+        _return.append({ _split[0].toULongLong(nullptr, 16), _split[1].toULongLong(nullptr, 16) });
+    }
+
+    return _return;
+}
+
 int MainWindow::parseScript()
 {
     // Clear the script widget first.
@@ -233,7 +355,7 @@ int MainWindow::parseScript()
     // This backend runs nothing. It's just there
     // to check the scripts.
 
-    backendFake = new LuaBackend(_path.toStdString().c_str(), 0x00000000, _console);
+    backendFake = make_unique<LuaBackend>(_path.toStdString().c_str(), 0x00000000, _console);
 
     // Fun. Do the below for every script:
 
@@ -248,10 +370,10 @@ int MainWindow::parseScript()
         // Make the tree item have the default
         // values for the script.
 
-        string _luaName = _script->luaState["LUA_NAME"];
+        string _luaName = _script->luaGlobals["LUA_NAME"];
 
         _item->setData(0, 1392, QVariant(0));
-        _item->setData(0, 1807, QVariant(_script->scriptPath));
+        _item->setData(0, 1807, QVariant(QString::fromStdString(_script->scriptPath)));
 
         _item->setText(0, QString::fromStdString(_luaName));
         _item->setText(1, "Unknown");
@@ -319,9 +441,9 @@ int MainWindow::parseScript()
         // Verify if they exist, and if they do,
         // use them in the GUI.
 
-        LuaObject _nameScr = _script->luaState["LUAGUI_NAME"];
-        LuaObject _authScr = _script->luaState["LUAGUI_AUTH"];
-        LuaObject _descScr = _script->luaState["LUAGUI_DESC"];
+        LuaObject _nameScr = _script->luaGlobals["LUAGUI_NAME"];
+        LuaObject _authScr = _script->luaGlobals["LUAGUI_AUTH"];
+        LuaObject _descScr = _script->luaGlobals["LUAGUI_DESC"];
 
         if (_nameScr.valid() && _nameScr.as<string>().length() > 0)
             _item->setText(0, QString::fromStdString(_nameScr.as<string>()));
@@ -337,6 +459,11 @@ int MainWindow::parseScript()
         ui->scriptWidget->addTopLevelItem(_item);
     }
 
+    // Everything we need is in the widget now. No
+    // need to keep a VM per script around for it.
+
+    backendFake.reset();
+
     return 0;
 }
 
@@ -370,6 +497,19 @@ void MainWindow::autoToggle()
     serializePref();
 }
 
+void MainWindow::traceToggle()
+{
+    // Not saved with the rest. A trace grows for as long as the engine
+    // runs, so this is only ever on for the run it was asked for.
+
+    QString _titleTxt = "%1 Trace Recording";
+
+    _traceBool ? _titleTxt = _titleTxt.arg("Enable") : _titleTxt = _titleTxt.arg("Disable");
+    ui->actionTrace->setText(_titleTxt);
+
+    _traceBool = !_traceBool;
+}
+
 void MainWindow::consoleToggle()
 {
     QString _titleTxt = "%1 Console...";
@@ -418,9 +558,59 @@ void MainWindow::threadToggle()
         _prefTable["threadBool"] = _threadBool;
 
         serializePref();
+
+        // Threads cannot share a VM, and only one threading mode goes.
+
+        if (_threadBool && _sharedBool)
+            sharedToggle();
+
+        if (_threadBool && _poolBool)
+            poolToggle();
     }
 }
 
+void MainWindow::sharedToggle()
+{
+    QString _titleTxt = "%1 Shared VM";
+
+    _sharedBool ? _titleTxt = _titleTxt.arg("Enable") : _titleTxt = _titleTxt.arg("Disable");
+    ui->actionShared->setText(_titleTxt);
+
+    _sharedBool = !_sharedBool;
+    _prefTable["sharedBool"] = _sharedBool;
+
+    serializePref();
+
+    // Threads cannot share a VM.
+
+    if (_sharedBool && _threadBool)
+        threadToggle();
+
+    if (_sharedBool && _poolBool)
+        poolToggle();
+}
+
+void MainWindow::poolToggle()
+{
+    QString _titleTxt = "%1 Worker Pool";
+
+    _poolBool ? _titleTxt = _titleTxt.arg("Enable") : _titleTxt = _titleTxt.arg("Disable");
+    ui->actionPool->setText(_titleTxt);
+
+    _poolBool = !_poolBool;
+    _prefTable["poolBool"] = _poolBool;
+
+    serializePref();
+
+    // The pool runs scripts side by side, so neither of these go with it.
+
+    if (_poolBool && _threadBool)
+        threadToggle();
+
+    if (_poolBool && _sharedBool)
+        sharedToggle();
+}
+
 // TRIGGER EVENTS
 
 void MainWindow::startEvent()
@@ -434,44 +624,55 @@ void MainWindow::startEvent()
 
 void MainWindow::stopEvent()
 {
+    // Stop everything which prints to the console before it's cleared.
+
+    stopEngine();
+
     // Reset the console.
 
     _console->close();
-    _console = new Console(this);
+    _console->clearMessages();
 
     // Stop the run thread.
 
     _runTimer->stop();
-
-    if (_threadBool)
-        for (auto _thread : _threadList)
-            _thread->stop();
-
-    _threadList.clear();
+    _statTimer->stop();
 
     // Restore the buttons.
 
     ui->actionStart->setEnabled(true);
     ui->actionReload->setEnabled(false);
     ui->actionStop->setEnabled(false);
+    ui->actionDump->setEnabled(false);
 }
 
 void MainWindow::reloadEvent()
 {
+    // If the game is still there, the engine can reload
+    // the scripts on its own, without latching again.
+
+    #if defined(_WIN32) || defined(_WIN64)
+        DWORD _retCode = 0;
+        GetExitCodeProcess(MemoryLib::PHandle, &_retCode);
+
+        if (_engine != nullptr && _retCode == STILL_ACTIVE)
+        {
+            _engine->Post({ LuaEngine::CMD_RELOAD });
+            return;
+        }
+    #endif
+
+    stopEngine();
+
     // Reset the console.
 
     _console->close();
-    _console = new Console(this);
+    _console->clearMessages();
 
-    // Stop the run thread... or threads.
+    // Stop the run thread.
 
     _runTimer->stop();
-
-    if (_threadBool)
-        for (auto _thread : _threadList)
-            _thread->stop();
-
-    _threadList.clear();
+    _statTimer->stop();
 
     // Run the latch thread with the window.
 
@@ -484,6 +685,199 @@ void MainWindow::reloadEvent()
     ui->actionStart->setEnabled(true);
     ui->actionReload->setEnabled(false);
     ui->actionStop->setEnabled(false);
+    ui->actionDump->setEnabled(false);
+}
+
+void MainWindow::frameStatsEvent()
+{
+    // Dump how well the engine thread kept to its rate so far.
+
+    if (_engine == nullptr)
+    {
+        _console->printMessage("Frame statistics are only kept by the engine thread, which is not running.<br>", 2);
+        return;
+    }
+
+    auto& _sync = backend->frameSync;
+
+    if (_sync.Enabled())
+        _console->printMessage(QString("Synced to Game: %1Hz over %2 game frames, %3 missed, %4 duplicated, %5 stalls. Frames take %6ms.<br>")
+                               .arg(_sync.Hertz(), 0, 'f', 2).arg(_sync.GameFrames.load()).arg(_sync.MissedFrames.load())
+                               .arg(_sync.DuplicateFrames.load()).arg(_sync.StallCount.load()).arg(_sync.FramePeriod(), 0, 'f', 2), 0);
+
+    else
+        _console->printMessage(QString::fromStdString(backend->framePacer.Summary()), 0);
+
+    auto& _idle = backend->idleWatch;
+
+    if (_idle.Enabled())
+        _console->printMessage(QString("Idle Throttling: %1s active, %2s still, %3s hidden. Now %4, at 1/%5 rate.<br>")
+                               .arg(_idle.StateSeconds(IdleWatch::IDLE_ACTIVE), 0, 'f', 1).arg(_idle.StateSeconds(IdleWatch::IDLE_STILL), 0, 'f', 1)
+                               .arg(_idle.StateSeconds(IdleWatch::IDLE_HIDDEN), 0, 'f', 1).arg(IdleWatch::StateName(_idle.State)).arg(_idle.Factor.load()), 0);
+
+    if (!_consoleBool)
+        consoleToggle();
+}
+
+void MainWindow::timelineToggle()
+{
+    // Not saved with the rest either. It costs a little on every
+    // read and write, so it's only on for as long as it's needed.
+
+    auto _state = !TimelineTrace::Enabled;
+
+    TimelineTrace::Enabled = _state;
+    ui->actionTimeline->setText(_state ? "Disable Timeline" : "Enable Timeline");
+
+    if (_state)
+    {
+        ui->actionSaveTimeline->setEnabled(true);
+        _console->printMessage(QString("Recording a timeline, the last %1 spans of every thread are kept.<br>").arg(TimelineTrace::Capacity), 0);
+    }
+}
+
+void MainWindow::timelineEvent()
+{
+    auto _timelineDir = _basePath + "/timelines";
+    QDir().mkpath(_timelineDir);
+
+    auto _defaultPath = QString("%1/%2-%3.json").arg(_timelineDir).arg(_currGame.gameName).arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss"));
+    auto _path = QFileDialog::getSaveFileName(this, "Save Timeline", _defaultPath, "Chrome Traces (*.json)");
+
+    if (_path.isEmpty())
+        return;
+
+    size_t _count = 0;
+
+    if (TimelineTrace::Write(_path.toStdString(), &_count))
+        _console->printMessage(QString("Saved %1 spans into \"%2\". Open it in chrome://tracing or ui.perfetto.dev.<br>").arg(_count).arg(_path), 1);
+
+    else
+        _console->printMessage(QString("Could not write the timeline into \"%1\".<br>").arg(_path), 3);
+}
+
+void MainWindow::profileEvent()
+{
+    // The table fills in with every stat tick, while the engine runs.
+
+    _profileWindow->updateProfile(_activeList);
+    _profileWindow->show();
+    _profileWindow->raise();
+}
+
+void MainWindow::dumpEvent()
+{
+    auto _dumpDir = _basePath + "/dumps";
+    QDir().mkpath(_dumpDir);
+
+    auto _defaultPath = QString("%1/%2-%3.lfdump").arg(_dumpDir).arg(_currGame.gameName).arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss"));
+    _dumpPath = QFileDialog::getSaveFileName(this, "Dump Game Memory", _defaultPath, "LuaFrontend Dumps (*.lfdump)");
+
+    if (_dumpPath.isEmpty())
+        return;
+
+    _dumpTotal = 0;
+
+    for (auto& _region : ProcessDump::ListRegions())
+        _dumpTotal += _region.size;
+
+    _dumpProgress = 0;
+    _dumpFinished = false;
+    _dumpCancel = false;
+
+    // The scripts keep running while it dumps, so what they
+    // write while it does may or may not make it in.
+
+    _dumpThread = std::thread([this, _path = _dumpPath.toStdString()]
+    {
+        _dumpResult = ProcessDump::DumpProcess(_path, DumpFilter(), &_dumpProgress, &_dumpCancel);
+        _dumpFinished = true;
+    });
+
+    ui->actionDump->setEnabled(false);
+    _dumpTimer->start(250);
+
+    _console->printMessage(QString("Dumping %1MB of game memory into \"%2\".<br>").arg(_dumpTotal / 1048576.0, 0, 'f', 1).arg(_dumpPath), 0);
+}
+
+void MainWindow::dumpProgressEvent()
+{
+    if (!_dumpFinished)
+    {
+        auto _percent = _dumpTotal != 0 ? _dumpProgress * 100.0 / _dumpTotal : 100.0;
+        ui->actionDump->setText(QString("Dumping Game Memory... %1%").arg(_percent, 0, 'f', 0));
+
+        return;
+    }
+
+    _dumpTimer->stop();
+    _dumpThread.join();
+
+    ui->actionDump->setText("Dump Game Memory...");
+    ui->actionDump->setEnabled(ui->actionStop->isEnabled());
+
+    if (!_dumpResult.success)
+    {
+        _console->printMessage(QString("The dump failed: %1<br>").arg(QString::fromStdString(_dumpResult.errorText)), 3);
+        return;
+    }
+
+    _console->printMessage(QString("Dumped %1 regions, %2MB into %3MB, in %4s: %5GB/s. The dumper peaked at %6MB, the whole process at %7MB.<br>")
+                           .arg(_dumpResult.regionCount).arg(_dumpResult.rawBytes / 1048576.0, 0, 'f', 1).arg(_dumpResult.fileBytes / 1048576.0, 0, 'f', 1)
+                           .arg(_dumpResult.runTime, 0, 'f', 2).arg(_dumpResult.Throughput(), 0, 'f', 2)
+                           .arg(_dumpResult.peakBytes / 1048576.0, 0, 'f', 1).arg(_dumpResult.processPeak / 1048576.0, 0, 'f', 1), 1);
+
+    if (_dumpResult.missingCount != 0)
+        _console->printMessage(QString("%1 chunks could not be read, and are left out.<br>").arg(_dumpResult.missingCount), 2);
+
+    if (!_consoleBool)
+        consoleToggle();
+}
+
+void MainWindow::stopEngine()
+{
+    // Waits for the engine thread to finish its tick and exit.
+
+    delete _engine;
+    _engine = nullptr;
+
+    // Same for the script threads, in Multi-Threading.
+
+    qDeleteAll(_threadList);
+    _threadList.clear();
+
+    _activeList.clear();
+
+    if (_recorder != nullptr)
+    {
+        MemoryLib::Source = nullptr;
+
+        _console->printMessage(QString("Trace Recording: %1 frames, %2 reads (%3 unchanged) and %4 writes in %5KB.<br>")
+                               .arg(_recorder->FrameCount).arg(_recorder->ReadCount).arg(_recorder->SameCount)
+                               .arg(_recorder->WriteCount).arg(_recorder->FileBytes / 1024.0, 0, 'f', 1), 1);
+
+        delete _recorder;
+        _recorder = nullptr;
+    }
+
+    // Nothing runs the scripts anymore.
+
+    backend.reset();
+}
+
+void MainWindow::scriptCheckEvent(QTreeWidgetItem* item, int column)
+{
+    // Ticking a script on or off while running passes it on to the engine.
+
+    if (_engine == nullptr || column != 0)
+        return;
+
+    LuaEngine::Command _command = { LuaEngine::CMD_TOGGLE };
+
+    _command.scriptIndex = ui->scriptWidget->indexOfTopLevelItem(item);
+    _command.scriptEnabled = item->checkState(0) == Qt::CheckState::Checked;
+
+    _engine->Post(_command);
 }
 
 void MainWindow::gameClickEvent(int currentRow)
@@ -503,6 +897,12 @@ void MainWindow::gameClickEvent(int currentRow)
     _currGame.offset = _tmpOffset.toULong(nullptr, 16);
     _currGame.baseAddress = _tmpAddress.toULong(nullptr, 16);
 
+    auto _tmpCounter = QString::fromStdString(toml::find_or<std::string>(_table, "FrameCounter", "0"));
+
+    _currGame.frameCounter = _tmpCounter.toULongLong(nullptr, 16);
+    _currGame.counterSize = toml::find_or<int>(_table, "FrameCounterSize", 4);
+    _currGame.idleRegions = parseIdleRegions(toml::find_or<std::vector<std::string>>(_table, "IdleWatch", std::vector<std::string>()));
+
     if (parseScript() == 404)
     {
         QMessageBox _errorBox;
@@ -593,7 +993,7 @@ void MainWindow::connectEvent()
     // Feed the information to a read backend.
     // This backend actually runs everything needed.
 
-    backend = new LuaBackend(_path.toStdString().c_str(), _baseAddress, _console);
+    backend = make_unique<LuaBackend>(_path.toStdString().c_str(), _baseAddress, _console, _memoryLimit, _sharedBool);
 
     // Since there is a two-way sorting, this is easy.
     // Check the state of the script widget. Make a new
@@ -614,22 +1014,33 @@ void MainWindow::connectEvent()
     backend->loadedScripts.clear();
     backend->loadedScripts = _scriptList;
 
-    // Execute the initialization functions.
+    // If all scripts share one VM, tell how much
+    // running one VM per script would have cost.
 
-    for (auto _script : backend->loadedScripts)
+    if (backend->sharedMode && !backend->loadedScripts.empty())
     {
-        if (_script->initFunction)
-        {
-            auto _result = _script->initFunction();
+        auto _sharedKB = backend->loadedScripts[0]->luaVM->luaAlloc.LiveBytes.load() / 1024;
+        auto _savedKB = backend->sharedBaseline * (backend->loadedScripts.size() - 1) / 1024;
 
-            if (!_result.valid())
-            {
-                sol::error _err = _result;
+        _console->printMessage(QString("Shared VM: %1 scripts in %2KB, saving about %3KB against one VM per script.<br>")
+                               .arg(backend->loadedScripts.size()).arg(_sharedKB).arg(_savedKB), 1);
+    }
 
-                auto _errStr = QString(_err.what());
-                _console->printMessage(_errStr + "<br>", 3);
-            }
-        }
+    // Order the scripts by what they run after, and report any cycles.
+    // Thread-per-Script has no common tick to order them in.
+
+    if (backend->BuildGraph() && _threadBool)
+        _console->printMessage("Some scripts have to run after others, which Multi-Threading cannot honour. "
+                               "Disable it or use the Worker Pool instead.<br>", 2);
+
+    // In pool mode, the frames of a tick are spread over a fixed set of workers.
+
+    if (_poolBool)
+    {
+        backend->EnablePool(_poolWorkers);
+
+        if (backend->PoolSize() != 0)
+            _console->printMessage(QString("Worker Pool: %1 scripts over %2 workers.<br>").arg(backend->loadedScripts.size()).arg(backend->PoolSize()), 1);
     }
 
     // Set the buttons, show the console,
@@ -638,15 +1049,25 @@ void MainWindow::connectEvent()
     ui->actionStart->setEnabled(false);
     ui->actionReload->setEnabled(true);
     ui->actionStop->setEnabled(true);
+    ui->actionDump->setEnabled(!_dumpThread.joinable());
 
     if (!_consoleBool)
         consoleToggle();
 
-    _runTimer->start(backend->frameLimit);
+    _statTimer->start(1000);
 
     if (_threadBool)
     {
-        _threadList.clear();
+        if (_currGame.frameCounter != 0)
+            _console->printMessage("This game has a frame counter, but Multi-Threading ticks on its own timers. Ignoring it.<br>", 2);
+
+        if (_traceBool)
+            _console->printMessage("A trace needs every script on the same tick, which Multi-Threading does not have. Not recording.<br>", 2);
+
+        backend->InitScripts();
+
+        _activeList = backend->loadedScripts;
+        _runTimer->start(qRound(backend->TickInterval()));
 
         for (auto _script : backend->loadedScripts)
         {
@@ -661,6 +1082,58 @@ void MainWindow::connectEvent()
         for (auto _thread : _threadList)
             _thread->start();
     }
+
+    // Otherwise, the engine thread runs everything from here on, including
+    // the initialization functions. The timer only picks up its events.
+
+    else
+    {
+        _activeList.clear();
+
+        // Tick on the game's frames, if we know where to look.
+
+        if (_currGame.frameCounter != 0)
+        {
+            backend->frameSync.CounterAddress = _currGame.frameCounter;
+            backend->frameSync.CounterSize = _currGame.counterSize;
+
+            _console->printMessage("Following the game's frame counter. Scripts without a rate of their own run once per game frame.<br>", 1);
+        }
+
+        backend->idleWatch.RegionList.assign(_currGame.idleRegions.begin(), _currGame.idleRegions.end());
+
+        // Record the run into "traces", to be replayed by the CLI later.
+
+        if (_traceBool)
+        {
+            auto _traceDir = _basePath + "/traces";
+            QDir().mkpath(_traceDir);
+
+            auto _tracePath = QString("%1/%2-%3.lftrace").arg(_traceDir).arg(_currGame.gameName)
+                                                          .arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss"));
+
+            _recorder = new TraceRecorder(_tracePath.toStdString());
+
+            if (_recorder->IsOpen())
+            {
+                MemoryLib::Source = _recorder;
+                _console->printMessage(QString("Recording a trace into \"%1\".<br>").arg(_tracePath), 1);
+            }
+
+            else
+            {
+                _console->printMessage(QString("The trace \"%1\" cannot be written. Not recording.<br>").arg(_tracePath), 2);
+
+                delete _recorder;
+                _recorder = nullptr;
+            }
+        }
+
+        _engine = new LuaEngine(backend.get());
+        _engine->Post({ LuaEngine::CMD_START });
+
+        _runTimer->start(16);
+    }
 }
 
 void MainWindow::latchEvent()
@@ -682,42 +1155,64 @@ void MainWindow::latchEvent()
 
 void MainWindow::runEvent()
 {
-    // The main script thread.
-    // Only runs if single-threaded.
+    // In single-threaded and pool modes, the engine thread does the
+    // running. All there is to do here is to catch up with it.
 
-    if (!_threadBool)
+    if (_engine != nullptr)
     {
-        for (int i = 0; i < backend->loadedScripts.size(); i++)
-        {
-            auto _script = backend->loadedScripts[i];
+        LuaEngine::Event _event;
 
-            if (_script->frameFunction)
+        while (_engine->Poll(_event))
+        {
+            switch (_event.eventType)
             {
-                auto _result = _script->frameFunction();
+                case LuaEngine::EVT_SCRIPT_STARTED:
+                    _activeList.push_back(_event.eventScript);
+                    break;
+
+                case LuaEngine::EVT_SCRIPT_STOPPED:
+                    _activeList.erase(std::remove(_activeList.begin(), _activeList.end(), _event.eventScript), _activeList.end());
+                    break;
 
-                if (!_result.valid())
+                case LuaEngine::EVT_RELOADED:
+                    _activeList.clear();
+                    _engine->Post({ LuaEngine::CMD_RELEASE });
+                    break;
+
+                case LuaEngine::EVT_JITTER:
                 {
-                    sol::error _err = _result;
+                    // The percentiles are bucket edges, the last bucket has none.
+
+                    auto _edgeText = [](float _edge) { return _edge >= UINT32_MAX ? QString("16000+") : QString::number(_edge, 'f', 0); };
+
+                    if (_event.frameSync)
+                        ui->statusBar->showMessage(QString("%1Hz, Synced to Game: %2 Missed, %3 Duplicated")
+                                                   .arg(_event.frameHertz, 0, 'f', 2).arg(_event.missedCount).arg(_event.duplicateCount));
 
-                    auto _errStr = QString(_err.what());
-                    _console->printMessage(_errStr + "<br>", 3);
+                    else
+                        ui->statusBar->showMessage(QString("%1Hz, Tick Jitter: <%2us (Median), <%3us (99%), %4us (Max), %5 Late")
+                                                   .arg(_event.frameHertz, 0, 'f', 2).arg(_edgeText(_event.jitterMedian)).arg(_edgeText(_event.jitterHigh))
+                                                   .arg(_event.jitterMax, 0, 'f', 0).arg(_event.lateCount));
 
-                    backend->loadedScripts.erase(backend->loadedScripts.begin() + i);
+                    if (_event.idleFactor > 1)
+                        ui->statusBar->showMessage(ui->statusBar->currentMessage() + QString(", Idle (%1): 1/%2 Rate")
+                                                   .arg(IdleWatch::StateName(_event.idleState)).arg(_event.idleFactor));
+                    break;
                 }
+
+                default:
+                    break;
             }
         }
     }
 
     // If the interval changes, apply the changes to all script threads.
 
-    else if (_threadList[0]->runInterval != backend->frameLimit)
+    else if (!_threadList.isEmpty() && _threadList[0]->runInterval.load() != backend->frameLimit)
+    {
         for (auto _thread : _threadList)
             _thread->runInterval = backend->frameLimit;
-
-    // If the interval changes, apply this change.
-
-    if (_runTimer->interval() != backend->frameLimit)
-        _runTimer->setInterval(backend->frameLimit);
+    }
 
     // If auto-reload is enabled and the process
     // is lost, activate the reload event.
@@ -737,6 +1232,51 @@ void MainWindow::runEvent()
     }
 }
 
+void MainWindow::statEvent()
+{
+    // Show the memory usage and the last frame's GC
+    // time of every running script next to its entry.
+
+    for (int i = 0; i < ui->scriptWidget->topLevelItemCount(); i++)
+    {
+        auto _item = ui->scriptWidget->topLevelItem(i);
+        auto _path = _item->data(0, 1807).toString();
+
+        _item->setText(3, "");
+        _item->setText(4, "");
+
+        for (auto _script : _activeList)
+        {
+            if (_script->scriptPath != _path.toStdString())
+                continue;
+
+            auto _liveKB = _script->luaVM->luaAlloc.LiveBytes.load() / 1024;
+            auto _peakKB = _script->luaVM->luaAlloc.PeakBytes.load() / 1024;
+
+            _item->setText(3, QString("%1KB (Peak: %2KB)").arg(_liveKB).arg(_peakKB));
+            _item->setText(4, QString("%1ms").arg(_script->luaVM->gcTime.load(), 0, 'f', 3));
+        }
+    }
+
+    if (_profileWindow->isVisible())
+        _profileWindow->updateProfile(_activeList);
+
+    // The engine thread lists the slowest scripts on its own. In
+    // Multi-Threading, there is no engine thread, so we do it.
+
+    _statCount++;
+
+    auto _profileTicks = (uint64_t)qRound(LuaBackend::ProfileInterval);
+
+    if (_engine == nullptr && LuaBackend::ProfileFrames && _profileTicks != 0 && _statCount % _profileTicks == 0)
+    {
+        auto _summary = LuaBackend::ProfileSummary(_activeList, 5);
+
+        if (!_summary.empty())
+            _console->printMessage(QString::fromStdString(_summary), 0);
+    }
+}
+
 // CONTEXT CONSTRUCTOR EVENTS
 
 void MainWindow::gameContextEvent(QPoint)
@@ -779,11 +1319,16 @@ void MainWindow::scriptContextEvent(QPoint point)
     QAction _editAction("Edit Script...");
     QAction _deleteAction("Delete Script...");
 
+    QAction _sampleAction("Sample Script");
+    QAction _saveAction("Save Samples...");
+
     connect(&_addAction, SIGNAL(triggered()), this, SLOT(newScriptEvent()));
     connect(&_editAction, SIGNAL(triggered()), this, SLOT(editScriptEvent()));
     connect(&_deleteAction, SIGNAL(triggered()), this, SLOT(deleteScriptEvent()));
     connect(&_reloadAction, SIGNAL(triggered()), this, SLOT(refreshScriptEvent()));
     connect(&_folderAction, SIGNAL(triggered()), this, SLOT(folderOpenEvent()));
+    connect(&_sampleAction, SIGNAL(triggered()), this, SLOT(sampleToggle()));
+    connect(&_saveAction, SIGNAL(triggered()), this, SLOT(sampleSaveEvent()));
 
     _contextScript.addAction(&_reloadAction);
     _contextScript.addAction(&_folderAction);
@@ -799,11 +1344,40 @@ void MainWindow::scriptContextEvent(QPoint point)
     _contextScript.addAction(&_editAction);
     _contextScript.addAction(&_deleteAction);
 
+    // Only a script which runs can be sampled.
+
+    auto _script = selectedScript();
+
+    _sampleAction.setCheckable(true);
+    _sampleAction.setEnabled(_script != nullptr);
+    _sampleAction.setChecked(_script != nullptr && _script->frameSampler.Enabled);
+    _saveAction.setEnabled(_script != nullptr && _script->frameSampler.SampleCount() != 0);
+
+    _contextScript.addSeparator();
+    _contextScript.addAction(&_sampleAction);
+    _contextScript.addAction(&_saveAction);
+
     _contextScript.exec(ui->scriptWidget->mapToGlobal(point));
 }
 
 // CONTEXT TRIGGER EVENTS
 
+LuaBackend::LuaScript* MainWindow::selectedScript()
+{
+    auto _item = ui->scriptWidget->currentItem();
+
+    if (_item == nullptr)
+        return nullptr;
+
+    auto _path = _item->data(0, 1807).toString().toStdString();
+
+    for (auto _script : _activeList)
+        if (_script->scriptPath == _path)
+            return _script;
+
+    return nullptr;
+}
+
 void MainWindow::newScriptEvent()
 {
     // Figure out what path we are working with.
@@ -863,6 +1437,49 @@ void MainWindow::editScriptEvent()
     QDesktopServices::openUrl(QUrl::fromLocalFile(_data.toString()));
 }
 
+void MainWindow::sampleToggle()
+{
+    auto _script = selectedScript();
+
+    if (_script == nullptr)
+        return;
+
+    auto _state = !_script->frameSampler.Enabled;
+    _script->frameSampler.Enable(_state);
+
+    if (_state)
+        _console->printMessage(QString("Sampling \"%1\" every %2us of its running time.<br>").arg(QString::fromStdString(_script->scriptName)).arg(ScriptSampler::SamplePeriod), 0);
+
+    else
+        _console->printMessage(QString("Stopped sampling \"%1\", %2 samples over %3ms so far.<br>").arg(QString::fromStdString(_script->scriptName))
+                               .arg(_script->frameSampler.SampleCount()).arg(_script->frameSampler.TotalTime() / 1000.0, 0, 'f', 1), 0);
+}
+
+void MainWindow::sampleSaveEvent()
+{
+    auto _script = selectedScript();
+
+    if (_script == nullptr)
+        return;
+
+    auto _sampleDir = _basePath + "/profiles";
+    QDir().mkpath(_sampleDir);
+
+    auto _defaultPath = QString("%1/%2-%3.folded").arg(_sampleDir).arg(QString::fromStdString(_script->scriptName)).arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss"));
+    auto _path = QFileDialog::getSaveFileName(this, "Save Samples", _defaultPath, "Collapsed Stacks (*.folded);;Speedscope (*.json)");
+
+    // The script may have been reloaded away while the dialog was up.
+
+    if (_path.isEmpty() || _script != selectedScript())
+        return;
+
+    if (_script->frameSampler.Write(_path.toStdString(), _script->scriptName))
+        _console->printMessage(QString("Saved %1 samples of \"%2\" into \"%3\".<br>").arg(_script->frameSampler.SampleCount()).arg(QString::fromStdString(_script->scriptName)).arg(_path), 0);
+
+    else
+        _console->printMessage(QString("Could not write the samples into \"%1\".<br>").arg(_path), 3);
+}
+
 void MainWindow::deleteScriptEvent()
 {
     auto _data = ui->scriptWidget->currentItem()->data(0, 1807);
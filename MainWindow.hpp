@@ -4,6 +4,7 @@
 #include <QUrl>
 #include <QTimer>
 #include <QDateTime>
+#include <QFileDialog>
 #include <QMainWindow>
 #include <QMessageBox>
 #include <QTreeWidget>
@@ -15,7 +16,11 @@
 #include <WaitDialog.hpp>
 #include <LuaBackend.hpp>
 #include <LuaThread.hpp>
+#include <LuaEngine.hpp>
+#include <MemoryTrace.hpp>
+#include <ProcessDump.hpp>
 #include <AboutFrontend.hpp>
+#include <ProfileWindow.hpp>
 
 QT_BEGIN_NAMESPACE
     namespace Ui { class MainWindow; }
@@ -30,7 +35,10 @@ class MainWindow : public QMainWindow
         QString scriptPath;
         uint64_t baseAddress;
         uint64_t offset;
+        uint64_t frameCounter;
+        int counterSize;
         bool isBigEndian;
+        QList<IdleWatch::Region> idleRegions;
     };
 
     Q_OBJECT
@@ -38,8 +46,8 @@ class MainWindow : public QMainWindow
     public:
         QTimer* latchTimer;
 
-        LuaBackend* backend;
-        LuaBackend* backendFake;
+        unique_ptr<LuaBackend> backend;
+        unique_ptr<LuaBackend> backendFake;
 
         MainWindow(QWidget *parent = nullptr);
         ~MainWindow();
@@ -57,8 +65,19 @@ class MainWindow : public QMainWindow
         void reloadEvent();
         void connectEvent();
         void threadToggle();
+        void sharedToggle();
+        void poolToggle();
+        void traceToggle();
+        void timelineToggle();
+        void timelineEvent();
+        void statEvent();
+        void frameStatsEvent();
+        void profileEvent();
+        void dumpEvent();
+        void dumpProgressEvent();
         void gameClickEvent(int);
         void scriptClickEvent(QTreeWidgetItem*, int);
+        void scriptCheckEvent(QTreeWidgetItem*, int);
 
         void gameContextEvent(QPoint);
         void scriptContextEvent(QPoint);
@@ -68,6 +87,8 @@ class MainWindow : public QMainWindow
         void deleteScriptEvent();
         void refreshScriptEvent();
         void folderOpenEvent();
+        void sampleToggle();
+        void sampleSaveEvent();
 
         void showAbout();
 
@@ -80,23 +101,59 @@ class MainWindow : public QMainWindow
 
         bool _autoBool;
         bool _threadBool;
+        bool _sharedBool;
+        bool _poolBool;
+        bool _traceBool;
         bool _consoleBool;
         bool _darkPalBool;
 
+        size_t _memoryLimit;
+        size_t _poolWorkers;
+
         Console* _console;
         WaitDialog* _waitWindow;
         AboutFrontend* _aboutDiag;
+        ProfileWindow* _profileWindow;
 
         QTimer* _runTimer;
+        QTimer* _statTimer;
+        uint64_t _statCount;
         QList<LuaThread*> _threadList;
 
+        // The engine thread, unless Thread-per-Script is on, and the scripts
+        // it last told us are running. The GUI never touches the backend's own list.
+
+        LuaEngine* _engine;
+        vector<LuaBackend::LuaScript*> _activeList;
+
+        // Records every read and write of the scripts, when asked to.
+
+        TraceRecorder* _recorder;
+
+        // The memory dump in progress, if any. It runs on a thread of its
+        // own, and the timer picks up how far along it is.
+
+        QTimer* _dumpTimer;
+        std::thread _dumpThread;
+
+        atomic<uint64_t> _dumpProgress;
+        atomic<bool> _dumpFinished;
+        atomic<bool> _dumpCancel;
+
+        uint64_t _dumpTotal;
+        QString _dumpPath;
+        ProcessDump::Result _dumpResult;
+
         QString _basePath;
         QGameInfo _currGame;
 
         int parseGame();
         int parseScript();
+        LuaBackend::LuaScript* selectedScript();
+        QList<IdleWatch::Region> parseIdleRegions(const std::vector<std::string>&);
 
         void serializePref();
+        void stopEngine();
 
         Ui::MainWindow *ui;
 
@@ -0,0 +1,94 @@
+#include <ProfileWindow.hpp>
+#include <ui_ProfileWindow.h>
+
+ProfileWindow::ProfileWindow(QWidget *parent) : QDialog(parent), ui(new Ui::ProfileWindow)
+{
+    ui->setupUi(this);
+
+    QStringList _labelList = { "Script", "Frames", "Mean (ms)", "Median (ms)", "95% (ms)", "Max (ms)",
+                               "Reads", "Read Bytes", "Writes", "Written Bytes" };
+
+    ui->profileTable->setColumnCount(_labelList.size());
+    ui->profileTable->setHorizontalHeaderLabels(_labelList);
+    ui->profileTable->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    ui->profileTable->verticalHeader()->hide();
+    ui->profileTable->sortByColumn(4, Qt::DescendingOrder);
+
+    QStringList _memoryList = { "Calls/s", "KB/s", "Failed/s", "Unprotected/s", "Mean (us)", "Median (us)", "95% (us)", "Calls", "Failed" };
+
+    ui->memoryTable->setColumnCount(_memoryList.size());
+    ui->memoryTable->setRowCount(MemoryStats::OP_COUNT);
+    ui->memoryTable->setHorizontalHeaderLabels(_memoryList);
+    ui->memoryTable->setVerticalHeaderLabels({ "Reads", "Writes" });
+    ui->memoryTable->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+}
+
+ProfileWindow::~ProfileWindow()
+{
+    delete ui;
+}
+
+void ProfileWindow::setCell(QTableWidget* table, int row, int column, const QVariant& value)
+{
+    // Numbers stay numbers, so that they sort as such.
+
+    auto _item = table->item(row, column);
+
+    if (_item == nullptr)
+    {
+        _item = new QTableWidgetItem();
+        _item->setFlags(Qt::ItemIsEnabled | Qt::ItemIsSelectable);
+
+        table->setItem(row, column, _item);
+    }
+
+    _item->setData(Qt::DisplayRole, value);
+}
+
+void ProfileWindow::updateProfile(const vector<LuaBackend::LuaScript*>& scriptList)
+{
+    // Sorting while the rows are being filled moves them under our feet.
+
+    ui->profileTable->setSortingEnabled(false);
+    ui->profileTable->setRowCount((int)scriptList.size());
+
+    auto _toMs = [](float _time) { return qRound(_time) / 1000.0; };
+    auto _round = [](float _value) { return qRound(_value * 10) / 10.0; };
+
+    for (int i = 0; i < (int)scriptList.size(); i++)
+    {
+        auto& _profile = scriptList[i]->frameProfile;
+
+        setCell(ui->profileTable, i, 0, QString::fromStdString(scriptList[i]->scriptName));
+        setCell(ui->profileTable, i, 1, (qulonglong)_profile.FrameCount.load());
+        setCell(ui->profileTable, i, 2, _toMs(_profile.WindowMean));
+        setCell(ui->profileTable, i, 3, _toMs(_profile.WindowMedian));
+        setCell(ui->profileTable, i, 4, _toMs(_profile.WindowHigh));
+        setCell(ui->profileTable, i, 5, _toMs(_profile.WindowMax));
+        setCell(ui->profileTable, i, 6, _round(_profile.WindowReads));
+        setCell(ui->profileTable, i, 7, _round(_profile.WindowReadBytes));
+        setCell(ui->profileTable, i, 8, _round(_profile.WindowWrites));
+        setCell(ui->profileTable, i, 9, _round(_profile.WindowWriteBytes));
+    }
+
+    ui->profileTable->setSortingEnabled(true);
+
+    // The memory I/O is of every script, and of the frontend itself.
+
+    auto _report = MemoryStats::Current();
+
+    for (int i = 0; i < MemoryStats::OP_COUNT; i++)
+    {
+        auto& _op = _report.opList[i];
+
+        setCell(ui->memoryTable, i, 0, _round(_op.callRate));
+        setCell(ui->memoryTable, i, 1, _round(_op.byteRate / 1024));
+        setCell(ui->memoryTable, i, 2, _round(_op.failureRate));
+        setCell(ui->memoryTable, i, 3, i == MemoryStats::OP_WRITE ? QVariant(_round(_op.fallbackRate)) : QVariant("-"));
+        setCell(ui->memoryTable, i, 4, _round(_op.meanTime));
+        setCell(ui->memoryTable, i, 5, _round(_op.medianTime));
+        setCell(ui->memoryTable, i, 6, _round(_op.highTime));
+        setCell(ui->memoryTable, i, 7, (qulonglong)_op.total.calls);
+        setCell(ui->memoryTable, i, 8, (qulonglong)_op.total.failures);
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef PROFILEWINDOW_HPP
+#define PROFILEWINDOW_HPP
+
+#include <QDialog>
+#include <QHeaderView>
+#include <QTableWidget>
+
+#include <LuaBackend.hpp>
+
+namespace Ui {
+class ProfileWindow;
+}
+
+// Every running script's frame times and I/O, in a table which can
+// be sorted by any column, to find the script slowing everything down.
+// Below it, what the reads and writes of the game's memory cost.
+
+class ProfileWindow : public QDialog
+{
+    Q_OBJECT
+
+    public:
+        explicit ProfileWindow(QWidget *parent = nullptr);
+        ~ProfileWindow();
+
+        void updateProfile(const vector<LuaBackend::LuaScript*>&);
+
+    private:
+        Ui::ProfileWindow *ui;
+
+        void setCell(QTableWidget*, int, int, const QVariant&);
+};
+
+#endif // PROFILEWINDOW_HPP
@@ -0,0 +1,105 @@
+#include <chrono>
+#include <cstdio>
+#include <sol.hpp>
+
+#include <MemoryLib.hpp>
+#include <LuaMemoryLib.hpp>
+
+// Measures how many memory binding calls per second a script can make,
+// through the raw lua_CFunction bindings and through the sol::overload
+// bindings they replaced. The "game" is this very process: MemoryLib is
+// pointed at our own handle and every call reads a local buffer.
+
+static uint8_t _targetBuffer[4096];
+
+static void SetSolFunctions(sol::state& _state)
+{
+    _state.set_function("SolReadByte",
+    sol::overload
+    (
+        [](uint64_t _addr) { return MemoryLib::ReadByte(_addr); },
+        [](uint64_t _addr, bool _absolute) { return MemoryLib::ReadByte(_addr, _absolute); }
+    ));
+
+    _state.set_function("SolReadInt",
+    sol::overload
+    (
+        [](uint64_t _addr) { return MemoryLib::ReadInt(_addr); },
+        [](uint64_t _addr, bool _absolute) { return MemoryLib::ReadInt(_addr, _absolute); }
+    ));
+
+    _state.set_function("SolReadFloat",
+    sol::overload
+    (
+        [](uint64_t _addr) { return MemoryLib::ReadFloat(_addr); },
+        [](uint64_t _addr, bool _absolute) { return MemoryLib::ReadFloat(_addr, _absolute); }
+    ));
+
+    _state.set_function("SolReadArray",
+    sol::overload
+    (
+        [](uint64_t _addr, int _len) { return MemoryLib::ReadBytes(_addr, _len); },
+        [](uint64_t _addr, int _len, bool _absolute) { return MemoryLib::ReadBytes(_addr, _len, _absolute); }
+    ));
+
+    _state.set_function("SolWriteInt",
+    sol::overload
+    (
+        [](uint64_t _addr, uint32_t _val) { MemoryLib::WriteInt(_addr, _val); },
+        [](uint64_t _addr, uint32_t _val, bool _absolute) { MemoryLib::WriteInt(_addr, _val, _absolute); }
+    ));
+}
+
+static double RunCase(sol::state& _state, const char* _call, int _count)
+{
+    char _code[512];
+    snprintf(_code, sizeof(_code), "local _addr = BUFFER_ADDR for i = 1, %d do %s end", _count, _call);
+
+    auto _start = std::chrono::steady_clock::now();
+    _state.script(_code);
+    auto _time = std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+
+    return _count / _time;
+}
+
+int main(int argc, char* argv[])
+{
+    int _count = argc > 1 ? atoi(argv[1]) : 1000000;
+
+    #if defined(_WIN32) || defined(_WIN64)
+        MemoryLib::PHandle = GetCurrentProcess();
+    #else
+        MemoryLib::PIdentifier = getpid();
+    #endif
+
+    sol::state _state;
+    _state.open_libraries(sol::lib::base);
+
+    LuaMemoryLib::Register(_state.lua_state());
+    SetSolFunctions(_state);
+
+    _state["BUFFER_ADDR"] = (uint64_t)_targetBuffer;
+
+    const char* _cases[][2] =
+    {
+        { "ReadByte", "ReadByte(_addr, true)" },
+        { "ReadInt", "ReadInt(_addr, true)" },
+        { "ReadFloat", "ReadFloat(_addr, true)" },
+        { "ReadArray[16]", "ReadArray(_addr, 16, true)" },
+        { "WriteInt", "WriteInt(_addr, i, true)" },
+    };
+
+    printf("%-16s %16s %16s %8s\n", "Binding", "Raw (calls/s)", "sol2 (calls/s)", "Speedup");
+
+    for (auto& _case : _cases)
+    {
+        string _solCall = string("Sol") + _case[1];
+
+        auto _raw = RunCase(_state, _case[1], _count);
+        auto _sol = RunCase(_state, _solCall.c_str(), _count);
+
+        printf("%-16s %16.0f %16.0f %7.2fx\n", _case[0], _raw, _sol, _raw / _sol);
+    }
+
+    return 0;
+}
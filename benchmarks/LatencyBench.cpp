@@ -0,0 +1,503 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    #include <csignal>
+#endif
+
+#include <LuaEngine.hpp>
+#include <LuaBackend.hpp>
+
+// How long it takes from the game changing a value to a script writing back
+// its answer, which is what the scripts are there for in the end.
+//
+// The "game" is a second copy of this program, started with --game. It bumps
+// a sequence number at a set rate and notes when it did, and watches for
+// the answer on a thread of its own, noting when that came in. Both times
+// come from the game's own clock. Once a run is over, we read them back out
+// of the game through MemoryLib, same as a script would.
+//
+// Every scheduling mode is ran in turn against the same game:
+//
+//     Single => The engine thread, one script after the other.
+//     Pool   => The engine thread, with the scripts spread over the worker pool.
+//     Thread => A thread per script, on whole-millisecond timers, the way
+//               Multi-Threading's LuaThread does it. That one is Qt, so it
+//               is done here with plain threads instead.
+//     Synced => The engine thread, ticking on the sequence as a frame counter.
+//
+//     LatencyBench [--rate 60] [--hz 60,120,240] [--seconds 5] [--scripts 8]
+//                  [--poll 50] [--json out.json]
+
+using BenchClock = std::chrono::steady_clock;
+
+static constexpr size_t RingSize = 1 << 16;
+
+struct LatencyRegion
+{
+    char magic[8];
+
+    atomic<uint32_t> sequence;
+    atomic<uint32_t> response;
+    atomic<uint32_t> quitFlag;
+    uint32_t padding;
+
+    // In nanoseconds of the game's clock, by sequence number. Zero means not yet.
+
+    uint64_t changeTime[RingSize];
+    uint64_t reactTime[RingSize];
+};
+
+static LatencyRegion _region;
+
+static uint64_t ClockNow()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(BenchClock::now().time_since_epoch()).count();
+}
+
+// THE GAME
+
+static int RunGame(double InputRate, int InputPoll)
+{
+    memcpy(_region.magic, "LATBENCH", 8);
+
+    #if defined(_WIN32) || defined(_WIN64)
+        auto _processID = GetCurrentProcessId();
+    #else
+        auto _processID = getpid();
+    #endif
+
+    printf("%llu %llx\n", (unsigned long long)_processID, (unsigned long long)&_region);
+    fflush(stdout);
+
+    // Notes down when each answer comes in. Only the first answer to a
+    // sequence counts, which is how soon the scripts saw it.
+
+    std::thread _watchThread([InputPoll]
+    {
+        uint32_t _last = 0;
+
+        while (_region.quitFlag == 0)
+        {
+            auto _response = _region.response.load();
+
+            if (_response != _last)
+            {
+                auto& _react = _region.reactTime[_response % RingSize];
+
+                if (_react == 0)
+                    _react = ClockNow();
+
+                _last = _response;
+            }
+
+            if (InputPoll > 0)
+                this_thread::sleep_for(std::chrono::microseconds(InputPoll));
+
+            else
+                this_thread::yield();
+        }
+    });
+
+    auto _interval = std::chrono::duration_cast<BenchClock::duration>(std::chrono::duration<double>(1.0 / InputRate));
+    auto _deadline = BenchClock::now();
+
+    while (_region.quitFlag == 0)
+    {
+        _deadline += _interval;
+        this_thread::sleep_until(_deadline);
+
+        auto _next = _region.sequence + 1;
+
+        _region.reactTime[_next % RingSize] = 0;
+        _region.changeTime[_next % RingSize] = ClockNow();
+        _region.sequence = _next;
+    }
+
+    _watchThread.join();
+    return 0;
+}
+
+// THE HARNESS
+
+class NullSink : public MessageSink
+{
+    public:
+        void writeMessage(const string&, int) override { }
+};
+
+// Script 0 answers, the rest are there to give the scheduler something to do.
+
+static const char* _answerCode =
+    "local _last = 0\n"
+    "function _OnFrame()\n"
+    "    local _sequence = ReadInt(SEQUENCE_OFFSET)\n"
+    "    if _sequence ~= _last then\n"
+    "        WriteInt(RESPONSE_OFFSET, _sequence)\n"
+    "        _last = _sequence\n"
+    "    end\n"
+    "end\n";
+
+static const char* _loadCode =
+    "function _OnFrame()\n"
+    "    local _sum = 0\n"
+    "    for i = 0, 63 do _sum = _sum + ReadInt(RESPONSE_OFFSET + 4 + i * 4) end\n"
+    "end\n";
+
+struct LatencyResult
+{
+    string mode;
+    float tickRate;
+
+    uint64_t changeCount;
+    uint64_t answerCount;
+    double p50, p90, p99, max, mean;
+};
+
+static vector<LatencyResult> _resultList;
+
+static void WriteScripts(const filesystem::path& InputDir, int InputCount)
+{
+    filesystem::remove_all(InputDir);
+    filesystem::create_directories(InputDir);
+
+    for (int i = 0; i < InputCount; i++)
+    {
+        ofstream _file((InputDir / ("Script" + to_string(i) + ".lua")).string());
+
+        _file << "SEQUENCE_OFFSET = " << offsetof(LatencyRegion, sequence) << "\n";
+        _file << "RESPONSE_OFFSET = " << offsetof(LatencyRegion, response) << "\n";
+        _file << (i == 0 ? _answerCode : _loadCode);
+    }
+}
+
+// Thread-per-Script, like LuaThread: whole milliseconds, every script on its own.
+
+static void RunThreaded(LuaBackend* _backend, double InputSeconds)
+{
+    atomic<bool> _stopFlag = false;
+    vector<std::thread> _threadList;
+
+    _backend->InitScripts();
+
+    for (auto _script : _backend->loadedScripts)
+    {
+        _threadList.emplace_back([_script, _backend, &_stopFlag]
+        {
+            auto _interval = std::chrono::milliseconds(lround(_backend->frameLimit));
+            auto _deadline = BenchClock::now();
+
+            while (!_stopFlag)
+            {
+                _deadline += _interval;
+                this_thread::sleep_until(_deadline);
+
+                _script->frameCount++;
+
+                string _error;
+
+                if (_script->frameFunction && !LuaBackend::IsWaiting(_script))
+                    LuaBackend::ResumeFrame(_script, _error);
+
+                LuaBackend::CollectGarbage(_script->luaVM.get(), LuaClock::now() + std::chrono::microseconds(200));
+            }
+        });
+    }
+
+    this_thread::sleep_for(std::chrono::duration<double>(InputSeconds));
+    _stopFlag = true;
+
+    for (auto& _thread : _threadList)
+        _thread.join();
+}
+
+static void RunMode(const string& InputMode, float InputRate, const filesystem::path& InputDir, double InputSeconds, uint64_t InputBase)
+{
+    NullSink _sink;
+    auto _backend = new LuaBackend(InputDir.string().c_str(), InputBase, &_sink);
+
+    _backend->frameLimit = 1000.0F / InputRate;
+    _backend->BuildGraph();
+
+    if (InputMode == "Pool")
+        _backend->EnablePool(0);
+
+    if (InputMode == "Synced")
+    {
+        _backend->frameSync.CounterAddress = offsetof(LatencyRegion, sequence);
+        _backend->frameSync.CounterSize = 4;
+    }
+
+    auto _firstSequence = MemoryLib::ReadInt(offsetof(LatencyRegion, sequence));
+
+    if (InputMode == "Thread")
+        RunThreaded(_backend, InputSeconds);
+
+    else
+    {
+        auto _engine = new LuaEngine(_backend);
+        _engine->Post({ LuaEngine::CMD_START });
+
+        this_thread::sleep_for(std::chrono::duration<double>(InputSeconds));
+
+        delete _engine;
+    }
+
+    auto _lastSequence = MemoryLib::ReadInt(offsetof(LatencyRegion, sequence));
+
+    // Give the watcher a moment to see the last answer.
+
+    this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    auto _changeData = MemoryLib::ReadBytes(offsetof(LatencyRegion, changeTime), sizeof(_region.changeTime));
+    auto _reactData = MemoryLib::ReadBytes(offsetof(LatencyRegion, reactTime), sizeof(_region.reactTime));
+
+    auto _changeTime = (const uint64_t*)_changeData.data();
+    auto _reactTime = (const uint64_t*)_reactData.data();
+
+    // Only the sequences the run saw from start to end, and at most a ring's worth.
+    // A change the scripts skipped over was answered by the first answer to any
+    // change after it, so it's charged the time until then. Going backwards,
+    // that is the earliest answer seen so far.
+
+    vector<double> _latencyList;
+
+    uint64_t _changeCount = min<uint64_t>(_lastSequence - _firstSequence, RingSize);
+    uint64_t _firstReact = 0;
+
+    for (uint32_t _sequence = _firstSequence + (uint32_t)_changeCount; _sequence != _firstSequence; _sequence--)
+    {
+        auto _change = _changeTime[_sequence % RingSize];
+        auto _react = _reactTime[_sequence % RingSize];
+
+        if (_react != 0 && (_firstReact == 0 || _react < _firstReact))
+            _firstReact = _react;
+
+        if (_firstReact != 0 && _firstReact >= _change)
+            _latencyList.push_back((_firstReact - _change) / 1000.0);
+    }
+
+    sort(_latencyList.begin(), _latencyList.end());
+
+    LatencyResult _result = { InputMode, InputRate, _changeCount, _latencyList.size(), 0, 0, 0, 0, 0 };
+
+    if (!_latencyList.empty())
+    {
+        auto _size = _latencyList.size();
+
+        _result.p50 = _latencyList[_size / 2];
+        _result.p90 = _latencyList[_size * 90 / 100];
+        _result.p99 = _latencyList[_size * 99 / 100];
+        _result.max = _latencyList.back();
+
+        for (auto _latency : _latencyList)
+            _result.mean += _latency / _size;
+    }
+
+    printf("%-8s %8.0f %10llu %10llu %10.0f %10.0f %10.0f %10.0f %10.0f\n", _result.mode.c_str(), _result.tickRate,
+           (unsigned long long)_result.changeCount, (unsigned long long)_result.answerCount,
+           _result.p50, _result.p90, _result.p99, _result.max, _result.mean);
+
+    fflush(stdout);
+
+    _resultList.push_back(_result);
+    delete _backend;
+}
+
+static bool WriteJson(const string& InputPath, double InputRate, double InputSeconds, int InputScripts)
+{
+    FILE* _file = fopen(InputPath.c_str(), "w");
+
+    if (_file == nullptr)
+        return false;
+
+    fprintf(_file, "{\n  \"benchmark\": \"LatencyBench\",\n  \"version\": 1,\n  \"gameRate\": %.1f,\n  \"seconds\": %.1f,\n  \"scripts\": %d,\n  \"results\": [\n",
+            InputRate, InputSeconds, InputScripts);
+
+    for (size_t i = 0; i < _resultList.size(); i++)
+    {
+        auto& _result = _resultList[i];
+
+        fprintf(_file, "    { \"mode\": \"%s\", \"hz\": %.1f, \"changes\": %llu, \"answers\": %llu, \"p50Us\": %.1f, \"p90Us\": %.1f, \"p99Us\": %.1f, \"maxUs\": %.1f, \"meanUs\": %.1f }%s\n",
+                _result.mode.c_str(), _result.tickRate, (unsigned long long)_result.changeCount, (unsigned long long)_result.answerCount,
+                _result.p50, _result.p90, _result.p99, _result.max, _result.mean, i + 1 < _resultList.size() ? "," : "");
+    }
+
+    fprintf(_file, "  ]\n}\n");
+    return fclose(_file) == 0;
+}
+
+// When the game cannot be talked to, it cannot be told to quit either.
+// It runs forever otherwise, so end it the hard way.
+
+static void StopGame(FILE* InputGame, unsigned long long InputID)
+{
+    #if defined(_WIN32) || defined(_WIN64)
+        if (InputID != 0)
+        {
+            auto _handle = OpenProcess(PROCESS_TERMINATE, false, (DWORD)InputID);
+
+            if (_handle != NULL)
+            {
+                TerminateProcess(_handle, 1);
+                CloseHandle(_handle);
+            }
+        }
+
+        _pclose(InputGame);
+    #else
+        if (InputID != 0)
+            kill((pid_t)InputID, SIGTERM);
+
+        pclose(InputGame);
+    #endif
+}
+
+int main(int argc, char* argv[])
+{
+    double _gameRate = 60;
+    double _runSeconds = 5;
+    int _scriptCount = 8;
+    int _pollTime = 50;
+
+    vector<float> _rateList = { 60, 120, 240 };
+    string _jsonPath;
+    bool _gameMode = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        string _arg = argv[i];
+        auto _value = i + 1 < argc ? argv[i + 1] : "";
+
+        if (_arg == "--game")
+            _gameMode = true;
+
+        else if (_arg == "--rate")
+            _gameRate = strtod(argv[++i], nullptr);
+
+        else if (_arg == "--seconds")
+            _runSeconds = strtod(argv[++i], nullptr);
+
+        else if (_arg == "--scripts")
+            _scriptCount = max(atoi(argv[++i]), 1);
+
+        else if (_arg == "--poll")
+            _pollTime = atoi(argv[++i]);
+
+        else if (_arg == "--json")
+            _jsonPath = argv[++i];
+
+        else if (_arg == "--hz")
+        {
+            _rateList.clear();
+
+            for (auto _text = _value; *_text != '\0'; )
+            {
+                char* _end;
+                auto _rate = strtof(_text, &_end);
+
+                if (_end == _text)
+                    break;
+
+                if (_rate > 0)
+                    _rateList.push_back(_rate);
+
+                _text = *_end == ',' ? _end + 1 : _end;
+            }
+
+            i++;
+        }
+    }
+
+    if (_gameMode)
+        return RunGame(_gameRate, _pollTime);
+
+    // Start the game, and find out where it keeps the region.
+
+    char _command[1024];
+    snprintf(_command, sizeof(_command), "\"%s\" --game --rate %f --poll %d", filesystem::absolute(argv[0]).string().c_str(), _gameRate, _pollTime);
+
+    #if defined(_WIN32) || defined(_WIN64)
+        auto _game = _popen(_command, "r");
+    #else
+        auto _game = popen(_command, "r");
+    #endif
+
+    unsigned long long _gameID = 0, _gameAddress = 0;
+
+    if (_game == nullptr)
+    {
+        fprintf(stderr, "ERROR: The game could not be started.\n");
+        return 1;
+    }
+
+    if (fscanf(_game, "%llu %llx", &_gameID, &_gameAddress) != 2)
+    {
+        fprintf(stderr, "ERROR: The game could not be started.\n");
+        StopGame(_game, _gameID);
+
+        return 1;
+    }
+
+    #if defined(_WIN32) || defined(_WIN64)
+        MemoryLib::PIdentifier = (DWORD)_gameID;
+        MemoryLib::PHandle = OpenProcess(PROCESS_ALL_ACCESS, false, (DWORD)_gameID);
+    #else
+        MemoryLib::PIdentifier = (pid_t)_gameID;
+    #endif
+
+    MemoryLib::SetBaseAddr(_gameAddress);
+    LuaBackend::IdleMaxFactor = 1;
+
+    if (MemoryLib::ReadString(0, 8) != "LATBENCH")
+    {
+        fprintf(stderr, "ERROR: The game's memory cannot be read. On Linux, this needs ptrace access to children (kernel.yama.ptrace_scope <= 1).\n");
+        StopGame(_game, _gameID);
+
+        return 1;
+    }
+
+    auto _benchDir = filesystem::temp_directory_path() / "LatencyBench";
+    WriteScripts(_benchDir, _scriptCount);
+
+    printf("Game: %.0f changes/s, watched every %dus. Scripts: %d, %.1fs per mode.\n\n", _gameRate, _pollTime, _scriptCount, _runSeconds);
+    printf("%-8s %8s %10s %10s %10s %10s %10s %10s %10s\n", "Mode", "Hz", "Changes", "Answered", "p50 (us)", "p90 (us)", "p99 (us)", "Max (us)", "Mean (us)");
+
+    for (auto _rate : _rateList)
+        for (auto _mode : { "Single", "Pool", "Thread" })
+            RunMode(_mode, _rate, _benchDir, _runSeconds, _gameAddress);
+
+    RunMode("Synced", (float)_gameRate, _benchDir, _runSeconds, _gameAddress);
+
+    // Tell the game to quit, and wait for it to.
+
+    MemoryLib::WriteInt(offsetof(LatencyRegion, quitFlag), 1);
+
+    #if defined(_WIN32) || defined(_WIN64)
+        _pclose(_game);
+    #else
+        pclose(_game);
+    #endif
+
+    filesystem::remove_all(_benchDir);
+
+    if (!_jsonPath.empty())
+    {
+        if (WriteJson(_jsonPath, _gameRate, _runSeconds, _scriptCount))
+            printf("\nResults written to \"%s\".\n", _jsonPath.c_str());
+
+        else
+            printf("\nThe results cannot be written to \"%s\".\n", _jsonPath.c_str());
+    }
+
+    return 0;
+}
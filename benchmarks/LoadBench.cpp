@@ -0,0 +1,90 @@
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+
+#include <LuaBackend.hpp>
+
+// Measures how long loading a script folder takes, through the real backend
+// out of the engine library: finding the scripts, a VM and the bindings for
+// every one of them, parsing, and running their _OnInit. This is what every
+// start and every reload of the GUI goes through.
+
+using BenchClock = std::chrono::steady_clock;
+
+static const char* _scriptCode =
+    "LUAGUI_HZ = 60\n"
+    "local _table = {}\n"
+    "function _OnInit() for i = 1, 256 do _table[i] = i * 2 end end\n"
+    "function _OnFrame() local _sum = 0 for i = 1, #_table do _sum = _sum + _table[i] end end\n";
+
+// Nobody to show the messages to.
+
+class NullSink : public MessageSink
+{
+    public:
+        void writeMessage(const string&, int) override { }
+};
+
+struct BenchResult { double p50, p99, max; };
+
+static BenchResult Summarize(vector<double>& _timeList)
+{
+    sort(_timeList.begin(), _timeList.end());
+
+    auto _size = _timeList.size();
+    return { _timeList[_size / 2], _timeList[_size * 99 / 100], _timeList.back() };
+}
+
+int main(int argc, char* argv[])
+{
+    int _loadCount = argc > 1 ? atoi(argv[1]) : 20;
+
+    #if defined(_WIN32) || defined(_WIN64)
+        MemoryLib::PHandle = GetCurrentProcess();
+    #else
+        MemoryLib::PIdentifier = getpid();
+    #endif
+
+    auto _benchDir = filesystem::temp_directory_path() / "LoadBench";
+    NullSink _sink;
+
+    printf("Loads: %d\n\n", _loadCount);
+    printf("%-8s %-8s %12s %12s %12s\n", "Scripts", "Mode", "p50 (ms)", "p99 (ms)", "Max (ms)");
+
+    for (int _scriptCount : { 1, 4, 16, 40, 80 })
+    {
+        filesystem::remove_all(_benchDir);
+        filesystem::create_directories(_benchDir);
+
+        for (int i = 0; i < _scriptCount; i++)
+            ofstream((_benchDir / ("Script" + to_string(i) + ".lua")).string()) << _scriptCode;
+
+        for (bool _sharedMode : { false, true })
+        {
+            vector<double> _timeList;
+
+            for (int i = 0; i < _loadCount; i++)
+            {
+                auto _start = BenchClock::now();
+
+                auto _backend = new LuaBackend(_benchDir.string().c_str(), 0, &_sink, 0, _sharedMode);
+                _backend->InitScripts();
+
+                _timeList.push_back(std::chrono::duration<double, std::milli>(BenchClock::now() - _start).count());
+
+                delete _backend;
+            }
+
+            auto _result = Summarize(_timeList);
+            printf("%-8d %-8s %12.2f %12.2f %12.2f\n", _scriptCount, _sharedMode ? "Shared" : "Single", _result.p50, _result.p99, _result.max);
+        }
+
+        printf("\n");
+    }
+
+    filesystem::remove_all(_benchDir);
+    return 0;
+}
@@ -0,0 +1,29 @@
+TEMPLATE = app
+
+QT -= core gui
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+TARGET = LoadBench
+
+LIBS += -L$$PWD/../libraries/ -lluaengine -llua -ldiscord-rpc
+
+win32: LIBS += -lwinmm
+unix: LIBS += -lpthread -ldl
+
+win32: PRE_TARGETDEPS += $$PWD/../libraries/luaengine.lib
+unix: PRE_TARGETDEPS += $$PWD/../libraries/libluaengine.a
+
+SOURCES += \
+    LoadBench.cpp
+
+INCLUDEPATH += \
+    $$PWD/../ \
+    $$PWD/../include/ \
+    $$PWD/../include/lua \
+    $$PWD/../include/sol2 \
+    $$PWD/../include/crcpp \
+    $$PWD/../include/discord
+
+DEPENDPATH += \
+    $$PWD/../include/lua
@@ -0,0 +1,448 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+
+#include <LuaBackend.hpp>
+
+// The hot paths, one at a time, with the results written out as JSON so that
+// two runs can be compared. Covers:
+//
+//     binding  => One Read*/Write* call from Lua, for every variant.
+//     array    => ReadArray/WriteArray at a few sizes.
+//     endian   => Decoding values in either byte order, no Lua involved.
+//     load     => Constructing the backend, which loads N scripts.
+//     tick     => One RunFrame with N scripts, all of them due.
+//
+// Memory is either a buffer served through a MemorySource ("buffer"), which
+// is what the bindings themselves cost, or this very process read through
+// the OS ("process"), which is what reading a game costs on top of that.
+//
+//     MicroBench [--count N] [--json out.json] [--baseline old.json]
+
+using BenchClock = std::chrono::steady_clock;
+
+static constexpr size_t BufferSize = 1 << 20;
+static constexpr uint64_t BufferAddress = 0x10000000;
+
+// The "game" for the buffer target. Anything outside of it reads as zero.
+
+class BufferSource : public MemorySource
+{
+    public:
+        vector<uint8_t> Data = vector<uint8_t>(BufferSize);
+
+        void Read(uint64_t InputAddress, void* OutBuffer, size_t InputSize) override
+        {
+            auto _offset = InputAddress - BufferAddress;
+
+            if (_offset < Data.size() && InputSize <= Data.size() - _offset)
+                memcpy(OutBuffer, Data.data() + _offset, InputSize);
+
+            else
+                memset(OutBuffer, 0, InputSize);
+        }
+
+        void Write(uint64_t InputAddress, const void* InputBuffer, size_t InputSize) override
+        {
+            auto _offset = InputAddress - BufferAddress;
+
+            if (_offset < Data.size() && InputSize <= Data.size() - _offset)
+                memcpy(Data.data() + _offset, InputBuffer, InputSize);
+        }
+};
+
+class NullSink : public MessageSink
+{
+    public:
+        void writeMessage(const string&, int) override { }
+};
+
+struct BenchResult
+{
+    string group;
+    string name;
+    string target;
+    size_t size;
+
+    uint64_t count;
+    double nsPerOp;
+    double bestNs;
+};
+
+static vector<BenchResult> _resultList;
+static BufferSource _bufferSource;
+static vector<uint8_t> _processBuffer(BufferSize);
+
+static const int _repeatCount = 5;
+
+// Points MemoryLib at the given target, with the base address at the start of it.
+
+static void UseTarget(const string& InputTarget)
+{
+    if (InputTarget == "buffer")
+    {
+        MemoryLib::Source = &_bufferSource;
+        MemoryLib::SetBaseAddr(BufferAddress);
+    }
+
+    else
+    {
+        MemoryLib::Source = nullptr;
+        MemoryLib::SetBaseAddr((uint64_t)_processBuffer.data());
+    }
+}
+
+// Runs "InputFunction" a few times over, keeping the median and the best
+// time per operation, in nanoseconds.
+
+template <typename F> static void Measure(const string& InputGroup, const string& InputName, const string& InputTarget, size_t InputSize, uint64_t InputCount, F InputFunction)
+{
+    vector<double> _timeList;
+
+    for (int i = 0; i < _repeatCount; i++)
+    {
+        auto _start = BenchClock::now();
+        InputFunction();
+        _timeList.push_back(std::chrono::duration<double, std::nano>(BenchClock::now() - _start).count() / InputCount);
+    }
+
+    sort(_timeList.begin(), _timeList.end());
+
+    _resultList.push_back({ InputGroup, InputName, InputTarget, InputSize, InputCount, _timeList[_repeatCount / 2], _timeList.front() });
+
+    auto& _result = _resultList.back();
+    printf("%-8s %-20s %-8s %8zu %14.1f %14.1f %14.0f\n", _result.group.c_str(), _result.name.c_str(), _result.target.c_str(),
+           _result.size, _result.nsPerOp, _result.bestNs, 1e9 / _result.nsPerOp);
+}
+
+// A Lua loop making the same call "InputCount" times, through the real bindings.
+
+static void BenchBinding(LuaState& _state, const string& InputName, const string& InputCall, const string& InputTarget, size_t InputSize, uint64_t InputCount)
+{
+    auto _code = "local _count = ... for i = 1, _count do " + InputCall + " end";
+    sol::protected_function _function = _state.load(_code);
+
+    Measure("binding", InputName, InputTarget, InputSize, InputCount, [&] { _function(InputCount); });
+}
+
+static void BenchBindings(LuaBackend* _backend, uint64_t InputCount)
+{
+    LuaState _state;
+    _state.open_libraries(sol::lib::base, sol::lib::math, sol::lib::string);
+
+    _backend->SetFunctions(&_state);
+
+    const char* _cases[][3] =
+    {
+        { "Loop", "", "0" },
+        { "ReadByte", "ReadByte(0x100)", "1" },
+        { "ReadShort", "ReadShort(0x100)", "2" },
+        { "ReadInt", "ReadInt(0x100)", "4" },
+        { "ReadLong", "ReadLong(0x100)", "8" },
+        { "ReadFloat", "ReadFloat(0x100)", "4" },
+        { "ReadBoolean", "ReadBoolean(0x100)", "1" },
+        { "ReadString", "ReadString(0x100, 16)", "16" },
+        { "WriteByte", "WriteByte(0x100, i % 256)", "1" },
+        { "WriteShort", "WriteShort(0x100, i % 65536)", "2" },
+        { "WriteInt", "WriteInt(0x100, i)", "4" },
+        { "WriteLong", "WriteLong(0x100, i)", "8" },
+        { "WriteFloat", "WriteFloat(0x100, i * 0.5)", "4" },
+        { "WriteBoolean", "WriteBoolean(0x100, i % 2 == 0)", "1" },
+        { "WriteString", "WriteString(0x100, \"LuaFrontend Test\")", "16" },
+    };
+
+    for (auto _target : { "buffer", "process" })
+    {
+        UseTarget(_target);
+
+        for (auto& _case : _cases)
+            BenchBinding(_state, _case[0], _case[1], _target, atoi(_case[2]), InputCount);
+
+        // Arrays get fewer calls as they grow, so that every size moves about as many bytes.
+
+        _state["BENCH_TABLE"] = _state.create_table();
+
+        for (size_t _size : { 16, 256, 4096, 65536 })
+        {
+            auto _count = max<uint64_t>(InputCount * 16 / _size, 64);
+            auto _table = _state.create_table();
+
+            for (size_t i = 1; i <= _size; i++)
+                _table[i] = i % 256;
+
+            _state["BENCH_TABLE"] = _table;
+
+            BenchBinding(_state, "ReadArray", "ReadArray(0x100, " + to_string(_size) + ")", _target, _size, _count);
+            BenchBinding(_state, "WriteArray", "WriteArray(0x100, BENCH_TABLE)", _target, _size, _count);
+        }
+    }
+}
+
+// Decoding alone, straight through MemoryLib, in both byte orders.
+
+static void BenchEndian(uint64_t InputCount)
+{
+    UseTarget("buffer");
+
+    volatile uint64_t _sink = 0;
+
+    for (bool _bigEndian : { false, true })
+    {
+        MemoryLib::BigEndian = _bigEndian;
+        string _suffix = _bigEndian ? "(BE)" : "(LE)";
+
+        Measure("endian", "ReadShort" + _suffix, "buffer", 2, InputCount, [&] { for (uint64_t i = 0; i < InputCount; i++) _sink = _sink + MemoryLib::ReadShort(0x100 + (i & 0xFF)); });
+        Measure("endian", "ReadInt" + _suffix, "buffer", 4, InputCount, [&] { for (uint64_t i = 0; i < InputCount; i++) _sink = _sink + MemoryLib::ReadInt(0x100 + (i & 0xFF)); });
+        Measure("endian", "ReadLong" + _suffix, "buffer", 8, InputCount, [&] { for (uint64_t i = 0; i < InputCount; i++) _sink = _sink + MemoryLib::ReadLong(0x100 + (i & 0xFF)); });
+        Measure("endian", "ReadFloat" + _suffix, "buffer", 4, InputCount, [&] { for (uint64_t i = 0; i < InputCount; i++) _sink = _sink + (uint64_t)MemoryLib::ReadFloat(0x100 + (i & 0xFF)); });
+        Measure("endian", "WriteInt" + _suffix, "buffer", 4, InputCount, [&] { for (uint64_t i = 0; i < InputCount; i++) MemoryLib::WriteInt(0x100 + (i & 0xFF), (uint32_t)i); });
+    }
+
+    MemoryLib::BigEndian = false;
+}
+
+static const char* _scriptCode =
+    "LUAGUI_NAME = \"MicroBench\"\n"
+    "local _table = {}\n"
+    "function _OnInit() for i = 1, 256 do _table[i] = i * 2 end end\n"
+    "function _OnFrame()\n"
+    "    local _sum = 0\n"
+    "    for i = 0, 127 do _sum = _sum + ReadInt(i * 4) end\n"
+    "    WriteInt(0x1000 + SCRIPT_SLOT * 4, _sum % 256)\n"
+    "end\n";
+
+static void WriteScripts(const filesystem::path& InputDir, int InputCount)
+{
+    filesystem::remove_all(InputDir);
+    filesystem::create_directories(InputDir);
+
+    for (int i = 0; i < InputCount; i++)
+        ofstream((InputDir / ("Script" + to_string(i) + ".lua")).string()) << "SCRIPT_SLOT = " << i << "\n" << _scriptCode;
+}
+
+static void BenchScripts(const filesystem::path& InputDir, uint64_t InputTicks)
+{
+    NullSink _sink;
+
+    for (int _scriptCount : { 1, 10, 50, 100 })
+    {
+        WriteScripts(InputDir, _scriptCount);
+
+        // Loading does not touch the game, so there is no target to speak of.
+
+        Measure("load", "LoadScripts", "none", _scriptCount, 1, [&]
+        {
+            auto _backend = new LuaBackend(InputDir.string().c_str(), BufferAddress, &_sink);
+            delete _backend;
+        });
+
+        for (auto _target : { "buffer", "process" })
+        {
+            UseTarget(_target);
+
+            auto _backend = new LuaBackend(InputDir.string().c_str(), MemoryLib::BaseAddress, &_sink);
+            _backend->InitScripts();
+
+            // Every tick is a whole interval after the last, so every script is due.
+            // Once more without the frame profiler, and once more with the timeline
+            // recording, to tell what each costs.
+
+            auto _interval = _backend->TickInterval();
+            double _tickTime = 0;
+
+            const char* _modeNames[] = { "RunFrame", "RunFrame/NoProfile", "RunFrame/Timeline" };
+
+            for (int _mode : { 0, 1, 2 })
+            {
+                LuaBackend::ProfileFrames = _mode != 1;
+                TimelineTrace::Enabled = _mode == 2;
+
+                Measure("tick", _modeNames[_mode], _target, _scriptCount, InputTicks, [&]
+                {
+                    for (uint64_t i = 0; i < InputTicks; i++)
+                    {
+                        _tickTime += _interval;
+                        _backend->RunFrame(_tickTime);
+                    }
+
+                    _backend->CollectGarbage(LuaClock::now());
+                });
+            }
+
+            LuaBackend::ProfileFrames = true;
+            TimelineTrace::Enabled = false;
+
+            delete _backend;
+        }
+    }
+
+    filesystem::remove_all(InputDir);
+}
+
+static string JsonText(const string& InputText)
+{
+    string _return;
+
+    for (auto _char : InputText)
+    {
+        if (_char == '"' || _char == '\\')
+            _return += '\\';
+
+        _return += _char;
+    }
+
+    return _return;
+}
+
+// One result per line, so that --baseline can read it back without a JSON parser.
+
+static bool WriteJson(const string& InputPath, uint64_t InputCount)
+{
+    FILE* _file = fopen(InputPath.c_str(), "w");
+
+    if (_file == nullptr)
+        return false;
+
+    #if defined(_WIN32) || defined(_WIN64)
+        auto _platform = "windows";
+    #else
+        auto _platform = "linux";
+    #endif
+
+    fprintf(_file, "{\n  \"benchmark\": \"MicroBench\",\n  \"version\": 1,\n  \"platform\": \"%s\",\n  \"count\": %llu,\n  \"repeats\": %d,\n  \"results\": [\n",
+            _platform, (unsigned long long)InputCount, _repeatCount);
+
+    for (size_t i = 0; i < _resultList.size(); i++)
+    {
+        auto& _result = _resultList[i];
+
+        fprintf(_file, "    { \"group\": \"%s\", \"name\": \"%s\", \"target\": \"%s\", \"size\": %zu, \"count\": %llu, \"nsPerOp\": %.3f, \"bestNs\": %.3f }%s\n",
+                JsonText(_result.group).c_str(), JsonText(_result.name).c_str(), JsonText(_result.target).c_str(), _result.size,
+                (unsigned long long)_result.count, _result.nsPerOp, _result.bestNs, i + 1 < _resultList.size() ? "," : "");
+    }
+
+    fprintf(_file, "  ]\n}\n");
+    return fclose(_file) == 0;
+}
+
+static string JsonField(const string& InputLine, const string& InputKey)
+{
+    auto _key = "\"" + InputKey + "\": ";
+    auto _start = InputLine.find(_key);
+
+    if (_start == string::npos)
+        return "";
+
+    _start += _key.size();
+
+    if (InputLine[_start] == '"')
+        return InputLine.substr(_start + 1, InputLine.find('"', _start + 1) - _start - 1);
+
+    return InputLine.substr(_start, InputLine.find_first_of(",}", _start) - _start);
+}
+
+// Compares this run against one written out before, case by case.
+
+static void CompareBaseline(const string& InputPath)
+{
+    ifstream _file(InputPath);
+
+    if (!_file)
+    {
+        printf("\nThe baseline \"%s\" cannot be read.\n", InputPath.c_str());
+        return;
+    }
+
+    printf("\nAgainst \"%s\" (negative is faster):\n\n", InputPath.c_str());
+    printf("%-8s %-20s %-8s %8s %14s %14s %9s\n", "Group", "Name", "Target", "Size", "Before (ns)", "Now (ns)", "Change");
+
+    string _line;
+
+    while (getline(_file, _line))
+    {
+        auto _group = JsonField(_line, "group");
+
+        if (_group.empty())
+            continue;
+
+        auto _name = JsonField(_line, "name");
+        auto _target = JsonField(_line, "target");
+        auto _size = strtoull(JsonField(_line, "size").c_str(), nullptr, 10);
+        auto _before = strtod(JsonField(_line, "nsPerOp").c_str(), nullptr);
+
+        for (auto& _result : _resultList)
+        {
+            if (_result.group != _group || _result.name != _name || _result.target != _target || _result.size != _size)
+                continue;
+
+            printf("%-8s %-20s %-8s %8zu %14.1f %14.1f %+8.1f%%\n", _group.c_str(), _name.c_str(), _target.c_str(), (size_t)_size,
+                   _before, _result.nsPerOp, _before > 0 ? (_result.nsPerOp / _before - 1) * 100 : 0);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    uint64_t _count = 200000;
+    string _jsonPath;
+    string _baselinePath;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        string _arg = argv[i];
+
+        if (_arg == "--count")
+            _count = strtoull(argv[i + 1], nullptr, 10);
+
+        else if (_arg == "--json")
+            _jsonPath = argv[i + 1];
+
+        else if (_arg == "--baseline")
+            _baselinePath = argv[i + 1];
+    }
+
+    #if defined(_WIN32) || defined(_WIN64)
+        MemoryLib::PHandle = GetCurrentProcess();
+    #else
+        MemoryLib::PIdentifier = getpid();
+    #endif
+
+    auto _benchDir = filesystem::temp_directory_path() / "MicroBench";
+
+    printf("Calls: %llu, Repeats: %d\n\n", (unsigned long long)_count, _repeatCount);
+    printf("%-8s %-20s %-8s %8s %14s %14s %14s\n", "Group", "Name", "Target", "Size", "Median (ns)", "Best (ns)", "Ops/s");
+
+    // Only here for SetFunctions, so no scripts.
+
+    NullSink _sink;
+    filesystem::create_directories(_benchDir);
+
+    auto _bindingBackend = new LuaBackend(_benchDir.string().c_str(), BufferAddress, &_sink);
+
+    BenchBindings(_bindingBackend, _count);
+    BenchEndian(_count * 10);
+    BenchScripts(_benchDir, max<uint64_t>(_count / 1000, 20));
+
+    delete _bindingBackend;
+
+    MemoryLib::Source = nullptr;
+
+    if (!_jsonPath.empty())
+    {
+        if (WriteJson(_jsonPath, _count))
+            printf("\nResults written to \"%s\".\n", _jsonPath.c_str());
+
+        else
+            printf("\nThe results cannot be written to \"%s\".\n", _jsonPath.c_str());
+    }
+
+    if (!_baselinePath.empty())
+        CompareBaseline(_baselinePath);
+
+    return 0;
+}
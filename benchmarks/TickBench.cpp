@@ -0,0 +1,206 @@
+#include <mutex>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <condition_variable>
+#include <sol.hpp>
+
+#include <MemoryLib.hpp>
+#include <WorkerPool.hpp>
+#include <LuaMemoryLib.hpp>
+
+// Measures how long one tick takes, from the moment it starts to the moment
+// the last _OnFrame of it returns, against the number of scripts running.
+// Every script has its own state, and does a bit of reading and math on a
+// local buffer, which is about what a typical script does with a game.
+//
+// "Single" runs the frames one after the other, like the main loop does.
+// "Thread" gives every script its own thread like Thread-per-Script does,
+// woken together and waited upon, which is the best that mode can do.
+// "Pool" runs them on the work-stealing pool, one worker per core.
+
+using BenchClock = std::chrono::steady_clock;
+
+static uint8_t _targetBuffer[4096];
+
+static const char* _frameCode =
+    "function _OnFrame() "
+    "    local _sum = 0 "
+    "    for i = 0, 127 do _sum = _sum + ReadInt(BUFFER_ADDR + i * 4, true) * 0.5 end "
+    "    WriteInt(BUFFER_ADDR + SCRIPT_SLOT * 4, math.floor(_sum) % 256, true) "
+    "end";
+
+struct BenchScript
+{
+    sol::state luaState;
+    sol::protected_function frameFunction;
+};
+
+static void RunScript(BenchScript* _script)
+{
+    auto _result = _script->frameFunction();
+
+    if (!_result.valid())
+    {
+        sol::error _err = _result;
+        printf("%s\n", _err.what());
+    }
+}
+
+struct BenchResult { double p50, p99, max; };
+
+static BenchResult Summarize(vector<double>& _timeList)
+{
+    sort(_timeList.begin(), _timeList.end());
+
+    auto _size = _timeList.size();
+    return { _timeList[_size / 2], _timeList[_size * 99 / 100], _timeList.back() };
+}
+
+template <typename Func>
+static BenchResult TimeTicks(int _tickCount, Func&& _tick)
+{
+    vector<double> _timeList;
+    _timeList.reserve(_tickCount);
+
+    for (int i = 0; i < _tickCount; i++)
+    {
+        auto _start = BenchClock::now();
+        _tick();
+        _timeList.push_back(std::chrono::duration<double, std::micro>(BenchClock::now() - _start).count());
+    }
+
+    return Summarize(_timeList);
+}
+
+static BenchResult BenchSingle(vector<BenchScript*>& _scriptList, int _tickCount)
+{
+    return TimeTicks(_tickCount, [&]
+    {
+        for (auto _script : _scriptList)
+            RunScript(_script);
+    });
+}
+
+static BenchResult BenchThread(vector<BenchScript*>& _scriptList, int _tickCount)
+{
+    mutex _lock;
+    condition_variable _startCond, _doneCond;
+
+    uint64_t _tickID = 0;
+    size_t _doneCount = 0;
+    bool _stopping = false;
+
+    vector<thread> _threadList;
+
+    for (auto _script : _scriptList)
+    {
+        _threadList.emplace_back([&, _script]
+        {
+            uint64_t _seenID = 0;
+
+            while (true)
+            {
+                {
+                    unique_lock<mutex> _wait(_lock);
+                    _startCond.wait(_wait, [&] { return _stopping || _tickID != _seenID; });
+
+                    if (_stopping)
+                        return;
+
+                    _seenID = _tickID;
+                }
+
+                RunScript(_script);
+
+                lock_guard<mutex> _guard(_lock);
+
+                if (++_doneCount == _scriptList.size())
+                    _doneCond.notify_all();
+            }
+        });
+    }
+
+    auto _result = TimeTicks(_tickCount, [&]
+    {
+        unique_lock<mutex> _wait(_lock);
+
+        _doneCount = 0;
+        _tickID++;
+
+        _startCond.notify_all();
+        _doneCond.wait(_wait, [&] { return _doneCount == _scriptList.size(); });
+    });
+
+    {
+        lock_guard<mutex> _guard(_lock);
+        _stopping = true;
+    }
+
+    _startCond.notify_all();
+
+    for (auto& _thread : _threadList)
+        _thread.join();
+
+    return _result;
+}
+
+static BenchResult BenchPool(vector<BenchScript*>& _scriptList, int _tickCount, WorkerPool& _pool)
+{
+    function<size_t(size_t)> _affinity = [](size_t _index) { return _index; };
+    function<void(size_t)> _task = [&](size_t _index) { RunScript(_scriptList[_index]); };
+
+    return TimeTicks(_tickCount, [&] { _pool.Run(_scriptList.size(), _affinity, _task); });
+}
+
+int main(int argc, char* argv[])
+{
+    int _tickCount = argc > 1 ? atoi(argv[1]) : 1000;
+
+    #if defined(_WIN32) || defined(_WIN64)
+        MemoryLib::PHandle = GetCurrentProcess();
+    #else
+        MemoryLib::PIdentifier = getpid();
+    #endif
+
+    WorkerPool _pool;
+
+    printf("Ticks: %d, Workers: %zu\n\n", _tickCount, _pool.Size());
+    printf("%-8s %-8s %12s %12s %12s\n", "Scripts", "Mode", "p50 (us)", "p99 (us)", "Max (us)");
+
+    for (int _scriptCount : { 1, 4, 16, 40, 80, 160 })
+    {
+        vector<BenchScript*> _scriptList;
+
+        for (int i = 0; i < _scriptCount; i++)
+        {
+            auto _script = new BenchScript();
+
+            _script->luaState.open_libraries(sol::lib::base, sol::lib::math);
+            LuaMemoryLib::Register(_script->luaState.lua_state());
+
+            _script->luaState["BUFFER_ADDR"] = (uint64_t)_targetBuffer;
+            _script->luaState["SCRIPT_SLOT"] = i % 1024;
+
+            _script->luaState.script(_frameCode);
+            _script->frameFunction = _script->luaState["_OnFrame"];
+
+            _scriptList.push_back(_script);
+        }
+
+        auto _single = BenchSingle(_scriptList, _tickCount);
+        auto _thread = BenchThread(_scriptList, _tickCount);
+        auto _pooled = BenchPool(_scriptList, _tickCount, _pool);
+
+        printf("%-8d %-8s %12.1f %12.1f %12.1f\n", _scriptCount, "Single", _single.p50, _single.p99, _single.max);
+        printf("%-8d %-8s %12.1f %12.1f %12.1f\n", _scriptCount, "Thread", _thread.p50, _thread.p99, _thread.max);
+        printf("%-8d %-8s %12.1f %12.1f %12.1f\n\n", _scriptCount, "Pool", _pooled.p50, _pooled.p99, _pooled.max);
+
+        for (auto _script : _scriptList)
+            delete _script;
+    }
+
+    return 0;
+}
@@ -0,0 +1,20 @@
+TEMPLATE = app
+
+QT -= core gui
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+TARGET = TickBench
+
+LIBS += -L$$PWD/../libraries/ -llua
+
+SOURCES += \
+    TickBench.cpp
+
+INCLUDEPATH += \
+    $$PWD/../include/ \
+    $$PWD/../include/lua \
+    $$PWD/../include/sol2
+
+DEPENDPATH += \
+    $$PWD/../include/lua
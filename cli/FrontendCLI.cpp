@@ -0,0 +1,1200 @@
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cctype>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <filesystem>
+#include <toml.hpp>
+
+#include <LuaEngine.hpp>
+#include <LuaBackend.hpp>
+#include <MemoryDump.hpp>
+#include <ProcessDump.hpp>
+#include <ProcessStats.hpp>
+#include <MemoryTrace.hpp>
+#include <TimelineTrace.hpp>
+
+// Runs a game's scripts with no window at all, for automated runs and benchmarks.
+// Reads the same "configs/gameConfig.toml" the GUI does, latches into the game
+// (or a given process), and runs the frame loop on the engine thread until
+// the time is up, the game exits, every script stopped, or Ctrl+C.
+//
+// Exit codes:
+//     0 => Ran to the end.
+//     1 => Bad arguments or configuration.
+//     2 => Could not latch into the game.
+//     3 => No scripts were loaded.
+//     4 => A script errored out or was stopped.
+//     5 => Replaying a trace, the scripts wrote something else than back then.
+//     6 => The memory dump could not be opened, or saved.
+//     7 => Soaking, memory or threads kept growing from cycle to cycle, or the scripts did not run after a reload.
+
+namespace fs = std::filesystem;
+
+enum ExitCode { EXIT_DONE, EXIT_USAGE, EXIT_LATCH, EXIT_SCRIPTS, EXIT_ERRORED, EXIT_DIVERGED, EXIT_DUMP, EXIT_SOAK };
+
+static atomic<bool> _quitFlag = false;
+
+struct CliOptions
+{
+    string configPath;
+    string gameName;
+    string scriptPath;
+    string recordPath;
+    string replayPath;
+    string dumpPath;
+    string dumpBase;
+    string savePath;
+    string sampleName;
+    string samplePath;
+    string timelinePath;
+    vector<string> scriptList;
+
+    uint64_t processID = 0;
+    uint64_t frameCount = 600;
+    uint64_t soakCount = 0;
+    float tickRate = 0;
+    double runDuration = 0;
+    double latchTimeout = 30;
+    size_t poolWorkers = 0;
+
+    bool poolBool = false;
+    bool idleBool = true;
+    bool writableBool = false;
+};
+
+// The backend speaks HTML to the GUI console. Make it plain text again.
+
+class StdoutSink : public MessageSink
+{
+    public:
+        atomic<int> ErrorCount = 0;
+
+        // Messages below this type are left out, but for the count.
+
+        int MinimumType = 0;
+
+        void writeMessage(const string& InputText, int InputType = 0) override
+        {
+            if (InputType == 3)
+                ErrorCount++;
+
+            if (InputType < MinimumType)
+                return;
+
+            static const char* _titles[] = { "MESSAGE", "SUCCESS", "WARNING", "ERROR" };
+
+            // Line breaks become new lines, every other tag goes away.
+
+            string _text;
+            bool _inTag = false;
+
+            for (size_t i = 0; i < InputText.size(); i++)
+            {
+                if (InputText.compare(i, 4, "<br>") == 0)
+                {
+                    _text += '\n';
+                    i += 3;
+                }
+
+                else if (InputText[i] == '<')
+                    _inTag = true;
+
+                else if (InputText[i] == '>' && _inTag)
+                    _inTag = false;
+
+                else if (!_inTag)
+                    _text += InputText[i];
+            }
+
+            while (!_text.empty() && isspace((unsigned char)_text.back()))
+                _text.pop_back();
+
+            lock_guard<mutex> _lock(_printLock);
+            TimelineTrace::Span _span("Print", "console");
+
+            fprintf(InputType >= 2 ? stderr : stdout, "%s: %s\n", _titles[InputType & 3], _text.c_str());
+            fflush(stdout);
+        }
+
+    private:
+        mutex _printLock;
+};
+
+static void PrintUsage()
+{
+    printf("Usage: luafrontend-cli --game <title|index> [options]\n\n"
+           "    --config <file>      The game configuration, \"configs/gameConfig.toml\" next to this executable by default.\n"
+           "    --game <title>       The game entry to run, by title or by index.\n"
+           "    --pid <id>           Attach to this process instead of looking for the game's executable.\n"
+           "    --scripts <dir>      Load the scripts from here instead of the game's script folder.\n"
+           "    --only <a.lua,...>   Only run these scripts, by file name.\n"
+           "    --hz <rate>          The tick rate for scripts without one of their own, 60 by default.\n"
+           "    --duration <secs>    Stop after this long. 0, the default, runs until the game exits.\n"
+           "    --timeout <secs>     How long to wait for the game to start, 30 by default.\n"
+           "    --pool [workers]     Run the scripts of every tick on the worker pool.\n"
+           "    --no-idle            Never slow down while the game sits idle.\n"
+           "    --record <file>      Write every read and write the scripts make into a trace.\n"
+           "    --replay <file>      Run the scripts against a trace at full speed, no game needed. Only\n"
+           "                         needs --game or --scripts, to know where the scripts are.\n"
+           "    --dump <file>        Run the scripts against a memory dump, a raw image or an ELF core file.\n"
+           "                         Writes go to a copy, the file is never changed.\n"
+           "    --base <hex>         The base address with --dump, the game's by default. Raw images sit there.\n"
+           "    --frames <count>     How many frames to run with --dump, 600 by default.\n"
+           "    --save-dump <file>   Dump the game's memory into a file, which --dump can open, and exit.\n"
+           "    --writable-only      Only dump the memory the game can write to, which leaves out its code.\n"
+           "    --sample <a.lua>     Sample where this script spends its time, down to the line, for a flame graph.\n"
+           "    --sample-out <file>  Where the samples go, \"<script>.folded\" by default. Collapsed stacks, or\n"
+           "                         speedscope if it ends in \".json\".\n"
+           "    --timeline <file>    Write a Chrome trace of the ticks, the scripts and their reads and writes at the end.\n"
+           "    --timeline-size <n>  How many spans every thread keeps for --timeline, the last 32768 by default.\n"
+           "    --soak [cycles]      Start, reload and stop the scripts over and over, 1000 times by default, against\n"
+           "                         --dump or against nothing at all. Fails if memory or threads keep growing.\n");
+}
+
+static bool ParseOptions(int argc, char* argv[], CliOptions& OutOptions)
+{
+    auto _exeDir = fs::absolute(argv[0]).parent_path();
+    OutOptions.configPath = (_exeDir / "configs" / "gameConfig.toml").string();
+
+    for (int i = 1; i < argc; i++)
+    {
+        string _arg = argv[i];
+        auto _hasValue = i + 1 < argc && argv[i + 1][0] != '-';
+
+        if (_arg == "--no-idle")
+            OutOptions.idleBool = false;
+
+        else if (_arg == "--writable-only")
+            OutOptions.writableBool = true;
+
+        else if (_arg == "--pool")
+        {
+            OutOptions.poolBool = true;
+
+            if (_hasValue)
+                OutOptions.poolWorkers = strtoull(argv[++i], nullptr, 10);
+        }
+
+        else if (_arg == "--soak")
+        {
+            OutOptions.soakCount = 1000;
+
+            if (_hasValue)
+                OutOptions.soakCount = strtoull(argv[++i], nullptr, 10);
+        }
+
+        else if (!_hasValue)
+        {
+            fprintf(stderr, "ERROR: \"%s\" is not an option, or is missing its value.\n\n", argv[i]);
+            return false;
+        }
+
+        else if (_arg == "--config")
+            OutOptions.configPath = argv[++i];
+
+        else if (_arg == "--game")
+            OutOptions.gameName = argv[++i];
+
+        else if (_arg == "--pid")
+            OutOptions.processID = strtoull(argv[++i], nullptr, 10);
+
+        else if (_arg == "--scripts")
+            OutOptions.scriptPath = argv[++i];
+
+        else if (_arg == "--record")
+            OutOptions.recordPath = argv[++i];
+
+        else if (_arg == "--replay")
+            OutOptions.replayPath = argv[++i];
+
+        else if (_arg == "--dump")
+            OutOptions.dumpPath = argv[++i];
+
+        else if (_arg == "--base")
+            OutOptions.dumpBase = argv[++i];
+
+        else if (_arg == "--frames")
+            OutOptions.frameCount = strtoull(argv[++i], nullptr, 10);
+
+        else if (_arg == "--save-dump")
+            OutOptions.savePath = argv[++i];
+
+        else if (_arg == "--sample")
+            OutOptions.sampleName = argv[++i];
+
+        else if (_arg == "--sample-out")
+            OutOptions.samplePath = argv[++i];
+
+        else if (_arg == "--timeline")
+            OutOptions.timelinePath = argv[++i];
+
+        else if (_arg == "--timeline-size")
+            TimelineTrace::Capacity = strtoull(argv[++i], nullptr, 10);
+
+        else if (_arg == "--hz")
+            OutOptions.tickRate = strtof(argv[++i], nullptr);
+
+        else if (_arg == "--duration")
+            OutOptions.runDuration = strtod(argv[++i], nullptr);
+
+        else if (_arg == "--timeout")
+            OutOptions.latchTimeout = strtod(argv[++i], nullptr);
+
+        else if (_arg == "--only")
+        {
+            string _list = argv[++i];
+            size_t _start = 0;
+
+            while (_start <= _list.size())
+            {
+                auto _end = _list.find(',', _start);
+                _end = _end == string::npos ? _list.size() : _end;
+
+                if (_end > _start)
+                    OutOptions.scriptList.push_back(_list.substr(_start, _end - _start));
+
+                _start = _end + 1;
+            }
+        }
+
+        else
+        {
+            fprintf(stderr, "ERROR: \"%s\" is not an option.\n\n", argv[i]);
+            return false;
+        }
+    }
+
+    auto _offline = !OutOptions.replayPath.empty() || !OutOptions.dumpPath.empty() || OutOptions.soakCount != 0;
+    return !OutOptions.gameName.empty() || (_offline && !OutOptions.scriptPath.empty());
+}
+
+static vector<IdleWatch::Region> ParseIdleRegions(const vector<string>& InputList)
+{
+    vector<IdleWatch::Region> _return;
+
+    for (auto& _entry : InputList)
+    {
+        auto _split = _entry.find(':');
+
+        if (_split == string::npos)
+            continue;
+
+        _return.push_back({ strtoull(_entry.substr(0, _split).c_str(), nullptr, 16), strtoull(_entry.substr(_split + 1).c_str(), nullptr, 16) });
+    }
+
+    return _return;
+}
+
+static bool ProcessAlive()
+{
+    #if defined(_WIN32) || defined(_WIN64)
+        DWORD _retCode = 0;
+        GetExitCodeProcess(MemoryLib::PHandle, &_retCode);
+
+        return _retCode == STILL_ACTIVE;
+    #else
+        return kill(MemoryLib::PIdentifier, 0) == 0;
+    #endif
+}
+
+// Finds the game in the configuration, by title or by index.
+
+static bool FindGame(const CliOptions& InputOptions, toml::value& OutTable)
+{
+    try
+    {
+        auto _gameToml = toml::parse(InputOptions.configPath);
+
+        for (size_t i = 0; i < _gameToml.size(); i++)
+        {
+            char _tblStr[16];
+            snprintf(_tblStr, sizeof(_tblStr), "GameEntry%02zu", i);
+
+            OutTable = toml::find(_gameToml, _tblStr);
+
+            if (toml::find<string>(OutTable, "Title") == InputOptions.gameName || to_string(i) == InputOptions.gameName)
+                return true;
+        }
+
+        fprintf(stderr, "ERROR: There is no game called \"%s\" in \"%s\".\n", InputOptions.gameName.c_str(), InputOptions.configPath.c_str());
+    }
+
+    catch (std::exception& _ex)
+    {
+        fprintf(stderr, "ERROR: The file \"%s\" cannot be read: %s\n", InputOptions.configPath.c_str(), _ex.what());
+    }
+
+    return false;
+}
+
+// Loads the scripts, keeping only the ones asked for.
+
+static unique_ptr<LuaBackend> LoadBackend(const CliOptions& InputOptions, const string& InputPath, uint64_t InputAddress, MessageSink* InputSink)
+{
+    if (!InputOptions.idleBool)
+        LuaBackend::IdleMaxFactor = 1;
+
+    auto _backend = make_unique<LuaBackend>(InputPath.c_str(), InputAddress, InputSink);
+
+    if (!InputOptions.scriptList.empty())
+    {
+        vector<LuaBackend::LuaScript*> _scriptList;
+
+        for (auto _script : _backend->loadedScripts)
+        {
+            auto _name = fs::path(_script->scriptPath).filename().string();
+
+            if (find(InputOptions.scriptList.begin(), InputOptions.scriptList.end(), _name) != InputOptions.scriptList.end())
+                _scriptList.push_back(_script);
+        }
+
+        _backend->loadedScripts = _scriptList;
+    }
+
+    if (InputOptions.tickRate > 0)
+        _backend->frameLimit = 1000.0F / InputOptions.tickRate;
+
+    _backend->BuildGraph();
+
+    if (InputOptions.poolBool)
+        _backend->EnablePool(InputOptions.poolWorkers);
+
+    if (!InputOptions.sampleName.empty())
+    {
+        auto _sampled = false;
+
+        for (auto _script : _backend->loadedScripts)
+        {
+            if (fs::path(_script->scriptPath).filename().string() == InputOptions.sampleName)
+            {
+                _script->frameSampler.Enable(true);
+                _sampled = true;
+            }
+        }
+
+        if (!_sampled)
+            fprintf(stderr, "WARNING: \"%s\" is not loaded, and will not be sampled.\n", InputOptions.sampleName.c_str());
+    }
+
+    return _backend;
+}
+
+// Writes out what --timeline recorded.
+
+static void SaveTimeline(const CliOptions& InputOptions)
+{
+    if (InputOptions.timelinePath.empty())
+        return;
+
+    TimelineTrace::Enabled = false;
+
+    size_t _count = 0;
+
+    if (TimelineTrace::Write(InputOptions.timelinePath, &_count))
+        printf("Wrote %zu spans into \"%s\".\n", _count, InputOptions.timelinePath.c_str());
+
+    else
+        fprintf(stderr, "ERROR: The timeline cannot be written into \"%s\".\n", InputOptions.timelinePath.c_str());
+}
+
+// Writes out what --sample gathered, stopped scripts included.
+
+static void SaveSamples(const CliOptions& InputOptions, LuaBackend* InputBackend)
+{
+    if (InputOptions.sampleName.empty())
+        return;
+
+    auto _scriptList = InputBackend->loadedScripts;
+    _scriptList.insert(_scriptList.end(), InputBackend->stoppedScripts.begin(), InputBackend->stoppedScripts.end());
+
+    for (auto _script : _scriptList)
+    {
+        if (!_script->frameSampler.Enabled)
+            continue;
+
+        auto _path = InputOptions.samplePath.empty() ? _script->scriptName + ".folded" : InputOptions.samplePath;
+
+        _script->frameSampler.Enable(false);
+
+        if (_script->frameSampler.Write(_path, _script->scriptName))
+            printf("Wrote %llu samples of \"%s\", %.1fms of its time, into \"%s\".\n", (unsigned long long)_script->frameSampler.SampleCount(),
+                   _script->scriptName.c_str(), _script->frameSampler.TotalTime() / 1000.0, _path.c_str());
+
+        else
+            fprintf(stderr, "ERROR: The samples cannot be written into \"%s\".\n", _path.c_str());
+    }
+}
+
+// Runs the scripts against a trace, frame by frame, as fast as they go.
+// The scripts see the same frame times they did back then, so the same
+// scripts run on the same frames.
+
+static int ReplayTrace(const CliOptions& InputOptions, const string& InputPath)
+{
+    TraceReplay _replay(InputOptions.replayPath);
+
+    if (!_replay.IsValid())
+    {
+        fprintf(stderr, "ERROR: \"%s\" is not a trace, or cannot be read.\n", InputOptions.replayPath.c_str());
+        return EXIT_USAGE;
+    }
+
+    MemoryLib::BaseAddress = _replay.BaseAddress;
+    MemoryLib::BigEndian = _replay.BigEndian;
+    MemoryLib::Source = &_replay;
+
+    StdoutSink _sink;
+    auto _backend = LoadBackend(InputOptions, InputPath, _replay.BaseAddress, &_sink);
+
+    if (_backend->loadedScripts.empty())
+    {
+        fprintf(stderr, "ERROR: No scripts were loaded from \"%s\".\n", InputPath.c_str());
+        return EXIT_SCRIPTS;
+    }
+
+    printf("Replaying \"%s\" with %zu scripts.\n", InputOptions.replayPath.c_str(), _backend->loadedScripts.size());
+    fflush(stdout);
+
+    auto _runStart = chrono::steady_clock::now();
+
+    _backend->InitScripts();
+
+    uint64_t _frameCount = 0;
+    double _traceTime = 0;
+
+    while (!_quitFlag && !_replay.Finished() && !_backend->loadedScripts.empty())
+    {
+        _traceTime = _replay.NextTime();
+
+        auto _frameStart = LuaClock::now();
+        _backend->RunFrame(_traceTime);
+
+        // Same as the engine, whatever is left of three quarters of a tick.
+        // Nothing waits in between, but the collector has to get its time.
+
+        auto _frameSlack = chrono::duration<float, milli>(_backend->TickInterval() * 0.75F);
+        _backend->CollectGarbage(_frameStart + chrono::duration_cast<LuaClock::duration>(_frameSlack));
+
+        _frameCount++;
+    }
+
+    _replay.Finish();
+    MemoryLib::Source = nullptr;
+
+    SaveSamples(InputOptions, _backend.get());
+    SaveTimeline(InputOptions);
+
+    auto _runTime = chrono::duration<double>(chrono::steady_clock::now() - _runStart).count();
+
+    printf("Replayed %llu frames (%.1fs of game time) in %.3fs: %.0f frames/s, %.1fx real time.\n",
+           (unsigned long long)_frameCount, _traceTime / 1000, _runTime, _frameCount / _runTime, _traceTime / 1000 / _runTime);
+
+    if (_replay.MissCount != 0)
+        printf("%llu reads were of memory the trace knows nothing about, and came back as zero.\n", (unsigned long long)_replay.MissCount);
+
+    if (_replay.DivergenceCount == 0)
+    {
+        printf("Every write matched the trace.\n");
+        return _sink.ErrorCount != 0 ? EXIT_ERRORED : EXIT_DONE;
+    }
+
+    printf("%llu writes diverged from the trace:\n", (unsigned long long)_replay.DivergenceCount);
+
+    auto _hexText = [](const vector<uint8_t>& _data)
+    {
+        string _text;
+        char _byte[4];
+
+        for (auto _value : _data)
+        {
+            snprintf(_byte, sizeof(_byte), "%02X", _value);
+            _text += _byte;
+        }
+
+        return _data.empty() ? string("-") : _text;
+    };
+
+    for (auto& _diverge : _replay.DivergenceList)
+        printf("    Frame %lld, %-7s at 0x%llX: expected %s, wrote %s\n", (long long)_diverge.frameIndex, TraceReplay::DivergenceName(_diverge.divergeType),
+               (unsigned long long)(_diverge.address - _replay.BaseAddress), _hexText(_diverge.expectedData).c_str(), _hexText(_diverge.actualData).c_str());
+
+    return EXIT_DIVERGED;
+}
+
+// Dumps the game into a file, telling how far along it is every second.
+
+static int SaveDump(const CliOptions& InputOptions)
+{
+    DumpFilter _filter;
+    _filter.writableOnly = InputOptions.writableBool;
+
+    uint64_t _totalSize = 0;
+
+    for (auto& _region : ProcessDump::ListRegions(_filter))
+        _totalSize += _region.size;
+
+    atomic<uint64_t> _progress = 0;
+    atomic<bool> _cancel = false;
+    atomic<bool> _finished = false;
+
+    ProcessDump::Result _result;
+
+    std::thread _dumpThread([&]
+    {
+        _result = ProcessDump::DumpProcess(InputOptions.savePath, _filter, &_progress, &_cancel);
+        _finished = true;
+    });
+
+    for (int i = 1; !_finished; i++)
+    {
+        this_thread::sleep_for(chrono::milliseconds(100));
+
+        if (_quitFlag)
+            _cancel = true;
+
+        if (i % 10 == 0 && !_finished)
+        {
+            printf("Dumping: %.0f%% of %.1fMB.\n", _totalSize != 0 ? _progress * 100.0 / _totalSize : 100.0, _totalSize / 1048576.0);
+            fflush(stdout);
+        }
+    }
+
+    _dumpThread.join();
+
+    if (!_result.success)
+    {
+        fprintf(stderr, "ERROR: %s\n", _result.errorText.c_str());
+        return EXIT_DUMP;
+    }
+
+    printf("Dumped %zu regions, %.1fMB into %.1fMB, in %.2fs: %.2fGB/s.\n", _result.regionCount, _result.rawBytes / 1048576.0,
+           _result.fileBytes / 1048576.0, _result.runTime, _result.Throughput());
+
+    printf("The dumper's buffers peaked at %.1fMB, the whole process at %.1fMB.\n", _result.peakBytes / 1048576.0, _result.processPeak / 1048576.0);
+
+    if (_result.missingCount != 0)
+        printf("%zu chunks could not be read, and are left out.\n", _result.missingCount);
+
+    return EXIT_DONE;
+}
+
+// Opens the dump at "--dump" and points the memory functions at it. Our own
+// dumps keep every region where it was, anything else is mapped.
+
+static int OpenDump(const CliOptions& InputOptions, uint64_t InputAddress, unique_ptr<MemoryDump>& OutImage, unique_ptr<DumpArchive>& OutArchive)
+{
+    uint64_t _dumpSize = 0;
+
+    if (DumpArchive::IsArchive(InputOptions.dumpPath))
+    {
+        OutArchive = make_unique<DumpArchive>(InputOptions.dumpPath);
+
+        if (!OutArchive->IsValid())
+        {
+            fprintf(stderr, "ERROR: \"%s\" is broken, or was cut short.\n", InputOptions.dumpPath.c_str());
+            return EXIT_DUMP;
+        }
+
+        for (auto& _region : OutArchive->RegionList())
+            _dumpSize += _region.size;
+
+        printf("Opened \"%s\" (LuaFrontend Dump): %zu regions, %.1fMB.\n", InputOptions.dumpPath.c_str(), OutArchive->RegionList().size(), _dumpSize / 1048576.0);
+        MemoryLib::Source = OutArchive.get();
+    }
+
+    else
+    {
+        OutImage = make_unique<MemoryDump>(InputOptions.dumpPath, InputAddress);
+
+        if (!OutImage->IsValid())
+        {
+            fprintf(stderr, "ERROR: \"%s\" cannot be opened, or is a kind of ELF file other than a core file.\n", InputOptions.dumpPath.c_str());
+            return EXIT_DUMP;
+        }
+
+        for (auto& _segment : OutImage->SegmentList())
+            _dumpSize += _segment.fileSize;
+
+        printf("Opened \"%s\" (%s): %zu segments, %.1fMB.\n", InputOptions.dumpPath.c_str(), MemoryDump::TypeName(OutImage->Type),
+               OutImage->SegmentList().size(), _dumpSize / 1048576.0);
+
+        MemoryLib::Source = OutImage.get();
+    }
+
+    return EXIT_DONE;
+}
+
+// Runs the scripts against a dump for a set number of frames, as fast as
+// they go. Nothing moves in a dump, so every run gives the same result.
+
+static int RunDump(const CliOptions& InputOptions, const string& InputPath, uint64_t InputAddress)
+{
+    unique_ptr<MemoryDump> _image;
+    unique_ptr<DumpArchive> _archive;
+
+    if (OpenDump(InputOptions, InputAddress, _image, _archive) != EXIT_DONE)
+        return EXIT_DUMP;
+
+    MemoryLib::BaseAddress = InputAddress;
+
+    StdoutSink _sink;
+    auto _backend = LoadBackend(InputOptions, InputPath, InputAddress, &_sink);
+
+    if (_backend->loadedScripts.empty())
+    {
+        fprintf(stderr, "ERROR: No scripts were loaded from \"%s\".\n", InputPath.c_str());
+        return EXIT_SCRIPTS;
+    }
+
+    auto _runStart = chrono::steady_clock::now();
+
+    _backend->InitScripts();
+
+    uint64_t _frameCount = 0;
+
+    while (!_quitFlag && _frameCount < InputOptions.frameCount && !_backend->loadedScripts.empty())
+    {
+        auto _frameStart = LuaClock::now();
+        _backend->RunFrame(_frameCount * _backend->TickInterval());
+
+        auto _frameSlack = chrono::duration<float, milli>(_backend->TickInterval() * 0.75F);
+        _backend->CollectGarbage(_frameStart + chrono::duration_cast<LuaClock::duration>(_frameSlack));
+
+        _frameCount++;
+    }
+
+    MemoryLib::Source = nullptr;
+
+    SaveSamples(InputOptions, _backend.get());
+    SaveTimeline(InputOptions);
+
+    auto _runTime = chrono::duration<double>(chrono::steady_clock::now() - _runStart).count();
+
+    printf("Ran %llu frames in %.3fs: %.0f frames/s.\n", (unsigned long long)_frameCount, _runTime, _frameCount / _runTime);
+
+    auto _missCount = _archive != nullptr ? _archive->MissCount.load() : _image->MissCount.load();
+
+    if (_missCount != 0)
+        printf("%llu reads and writes were of memory the dump does not have. The reads came back as zero.\n", (unsigned long long)_missCount);
+
+    return _sink.ErrorCount != 0 ? EXIT_ERRORED : EXIT_DONE;
+}
+
+// Whether every script which was started again by a reload ran a frame
+// since, waiting for them up to InputTimeout. Scripts which were started
+// before the reload tell how many to expect.
+
+static bool ReloadRan(LuaEngine& InputEngine, chrono::duration<float, milli> InputTimeout)
+{
+    vector<LuaBackend::LuaScript*> _startList;
+    vector<LuaBackend::LuaScript*> _reloadList;
+
+    bool _reloaded = false;
+    size_t _stopCount = 0;
+
+    auto _waitEnd = chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(InputTimeout);
+
+    while (true)
+    {
+        LuaEngine::Event _event;
+
+        while (InputEngine.Poll(_event))
+        {
+            // Like the GUI, let the engine know we are done with the old scripts.
+            // Only the count of those which were started before is used.
+
+            if (_event.eventType == LuaEngine::EVT_RELOADED)
+            {
+                _reloaded = true;
+                InputEngine.Post({ LuaEngine::CMD_RELEASE });
+            }
+
+            else if (_event.eventType == LuaEngine::EVT_SCRIPT_STARTED && _event.eventScript->frameFunction)
+                (_reloaded ? _reloadList : _startList).push_back(_event.eventScript);
+
+            // A script which errored out on its first frame did run it.
+
+            else if (_event.eventType == LuaEngine::EVT_SCRIPT_STOPPED && _reloaded)
+            {
+                auto _size = _reloadList.size();
+                _reloadList.erase(remove(_reloadList.begin(), _reloadList.end(), _event.eventScript), _reloadList.end());
+
+                _stopCount += _size - _reloadList.size();
+            }
+        }
+
+        // The frame profiler counts the frames, without it there is nothing to go by.
+
+        if (!LuaBackend::ProfileFrames)
+            return true;
+
+        auto _ranCount = count_if(_reloadList.begin(), _reloadList.end(), [](LuaBackend::LuaScript* _script) { return _script->frameProfile.FrameCount != 0; });
+
+        if (_reloaded && _reloadList.size() + _stopCount >= _startList.size() && (size_t)_ranCount == _reloadList.size())
+            return true;
+
+        if (chrono::steady_clock::now() >= _waitEnd)
+            return false;
+
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+}
+
+// Multi-Threading in the GUI runs every script on a LuaThread of its own.
+// Those need Qt, which we do without, so these threads do what they do:
+// resume the frame at the script's own rate, collect garbage in the slack,
+// and stop on any error which is not an overrun. They run for InputTime,
+// and every script with a frame function must have ran or stopped by then.
+
+static bool ThreadsRan(LuaBackend& InputBackend, MessageSink* InputSink, chrono::duration<float, milli> InputTime)
+{
+    InputBackend.InitScripts();
+
+    auto& _scriptList = InputBackend.loadedScripts;
+
+    atomic<bool> _stopFlag = false;
+    vector<char> _ranList(_scriptList.size(), 0);
+    vector<std::thread> _threadList;
+
+    for (size_t i = 0; i < _scriptList.size(); i++)
+    {
+        _threadList.emplace_back([&, i]
+        {
+            auto _script = _scriptList[i];
+            auto _frameNext = LuaClock::now();
+
+            while (!_stopFlag)
+            {
+                auto _frameStart = LuaClock::now();
+                auto _interval = _script->frameLimit > 0 ? _script->frameLimit : InputBackend.frameLimit;
+
+                _script->frameCount++;
+
+                if (_script->frameFunction && !LuaBackend::IsWaiting(_script))
+                {
+                    string _error;
+                    _ranList[i] = 1;
+
+                    if (!LuaBackend::ResumeFrame(_script, _error))
+                    {
+                        LuaBackend::PrintError(InputSink, _script, _error);
+
+                        if (!_script->frameOverrun || !LuaBackend::HandleOverrun(InputSink, _script, _interval))
+                            return;
+                    }
+                }
+
+                _interval = _script->frameLimit > 0 ? _script->frameLimit : InputBackend.frameLimit;
+
+                auto _frameSlack = chrono::duration<float, milli>(_interval * 0.75F);
+                LuaBackend::CollectGarbage(_script->luaVM.get(), _frameStart + chrono::duration_cast<LuaClock::duration>(_frameSlack));
+
+                _frameNext += chrono::duration_cast<LuaClock::duration>(chrono::duration<float, milli>(_interval));
+                this_thread::sleep_until(_frameNext);
+            }
+        });
+    }
+
+    this_thread::sleep_for(InputTime);
+
+    // The scripts must be done running before the backend goes away.
+
+    _stopFlag = true;
+
+    for (auto& _thread : _threadList)
+        _thread.join();
+
+    for (size_t i = 0; i < _scriptList.size(); i++)
+        if (_scriptList[i]->frameFunction && _ranList[i] == 0)
+            return false;
+
+    return true;
+}
+
+// Starts, reloads and stops the scripts over and over, like a frontend left
+// running for days with auto-reload does. Every cycle loads the backend from
+// scratch, ticks it on the engine thread, reloads it, ticks it again, and
+// tears everything down. Every script must run again right after the reload.
+// Then it does the same the way Multi-Threading does, where a reload loads
+// everything from scratch and every script has a thread of its own.
+// The first tenth of the cycles warm things up, past that, neither the memory
+// nor the threads we have may keep growing.
+
+static int RunSoak(const CliOptions& InputOptions, const string& InputPath, uint64_t InputAddress)
+{
+    unique_ptr<MemoryDump> _image;
+    unique_ptr<DumpArchive> _archive;
+
+    if (!InputOptions.dumpPath.empty() && OpenDump(InputOptions, InputAddress, _image, _archive) != EXIT_DONE)
+        return EXIT_DUMP;
+
+    MemoryLib::BaseAddress = InputAddress;
+
+    // A thousand cycles of every script saying hello is a bit much.
+
+    StdoutSink _sink;
+    _sink.MinimumType = 2;
+
+    auto _warmCount = max<uint64_t>(InputOptions.soakCount / 10, 1);
+    auto _halfCount = _warmCount + (InputOptions.soakCount - _warmCount) / 2;
+
+    uint64_t _warmBytes = 0, _firstBytes = 0, _lastBytes = 0;
+    size_t _warmThreads = 0, _lastThreads = 0;
+
+    auto _startThreads = ProcessStats::ThreadCount();
+    auto _runStart = chrono::steady_clock::now();
+
+    uint64_t _cycleCount = 0;
+
+    printf("Soaking \"%s\" for %llu cycles.\n", InputPath.c_str(), (unsigned long long)InputOptions.soakCount);
+    fflush(stdout);
+
+    while (!_quitFlag && _cycleCount < InputOptions.soakCount)
+    {
+        {
+            auto _backend = LoadBackend(InputOptions, InputPath, InputAddress, &_sink);
+
+            if (_backend->loadedScripts.empty())
+            {
+                fprintf(stderr, "ERROR: No scripts were loaded from \"%s\".\n", InputPath.c_str());
+                MemoryLib::Source = nullptr;
+
+                return EXIT_SCRIPTS;
+            }
+
+            // A couple of ticks after starting, and after reloading.
+
+            auto _tickTime = chrono::duration<float, milli>(_backend->TickInterval() * 2);
+            LuaEngine _engine(_backend.get());
+
+            _engine.Post({ LuaEngine::CMD_START });
+            this_thread::sleep_for(_tickTime);
+
+            _engine.Post({ LuaEngine::CMD_RELOAD });
+            this_thread::sleep_for(_tickTime);
+
+            if (!ReloadRan(_engine, max(_tickTime * 10, chrono::duration<float, milli>(1000))))
+            {
+                fprintf(stderr, "ERROR: Cycle %llu: the scripts did not run after reloading.\n", (unsigned long long)_cycleCount);
+                MemoryLib::Source = nullptr;
+
+                return EXIT_SOAK;
+            }
+        }
+
+        for (int i = 0; i < 2; i++)
+        {
+            auto _backend = LoadBackend(InputOptions, InputPath, InputAddress, &_sink);
+            auto _tickTime = chrono::duration<float, milli>(_backend->TickInterval() * 2);
+
+            if (!ThreadsRan(*_backend, &_sink, _tickTime))
+            {
+                fprintf(stderr, "ERROR: Cycle %llu: the scripts did not run on their own threads%s.\n", (unsigned long long)_cycleCount, i > 0 ? " after reloading" : "");
+                MemoryLib::Source = nullptr;
+
+                return EXIT_SOAK;
+            }
+        }
+
+        // Everything of this cycle is gone now. Whatever is left is what we keep.
+
+        auto _residentBytes = ProcessStats::ResidentBytes();
+        auto _threadCount = ProcessStats::ThreadCount();
+
+        if (_cycleCount < _warmCount)
+        {
+            _warmBytes = max(_warmBytes, _residentBytes);
+            _warmThreads = max(_warmThreads, _threadCount);
+        }
+
+        else
+        {
+            auto& _halfBytes = _cycleCount < _halfCount ? _firstBytes : _lastBytes;
+
+            _halfBytes = max(_halfBytes, _residentBytes);
+            _lastThreads = max(_lastThreads, _threadCount);
+        }
+
+        _cycleCount++;
+
+        if (_cycleCount % 100 == 0)
+        {
+            printf("Cycle %llu: %.1fMB resident, %zu threads.\n", (unsigned long long)_cycleCount, _residentBytes / 1048576.0, _threadCount);
+            fflush(stdout);
+        }
+    }
+
+    MemoryLib::Source = nullptr;
+
+    auto _runTime = chrono::duration<double>(chrono::steady_clock::now() - _runStart).count();
+
+    printf("Soaked %llu cycles in %.1fs. At most %.1fMB resident while warming up, %.1fMB in the first half after, %.1fMB in the second.\n",
+           (unsigned long long)_cycleCount, _runTime, _warmBytes / 1048576.0, _firstBytes / 1048576.0, _lastBytes / 1048576.0);
+
+    printf("%zu threads at the start, at most %zu after a cycle while warming up, %zu after.\n", _startThreads, _warmThreads, _lastThreads);
+
+    // Some slack for the heap settling, but a leak of even a small
+    // script per cycle adds up to more than this over the run.
+
+    auto _slackBytes = max<uint64_t>(_firstBytes / 20, 4 * 1048576);
+    bool _leaked = false;
+
+    if (_lastBytes > _firstBytes + _slackBytes && _firstBytes != 0)
+    {
+        fprintf(stderr, "ERROR: Memory grew by %.1fMB between the halves of the run.\n", (_lastBytes - _firstBytes) / 1048576.0);
+        _leaked = true;
+    }
+
+    if (_lastThreads > _warmThreads)
+    {
+        fprintf(stderr, "ERROR: %zu threads were left behind after warming up.\n", _lastThreads - _warmThreads);
+        _leaked = true;
+    }
+
+    if (_leaked)
+        return EXIT_SOAK;
+
+    return _sink.ErrorCount != 0 ? EXIT_ERRORED : EXIT_DONE;
+}
+
+int main(int argc, char* argv[])
+{
+    CliOptions _options;
+
+    if (!ParseOptions(argc, argv, _options))
+    {
+        PrintUsage();
+        return EXIT_USAGE;
+    }
+
+    signal(SIGINT, [](int) { _quitFlag = true; });
+
+    TimelineTrace::NameThread("Main");
+    TimelineTrace::Enabled = !_options.timelinePath.empty();
+
+    toml::value _table;
+
+    if (!_options.gameName.empty() && !FindGame(_options, _table))
+        return EXIT_USAGE;
+
+    // A path starting with a slash is relative to us.
+
+    auto _scriptPath = _options.scriptPath;
+
+    if (_scriptPath.empty())
+    {
+        _scriptPath = toml::find<string>(_table, "Path");
+
+        if (_scriptPath[0] == '/' || _scriptPath[0] == '\\')
+            _scriptPath = fs::absolute(argv[0]).parent_path().string() + _scriptPath;
+    }
+
+    if (!_options.replayPath.empty())
+        return ReplayTrace(_options, _scriptPath);
+
+    // A dump sits at the given base, or where the game's entry says the game does.
+
+    if (!_options.dumpPath.empty() || _options.soakCount != 0)
+    {
+        uint64_t _dumpBase = 0;
+
+        if (!_options.dumpBase.empty())
+            _dumpBase = strtoull(_options.dumpBase.c_str(), nullptr, 16);
+
+        else if (!_options.gameName.empty())
+            _dumpBase = strtoull(toml::find<string>(_table, "Address").c_str(), nullptr, 16) + strtoull(toml::find<string>(_table, "Offset").c_str(), nullptr, 16);
+
+        if (_options.soakCount != 0)
+            return RunSoak(_options, _scriptPath, _dumpBase);
+
+        return RunDump(_options, _scriptPath, _dumpBase);
+    }
+
+    auto _exeName = toml::find<string>(_table, "Executable");
+    auto _gameAddress = strtoull(toml::find<string>(_table, "Address").c_str(), nullptr, 16);
+    auto _gameOffset = strtoull(toml::find<string>(_table, "Offset").c_str(), nullptr, 16);
+    auto _bigEndian = toml::find<bool>(_table, "BigEndian");
+
+    // Latch into the game, waiting for it to start if need be.
+
+    bool _latched = false;
+
+    #if defined(_WIN32) || defined(_WIN64)
+        if (_options.processID != 0)
+        {
+            auto _handle = OpenProcess(PROCESS_ALL_ACCESS, false, (DWORD)_options.processID);
+
+            if (_handle != NULL)
+            {
+                MemoryLib::ExternProcess((DWORD)_options.processID, _handle, _gameAddress);
+                MemoryLib::BigEndian = _bigEndian;
+
+                _latched = true;
+            }
+        }
+
+        else
+        {
+            auto _latchStart = chrono::steady_clock::now();
+
+            while (!_quitFlag && !(_latched = MemoryLib::LatchProcess(_exeName, _gameAddress, _bigEndian)))
+            {
+                if (chrono::steady_clock::now() - _latchStart > chrono::duration<double>(_options.latchTimeout))
+                    break;
+
+                this_thread::sleep_for(chrono::milliseconds(100));
+            }
+        }
+    #else
+        if (_options.processID != 0 && kill((pid_t)_options.processID, 0) == 0)
+        {
+            MemoryLib::PIdentifier = (pid_t)_options.processID;
+            MemoryLib::BigEndian = _bigEndian;
+
+            _latched = true;
+        }
+    #endif
+
+    if (!_latched)
+    {
+        fprintf(stderr, "ERROR: Could not latch into \"%s\".\n", _options.processID != 0 ? to_string(_options.processID).c_str() : _exeName.c_str());
+        return EXIT_LATCH;
+    }
+
+    // Same as the GUI: either the executable's base address, or the given
+    // one, with the offset added to it.
+
+    auto _baseAddress = _gameAddress;
+
+    #if defined(_WIN32) || defined(_WIN64)
+        if (_baseAddress == 0)
+            _baseAddress = (uint64_t)MemoryLib::FindBaseAddr(MemoryLib::PHandle, _exeName);
+    #endif
+
+    _baseAddress += _gameOffset;
+    MemoryLib::SetBaseAddr(_baseAddress);
+
+    if (!_options.savePath.empty())
+        return SaveDump(_options);
+
+    StdoutSink _sink;
+    auto _backend = LoadBackend(_options, _scriptPath, _baseAddress, &_sink);
+
+    if (_backend->loadedScripts.empty())
+    {
+        fprintf(stderr, "ERROR: No scripts were loaded from \"%s\".\n", _scriptPath.c_str());
+        return EXIT_SCRIPTS;
+    }
+
+    // Optional things from the game's entry, same as the GUI.
+
+    auto _frameCounter = strtoull(toml::find_or<string>(_table, "FrameCounter", "0").c_str(), nullptr, 16);
+
+    if (_frameCounter != 0)
+    {
+        _backend->frameSync.CounterAddress = _frameCounter;
+        _backend->frameSync.CounterSize = toml::find_or<int>(_table, "FrameCounterSize", 4);
+    }
+
+    _backend->idleWatch.RegionList = ParseIdleRegions(toml::find_or<vector<string>>(_table, "IdleWatch", vector<string>()));
+
+    // Recording? Everything from _OnInit on goes into the trace.
+
+    unique_ptr<TraceRecorder> _recorder;
+
+    if (!_options.recordPath.empty())
+    {
+        _recorder = make_unique<TraceRecorder>(_options.recordPath);
+
+        if (!_recorder->IsOpen())
+        {
+            fprintf(stderr, "ERROR: The trace \"%s\" cannot be written.\n", _options.recordPath.c_str());
+            return EXIT_USAGE;
+        }
+
+        MemoryLib::Source = _recorder.get();
+    }
+
+    printf("Running %zu scripts for \"%s\".\n", _backend->loadedScripts.size(), _options.gameName.c_str());
+    fflush(stdout);
+
+    // Everything runs on the engine thread. All we do is watch it.
+
+    auto _engine = make_unique<LuaEngine>(_backend.get());
+    _engine->Post({ LuaEngine::CMD_START });
+
+    auto _runStart = chrono::steady_clock::now();
+    size_t _runCount = 0;
+    bool _started = false;
+    int _stoppedCount = 0;
+
+    while (!_quitFlag)
+    {
+        LuaEngine::Event _event;
+
+        while (_engine->Poll(_event))
+        {
+            if (_event.eventType == LuaEngine::EVT_SCRIPT_STARTED)
+            {
+                _runCount++;
+                _started = true;
+            }
+
+            else if (_event.eventType == LuaEngine::EVT_SCRIPT_STOPPED)
+            {
+                _runCount--;
+                _stoppedCount++;
+            }
+        }
+
+        if (_started && _runCount == 0)
+        {
+            fprintf(stderr, "ERROR: Every script has stopped.\n");
+            break;
+        }
+
+        if (_options.runDuration > 0 && chrono::steady_clock::now() - _runStart >= chrono::duration<double>(_options.runDuration))
+            break;
+
+        if (!ProcessAlive())
+        {
+            printf("The game has exited.\n");
+            break;
+        }
+
+        this_thread::sleep_for(chrono::milliseconds(50));
+    }
+
+    // The engine thread must be done before we look at the backend.
+
+    _engine.reset();
+
+    _sink.writeMessage(_backend->framePacer.Summary(), 0);
+    _sink.writeMessage(LuaBackend::ProfileSummary(_backend->loadedScripts, 5), 0);
+
+    SaveSamples(_options, _backend.get());
+    SaveTimeline(_options);
+
+    if (_recorder != nullptr)
+    {
+        MemoryLib::Source = nullptr;
+
+        printf("Recorded %llu frames, %llu reads (%llu unchanged) and %llu writes into %.1fKB.\n",
+               (unsigned long long)_recorder->FrameCount, (unsigned long long)_recorder->ReadCount, (unsigned long long)_recorder->SameCount,
+               (unsigned long long)_recorder->WriteCount, (_recorder->FileBytes + 0.0) / 1024);
+
+        _recorder.reset();
+    }
+
+    if (_stoppedCount != 0 || _sink.ErrorCount != 0)
+        return EXIT_ERRORED;
+
+    return EXIT_DONE;
+}
@@ -0,0 +1,33 @@
+TEMPLATE = app
+
+QT -= core gui
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+TARGET = luafrontend-cli
+
+LIBS += -L$$PWD/../libraries/ -lluaengine -llua -ldiscord-rpc
+
+# The Windows timer resolution comes from winmm, Linux needs threads and dlopen.
+
+win32: LIBS += -lwinmm
+unix: LIBS += -lpthread -ldl
+
+win32: PRE_TARGETDEPS += $$PWD/../libraries/luaengine.lib $$PWD/../libraries/discord-rpc.lib
+unix: PRE_TARGETDEPS += $$PWD/../libraries/libluaengine.a $$PWD/../libraries/libdiscord-rpc.a
+
+SOURCES += \
+    FrontendCLI.cpp
+
+INCLUDEPATH += \
+    $$PWD/../ \
+    $$PWD/../include/ \
+    $$PWD/../include/lua \
+    $$PWD/../include/sol2 \
+    $$PWD/../include/crcpp \
+    $$PWD/../include/toml11 \
+    $$PWD/../include/discord
+
+DEPENDPATH += \
+    $$PWD/../include/lua \
+    $$PWD/../include/discord
@@ -0,0 +1,50 @@
+TEMPLATE = lib
+
+QT -= core gui
+CONFIG += staticlib c++17
+
+# Everything that runs scripts, and nothing that shows them: memory access,
+# script loading, the bindings and the frame scheduler. The GUI, the command
+# line runner and the benchmarks all link to this.
+
+TARGET = luaengine
+DESTDIR = $$PWD/../libraries
+
+SOURCES += \
+    ../LuaBackend.cpp \
+    ../LuaEngine.cpp
+
+HEADERS += \
+    ../LuaBackend.hpp \
+    ../LuaEngine.hpp \
+    ../include/MessageSink.hpp \
+    ../include/MemoryLib.hpp \
+    ../include/MemorySource.hpp \
+    ../include/MemoryDump.hpp \
+    ../include/ProcessDump.hpp \
+    ../include/ProcessStats.hpp \
+    ../include/ScriptProfile.hpp \
+    ../include/ScriptSampler.hpp \
+    ../include/TimelineTrace.hpp \
+    ../include/MemoryStats.hpp \
+    ../include/MemoryTrace.hpp \
+    ../include/LuaMemoryLib.hpp \
+    ../include/FramePacer.hpp \
+    ../include/FrameSync.hpp \
+    ../include/IdleWatch.hpp \
+    ../include/TimingWheel.hpp \
+    ../include/WorkerPool.hpp \
+    ../include/RingQueue.hpp
+
+INCLUDEPATH += \
+    $$PWD/../ \
+    $$PWD/../include/ \
+    $$PWD/../include/lua \
+    $$PWD/../include/sol2 \
+    $$PWD/../include/crcpp \
+    $$PWD/../include/toml11 \
+    $$PWD/../include/discord
+
+DEPENDPATH += \
+    $$PWD/../include/lua \
+    $$PWD/../include/discord
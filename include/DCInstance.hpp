@@ -1,7 +1,12 @@
 #pragma once
 
 #include <chrono>
-#include <Windows.h>
+#include <cstring>
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <Windows.h>
+#endif
+
 #include <discord_rpc.h> 
 #include <discord_register.h>
 
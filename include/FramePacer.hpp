@@ -0,0 +1,248 @@
+#ifndef FRAMEPACER
+#define FRAMEPACER
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <cstdint>
+#include <cstdio>
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <windows.h>
+    #include <mmsystem.h>
+#endif
+
+using namespace std;
+
+// Paces a loop to a rate given in milliseconds, fractions included.
+// Deadlines are absolute, so they never drift, and the wait before each one
+// is a sleep up to just short of it, followed by a spin for the rest. How
+// short depends on how late the OS has been waking us up so far.
+//
+// How late every frame really started is kept in a histogram, which any
+// thread may read at any time.
+
+class FramePacer
+{
+    public:
+        enum PacePolicy { PACE_SKIP, PACE_CATCHUP };
+
+        // The upper edge of every bucket, in microseconds. The last is everything else.
+
+        static constexpr size_t BucketCount = 11;
+        static constexpr uint32_t BucketEdges[BucketCount - 1] = { 25, 50, 100, 250, 500, 1000, 2000, 4000, 8000, 16000 };
+
+        // What to do when a frame overran, and the next deadline is gone already.
+        // SKIP drops the missed frames and keeps to the grid. CATCHUP runs them
+        // back to back, but only up to "catchUpLimit" of them, and skips the rest.
+
+        PacePolicy pacePolicy = PACE_SKIP;
+        uint32_t catchUpLimit = 3;
+
+        atomic<uint64_t> FrameCount = 0;
+        atomic<uint64_t> LateCount = 0;
+        atomic<uint64_t> SkipCount = 0;
+        atomic<uint64_t> CatchUpCount = 0;
+
+        atomic<uint64_t> BucketList[BucketCount] = { };
+        atomic<float> JitterMax = 0;
+        atomic<double> JitterTotal = 0;
+
+        FramePacer()
+        {
+            // Windows sleeps in 15.6ms steps, unless told otherwise.
+
+            #if defined(_WIN32) || defined(_WIN64)
+                timeBeginPeriod(1);
+            #endif
+        }
+
+        ~FramePacer()
+        {
+            #if defined(_WIN32) || defined(_WIN64)
+                timeEndPeriod(1);
+            #endif
+        }
+
+        FramePacer(const FramePacer&) = delete;
+        FramePacer& operator=(const FramePacer&) = delete;
+
+        // Starts pacing from now on, with clean statistics.
+
+        void Reset()
+        {
+            _deadline = chrono::steady_clock::now();
+            _startTime.store(_deadline);
+
+            FrameCount = 0;
+            LateCount = 0;
+            SkipCount = 0;
+            CatchUpCount = 0;
+
+            for (auto& _bucket : BucketList)
+                _bucket = 0;
+
+            JitterMax = 0;
+            JitterTotal = 0;
+        }
+
+        // Waits until the next frame is due, InputInterval milliseconds after the last.
+
+        void Wait(double InputInterval)
+        {
+            auto _interval = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double, milli>(InputInterval));
+            auto _timeNow = chrono::steady_clock::now();
+
+            _deadline += _interval;
+
+            // Overran by a whole frame or more?
+
+            if (_deadline + _interval <= _timeNow)
+            {
+                LateCount++;
+
+                auto _missed = (uint64_t)((_timeNow - _deadline) / _interval);
+
+                if (pacePolicy == PACE_CATCHUP && _missed <= catchUpLimit)
+                {
+                    // Run right away. The deadlines still tick along
+                    // the grid, so the missed frames run back to back.
+
+                    CatchUpCount++;
+                    Record(_timeNow);
+                    return;
+                }
+
+                // Drop the missed frames, but keep to the grid.
+
+                SkipCount += _missed;
+                _deadline += _interval * _missed;
+            }
+
+            if (_deadline > _timeNow)
+            {
+                auto _sleepUntil = _deadline - chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double, micro>(SpinWindow()));
+
+                if (_sleepUntil > _timeNow)
+                {
+                    this_thread::sleep_until(_sleepUntil);
+
+                    // Learn how late the OS wakes us up.
+
+                    auto _overshoot = chrono::duration<double, micro>(chrono::steady_clock::now() - _sleepUntil).count();
+                    _sleepError += (_overshoot - _sleepError) / 8;
+                }
+
+                while (chrono::steady_clock::now() < _deadline)
+                    this_thread::yield();
+            }
+
+            Record(chrono::steady_clock::now());
+        }
+
+        // The rate we really ran at since the last reset, in frames per second.
+
+        double Hertz() const
+        {
+            auto _elapsed = chrono::duration<double>(chrono::steady_clock::now() - _startTime.load()).count();
+            return _elapsed > 0 ? FrameCount / _elapsed : 0;
+        }
+
+        double JitterMean() const
+        {
+            auto _count = FrameCount.load();
+            return _count > 0 ? JitterTotal / _count : 0;
+        }
+
+        // The bucket edge below which InputRatio of the frames started.
+
+        uint32_t JitterPercentile(double InputRatio) const
+        {
+            uint64_t _total = 0;
+
+            for (auto& _bucket : BucketList)
+                _total += _bucket;
+
+            if (_total == 0)
+                return 0;
+
+            uint64_t _sum = 0;
+
+            for (size_t i = 0; i < BucketCount - 1; i++)
+            {
+                _sum += BucketList[i];
+
+                if (_sum >= _total * InputRatio)
+                    return BucketEdges[i];
+            }
+
+            return UINT32_MAX;
+        }
+
+        string Summary() const
+        {
+            auto _edgeText = [](uint32_t _edge) { return _edge == UINT32_MAX ? string("16000+") : to_string(_edge); };
+
+            char _line[256];
+            snprintf(_line, sizeof(_line), "%.2fHz over %llu frames, %llu late (%llu skipped, %llu caught up).<br>"
+                                           "Start jitter: %.0fus mean, %sus median, %sus 99%%, %.0fus max.<br>",
+                                           Hertz(), (unsigned long long)FrameCount, (unsigned long long)LateCount,
+                                           (unsigned long long)SkipCount, (unsigned long long)CatchUpCount, JitterMean(),
+                                           _edgeText(JitterPercentile(0.5)).c_str(), _edgeText(JitterPercentile(0.99)).c_str(), JitterMax.load());
+
+            string _return = _line;
+            uint32_t _lower = 0;
+
+            for (size_t i = 0; i < BucketCount; i++)
+            {
+                if (i < BucketCount - 1)
+                    snprintf(_line, sizeof(_line), "%6u - %6uus: %llu<br>", _lower, BucketEdges[i], (unsigned long long)BucketList[i]);
+
+                else
+                    snprintf(_line, sizeof(_line), "%6uus and up: %llu<br>", _lower, (unsigned long long)BucketList[i]);
+
+                _return += _line;
+                _lower = i < BucketCount - 1 ? BucketEdges[i] : _lower;
+            }
+
+            return _return;
+        }
+
+    private:
+        chrono::steady_clock::time_point _deadline;
+        atomic<chrono::steady_clock::time_point> _startTime;
+
+        double _sleepError = 500;
+
+        // Spin for twice what the OS usually oversleeps by, within reason.
+
+        double SpinWindow() const
+        {
+            auto _window = _sleepError * 2 + 100;
+            return _window < 4000 ? _window : 4000;
+        }
+
+        void Record(chrono::steady_clock::time_point InputStart)
+        {
+            auto _jitter = (float)chrono::duration<double, micro>(InputStart - _deadline).count();
+
+            if (_jitter < 0)
+                _jitter = 0;
+
+            size_t _bucket = 0;
+
+            while (_bucket < BucketCount - 1 && _jitter >= BucketEdges[_bucket])
+                _bucket++;
+
+            BucketList[_bucket].fetch_add(1, memory_order_relaxed);
+            FrameCount.fetch_add(1, memory_order_relaxed);
+
+            JitterTotal.store(JitterTotal.load(memory_order_relaxed) + _jitter, memory_order_relaxed);
+
+            if (_jitter > JitterMax.load(memory_order_relaxed))
+                JitterMax.store(_jitter, memory_order_relaxed);
+        }
+};
+
+#endif
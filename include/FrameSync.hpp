@@ -0,0 +1,155 @@
+#ifndef FRAMESYNC
+#define FRAMESYNC
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstdint>
+
+#include <MemoryLib.hpp>
+
+using namespace std;
+
+// Follows a frame counter in the game's memory, so that a tick can run
+// once for every frame the game draws, no matter how fast or slow it goes.
+//
+// Polling it nonstop would eat a core, so it sleeps through most of the time
+// it expects the next frame to take, going by how long the last few took,
+// and only polls closely around when it is due.
+
+class FrameSync
+{
+    public:
+        uint64_t CounterAddress = 0;
+        int CounterSize = 4;
+
+        // "GameFrames" is how far the counter went, "FiredFrames" how many times
+        // we caught it moving. If it moved by more than one, we missed frames.
+        // If it went backwards, the game reset it or showed a frame twice.
+
+        atomic<uint64_t> GameFrames = 0;
+        atomic<uint64_t> FiredFrames = 0;
+        atomic<uint64_t> MissedFrames = 0;
+        atomic<uint64_t> DuplicateFrames = 0;
+        atomic<uint64_t> StallCount = 0;
+
+        bool Enabled() const { return CounterAddress != 0; }
+
+        void Reset()
+        {
+            _lastValue = ReadCounter();
+            _lastChange = chrono::steady_clock::now();
+            _startTime.store(_lastChange);
+
+            GameFrames = 0;
+            FiredFrames = 0;
+            MissedFrames = 0;
+            DuplicateFrames = 0;
+            StallCount = 0;
+        }
+
+        // Waits for the counter to move. Gives up after InputTimeout
+        // milliseconds, so the caller gets to do other things while
+        // the game is paused or loading, and returns false.
+
+        bool WaitFrame(double InputTimeout = 50)
+        {
+            auto _timeNow = chrono::steady_clock::now();
+            auto _period = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double, milli>(_framePeriod));
+            auto _timeout = _timeNow + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double, milli>(InputTimeout));
+
+            // Sleep through the first three quarters of the frame.
+
+            auto _wakeTime = _lastChange + _period * 3 / 4;
+
+            if (_wakeTime > _timeNow)
+                this_thread::sleep_until(_wakeTime < _timeout ? _wakeTime : _timeout);
+
+            while (true)
+            {
+                auto _value = ReadCounter();
+
+                if (_value != _lastValue)
+                {
+                    Record(_value);
+                    return true;
+                }
+
+                _timeNow = chrono::steady_clock::now();
+
+                if (_timeNow >= _timeout)
+                {
+                    StallCount++;
+                    return false;
+                }
+
+                // Poll closely around when the frame is due, and back off
+                // the longer it is overdue.
+
+                if (_timeNow < _lastChange + _period * 3 / 2)
+                    this_thread::yield();
+
+                else
+                    this_thread::sleep_for(chrono::microseconds(250));
+            }
+        }
+
+        // How long a game frame takes these days, in milliseconds.
+
+        double FramePeriod() const { return _framePeriod; }
+
+        double Hertz() const
+        {
+            auto _elapsed = chrono::duration<double>(chrono::steady_clock::now() - _startTime.load()).count();
+            return _elapsed > 0 ? FiredFrames / _elapsed : 0;
+        }
+
+    private:
+        uint64_t _lastValue = 0;
+        chrono::steady_clock::time_point _lastChange;
+        atomic<chrono::steady_clock::time_point> _startTime;
+
+        double _framePeriod = 1000.0 / 60;
+
+        uint64_t ReadCounter()
+        {
+            switch (CounterSize)
+            {
+                case 1: return MemoryLib::ReadByte(CounterAddress);
+                case 2: return MemoryLib::ReadShort(CounterAddress);
+                case 8: return MemoryLib::ReadLong(CounterAddress);
+                default: return MemoryLib::ReadInt(CounterAddress);
+            }
+        }
+
+        void Record(uint64_t InputValue)
+        {
+            auto _timeNow = chrono::steady_clock::now();
+
+            if (InputValue > _lastValue)
+            {
+                auto _delta = InputValue - _lastValue;
+
+                GameFrames += _delta;
+                MissedFrames += _delta - 1;
+
+                // Learn the period, unless this is the first frame after a pause.
+                // If we slept through a few frames, they took their share each.
+
+                auto _elapsed = chrono::duration<double, milli>(_timeNow - _lastChange).count() / _delta;
+
+                if (_delta <= 4 && _elapsed < _framePeriod * 4)
+                    _framePeriod += (_elapsed - _framePeriod) / 8;
+            }
+
+            else
+                DuplicateFrames++;
+
+            FiredFrames++;
+
+            _lastValue = InputValue;
+            _lastChange = _timeNow;
+        }
+};
+
+#endif
@@ -0,0 +1,197 @@
+#ifndef IDLEWATCH
+#define IDLEWATCH
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+
+#include <MemoryLib.hpp>
+
+using namespace std;
+
+// Tells whether the game is doing anything worth ticking for. It is idle if
+// every watched region of memory has stayed the same for a while (the game
+// sits on a menu or is paused), or if its window is minimized.
+//
+// The longer it stays idle, the slower the engine is told to tick, down to
+// one tick in "MaxFactor". The moment anything moves, it goes back to full
+// rate. It is looked at every tick, so waking up takes one tick at most.
+
+class IdleWatch
+{
+    public:
+        enum IdleState { IDLE_ACTIVE, IDLE_STILL, IDLE_HIDDEN, IDLE_COUNT };
+
+        struct Region
+        {
+            uint64_t address;
+            size_t size;
+        };
+
+        vector<Region> RegionList;
+        bool WatchWindow = true;
+
+        // How long, in milliseconds, the regions have to stay the same before
+        // the rate is halved, and how long after that it is halved again.
+
+        double StillDelay = 1000;
+        double StepTime = 2000;
+        uint32_t MaxFactor = 8;
+
+        atomic<IdleState> State = IDLE_ACTIVE;
+        atomic<uint32_t> Factor = 1;
+
+        // How long was spent in each state, in microseconds.
+
+        atomic<uint64_t> StateTime[IDLE_COUNT] = { };
+
+        bool Enabled() const { return MaxFactor > 1 && (!RegionList.empty() || WatchWindow); }
+
+        void Reset()
+        {
+            _lastUpdate = chrono::steady_clock::now();
+            _lastMove = _lastUpdate;
+            _lastHash = HashRegions();
+
+            State = IDLE_ACTIVE;
+            Factor = 1;
+
+            for (auto& _time : StateTime)
+                _time = 0;
+        }
+
+        // Called once a tick. Returns how many times slower the next tick should be.
+
+        uint32_t Update()
+        {
+            auto _timeNow = chrono::steady_clock::now();
+
+            StateTime[State].fetch_add(chrono::duration_cast<chrono::microseconds>(_timeNow - _lastUpdate).count(), memory_order_relaxed);
+            _lastUpdate = _timeNow;
+
+            if (WatchWindow && WindowHidden(_timeNow))
+                return Enter(IDLE_HIDDEN, MaxFactor);
+
+            if (RegionList.empty())
+                return Enter(IDLE_ACTIVE, 1);
+
+            auto _hash = HashRegions();
+
+            if (_hash != _lastHash)
+            {
+                _lastHash = _hash;
+                _lastMove = _timeNow;
+
+                return Enter(IDLE_ACTIVE, 1);
+            }
+
+            auto _still = chrono::duration<double, milli>(_timeNow - _lastMove).count();
+
+            if (_still < StillDelay)
+                return Enter(IDLE_ACTIVE, 1);
+
+            auto _steps = (uint64_t)((_still - StillDelay) / StepTime) + 1;
+            auto _factor = _steps < 32 ? (uint64_t)1 << _steps : MaxFactor;
+
+            return Enter(IDLE_STILL, _factor < MaxFactor ? (uint32_t)_factor : MaxFactor);
+        }
+
+        double StateSeconds(IdleState InputState) const { return StateTime[InputState] / 1000000.0; }
+
+        static const char* StateName(IdleState InputState)
+        {
+            switch (InputState)
+            {
+                case IDLE_STILL: return "Still";
+                case IDLE_HIDDEN: return "Hidden";
+                default: return "Active";
+            }
+        }
+
+    private:
+        chrono::steady_clock::time_point _lastUpdate;
+        chrono::steady_clock::time_point _lastMove;
+        uint64_t _lastHash = 0;
+
+        #if defined(_WIN32) || defined(_WIN64)
+            HWND _gameWindow = NULL;
+            chrono::steady_clock::time_point _lastSearch;
+        #endif
+
+        uint32_t Enter(IdleState InputState, uint32_t InputFactor)
+        {
+            State = InputState;
+            Factor = InputFactor;
+
+            return InputFactor;
+        }
+
+        // FNV-1a over every watched region. Good enough to tell whether anything changed.
+
+        uint64_t HashRegions()
+        {
+            uint64_t _hash = 0xCBF29CE484222325;
+
+            for (auto& _region : RegionList)
+            {
+                for (auto _byte : MemoryLib::ReadBytes(_region.address, (int)_region.size))
+                {
+                    _hash ^= _byte;
+                    _hash *= 0x100000001B3;
+                }
+            }
+
+            return _hash;
+        }
+
+        bool WindowHidden(chrono::steady_clock::time_point InputTime)
+        {
+            #if defined(_WIN32) || defined(_WIN64)
+                if (MemoryLib::PIdentifier == 0)
+                    return false;
+
+                // Going through every window is slow, and the game may have
+                // none for a good while as it starts. Look once a second at most.
+
+                if ((_gameWindow == NULL || !IsWindow(_gameWindow)) && InputTime - _lastSearch >= chrono::seconds(1))
+                {
+                    _gameWindow = FindGameWindow();
+                    _lastSearch = InputTime;
+                }
+
+                return _gameWindow != NULL && IsIconic(_gameWindow);
+            #else
+                (void)InputTime;
+                return false;
+            #endif
+        }
+
+        #if defined(_WIN32) || defined(_WIN64)
+            // The first visible top-level window the game owns.
+
+            static HWND FindGameWindow()
+            {
+                struct WindowSearch { DWORD processID; HWND foundWindow; };
+                WindowSearch _search = { MemoryLib::PIdentifier, NULL };
+
+                EnumWindows([](HWND _window, LPARAM _param) -> BOOL
+                {
+                    auto _search = (WindowSearch*)_param;
+                    DWORD _processID = 0;
+
+                    GetWindowThreadProcessId(_window, &_processID);
+
+                    if (_processID != _search->processID || !IsWindowVisible(_window) || GetWindow(_window, GW_OWNER) != NULL)
+                        return TRUE;
+
+                    _search->foundWindow = _window;
+                    return FALSE;
+                }, (LPARAM)&_search);
+
+                return _search.foundWindow;
+            }
+        #endif
+};
+
+#endif
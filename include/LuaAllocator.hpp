@@ -0,0 +1,231 @@
+#ifndef LUAALLOCATOR
+#define LUAALLOCATOR
+
+#include <atomic>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+using namespace std;
+
+// A size-class pool allocator for a single lua_State.
+// Lua churns through a lot of tiny objects (strings and tables from
+// ReadArray/ReadString, closures, upvalues...), so every request up to
+// 256 bytes is served from 16-byte size classes carved out of 64KB chunks.
+// Bigger requests go to the system allocator as usual.
+//
+// It also keeps the live and peak byte counts of the state, and refuses to
+// grow past ByteLimit if one is given. Lua turns a refused allocation into a
+// regular "not enough memory" error, so only the offending script dies.
+
+class LuaAllocator
+{
+    private:
+        static constexpr size_t _classStep = 16;
+        static constexpr size_t _classCount = 16;
+        static constexpr size_t _chunkSize = 64 * 1024;
+
+        struct FreeBlock { FreeBlock* next; };
+
+        FreeBlock* _freeLists[_classCount] = { };
+        vector<uint8_t*> _chunkList;
+        vector<void*> _adoptedList;
+
+        uint8_t* _chunkHead = nullptr;
+        size_t _chunkLeft = 0;
+
+        static size_t SizeClass(size_t _size) { return (_size + _classStep - 1) / _classStep - 1; }
+        static bool IsPooled(size_t _size) { return _size > 0 && _size <= _classStep * _classCount; }
+
+        void* PoolAlloc(size_t _size)
+        {
+            auto _class = SizeClass(_size);
+            auto _block = _freeLists[_class];
+
+            if (_block != nullptr)
+            {
+                _freeLists[_class] = _block->next;
+                return _block;
+            }
+
+            auto _blockSize = (_class + 1) * _classStep;
+
+            if (_chunkLeft < _blockSize)
+            {
+                // Whatever is left in the old chunk is too small for this
+                // class. Hand it out to the smaller classes instead of wasting it.
+
+                while (_chunkLeft >= _classStep)
+                {
+                    auto _restClass = _chunkLeft / _classStep - 1;
+                    auto _restBlock = (FreeBlock*)_chunkHead;
+
+                    _restBlock->next = _freeLists[_restClass];
+                    _freeLists[_restClass] = _restBlock;
+
+                    _chunkHead += (_restClass + 1) * _classStep;
+                    _chunkLeft -= (_restClass + 1) * _classStep;
+                }
+
+                _chunkHead = (uint8_t*)malloc(_chunkSize);
+
+                if (_chunkHead == nullptr)
+                {
+                    _chunkLeft = 0;
+                    return nullptr;
+                }
+
+                _chunkList.push_back(_chunkHead);
+                _chunkLeft = _chunkSize;
+            }
+
+            auto _return = _chunkHead;
+
+            _chunkHead += _blockSize;
+            _chunkLeft -= _blockSize;
+
+            return _return;
+        }
+
+        // A malloc'd block which ends up in the pool, see Allocate. If even
+        // this fails, the block is only leaked, which beats crashing.
+
+        void Adopt(void* _ptr)
+        {
+            try { _adoptedList.push_back(_ptr); }
+            catch (...) { }
+        }
+
+        void PoolFree(void* _ptr, size_t _size)
+        {
+            auto _class = SizeClass(_size);
+            auto _block = (FreeBlock*)_ptr;
+
+            _block->next = _freeLists[_class];
+            _freeLists[_class] = _block;
+        }
+
+    public:
+        atomic<size_t> LiveBytes = 0;
+        atomic<size_t> PeakBytes = 0;
+
+        // Set when an allocation was refused, until whoever reports it takes it.
+
+        size_t ByteLimit;
+        atomic<bool> LimitHit = false;
+
+        LuaAllocator(size_t InputLimit = 0) : ByteLimit(InputLimit) { }
+        LuaAllocator(const LuaAllocator&) = delete;
+        LuaAllocator& operator=(const LuaAllocator&) = delete;
+
+        ~LuaAllocator()
+        {
+            for (auto _chunk : _chunkList)
+                free(_chunk);
+
+            for (auto _block : _adoptedList)
+                free(_block);
+        }
+
+        size_t PooledBytes() const { return _chunkList.size() * _chunkSize; }
+
+        // The lua_Alloc entry point. "InputUser" is the allocator itself.
+
+        static void* Allocate(void* InputUser, void* InputPtr, size_t OldSize, size_t NewSize)
+        {
+            auto _alloc = (LuaAllocator*)InputUser;
+
+            // If there is no block, OldSize is the type of the object, not a size.
+
+            if (InputPtr == nullptr)
+                OldSize = 0;
+
+            if (NewSize == 0)
+            {
+                if (InputPtr != nullptr)
+                {
+                    IsPooled(OldSize) ? _alloc->PoolFree(InputPtr, OldSize) : free(InputPtr);
+                    _alloc->LiveBytes -= OldSize;
+                }
+
+                return nullptr;
+            }
+
+            auto _live = _alloc->LiveBytes.load(memory_order_relaxed);
+
+            // Only refuse growth. Lua expects shrinking to always succeed.
+
+            if (_alloc->ByteLimit != 0 && NewSize > OldSize && _live - OldSize + NewSize > _alloc->ByteLimit)
+            {
+                _alloc->LimitHit = true;
+                return nullptr;
+            }
+
+            void* _return = nullptr;
+
+            if (IsPooled(NewSize))
+            {
+                // Same class? Nothing to move around.
+
+                if (InputPtr != nullptr && IsPooled(OldSize) && SizeClass(OldSize) == SizeClass(NewSize))
+                    _return = InputPtr;
+
+                else
+                {
+                    _return = _alloc->PoolAlloc(NewSize);
+
+                    // Lua can't handle a shrink which fails, so the block stays where it is.
+                    // A malloc'd one is then freed with the allocator.
+
+                    if (_return == nullptr)
+                    {
+                        if (InputPtr == nullptr || NewSize > OldSize)
+                            return nullptr;
+
+                        if (!IsPooled(OldSize))
+                            _alloc->Adopt(InputPtr);
+
+                        _return = InputPtr;
+                    }
+
+                    else if (InputPtr != nullptr)
+                    {
+                        memcpy(_return, InputPtr, OldSize < NewSize ? OldSize : NewSize);
+                        IsPooled(OldSize) ? _alloc->PoolFree(InputPtr, OldSize) : free(InputPtr);
+                    }
+                }
+            }
+
+            else if (InputPtr != nullptr && !IsPooled(OldSize))
+            {
+                _return = realloc(InputPtr, NewSize);
+
+                if (_return == nullptr)
+                    return nullptr;
+            }
+
+            else
+            {
+                _return = malloc(NewSize);
+
+                if (_return == nullptr)
+                    return nullptr;
+
+                if (InputPtr != nullptr)
+                {
+                    memcpy(_return, InputPtr, OldSize);
+                    _alloc->PoolFree(InputPtr, OldSize);
+                }
+            }
+
+            _live = _alloc->LiveBytes.fetch_add(NewSize - OldSize, memory_order_relaxed) + NewSize - OldSize;
+
+            if (_live > _alloc->PeakBytes.load(memory_order_relaxed))
+                _alloc->PeakBytes.store(_live, memory_order_relaxed);
+
+            return _return;
+        }
+};
+
+#endif
@@ -0,0 +1,215 @@
+#ifndef LUAMEMORYLIB
+#define LUAMEMORYLIB
+
+#include <type_traits>
+
+#include <lua.hpp>
+#include <MemoryLib.hpp>
+#include <ScriptProfile.hpp>
+
+// The Read*/Write* bindings, as raw lua_CFunctions.
+// These are the hottest calls by far, so instead of going through sol2's
+// overload resolution, every function here looks at the stack once and
+// talks to MemoryLib directly. The optional "Absolute" argument is handled
+// by checking lua_gettop, and the deprecated *A variants are the same
+// functions with Absolute forced on.
+
+class LuaMemoryLib
+{
+    private:
+        static uint64_t ToInteger(lua_State* L, int InputIndex)
+        {
+            int _isNum = 0;
+            auto _value = lua_tointegerx(L, InputIndex, &_isNum);
+
+            // Not an integer, but may still be a float. Truncate it,
+            // just like sol2 would have.
+
+            if (!_isNum)
+            {
+                if (lua_type(L, InputIndex) != LUA_TNUMBER)
+                    luaL_typeerror(L, InputIndex, "number");
+
+                _value = (lua_Integer)lua_tonumber(L, InputIndex);
+            }
+
+            return (uint64_t)_value;
+        }
+
+        static bool ToAbsolute(lua_State* L, int InputIndex) { return lua_gettop(L) >= InputIndex && lua_toboolean(L, InputIndex); }
+
+        template <typename T> static T ToValue(lua_State* L, int InputIndex)
+        {
+            if constexpr (is_same_v<T, bool>)
+                return lua_toboolean(L, InputIndex);
+
+            else if constexpr (is_floating_point_v<T>)
+                return (T)luaL_checknumber(L, InputIndex);
+
+            else
+                return (T)ToInteger(L, InputIndex);
+        }
+
+        template <typename T> static void PushValue(lua_State* L, T InputValue) { lua_pushinteger(L, (lua_Integer)InputValue); }
+        static void PushValue(lua_State* L, float InputValue) { lua_pushnumber(L, InputValue); }
+        static void PushValue(lua_State* L, bool InputValue) { lua_pushboolean(L, InputValue); }
+
+        static int ToLength(lua_State* L, int InputIndex)
+        {
+            auto _len = (int64_t)ToInteger(L, InputIndex);
+            luaL_argcheck(L, _len >= 0 && _len <= INT32_MAX, InputIndex, "invalid length");
+            return (int)_len;
+        }
+
+    public:
+
+    // Reader Functions
+
+    template <typename T, T (*Reader)(uint64_t, bool), bool Absolute = false>
+    static int ReadValue(lua_State* L)
+    {
+        auto _addr = ToInteger(L, 1);
+        PushValue(L, Reader(_addr, Absolute || ToAbsolute(L, 2)));
+
+        ScriptProfile::CountRead(sizeof(T));
+        return 1;
+    }
+
+    template <bool Absolute = false>
+    static int ReadArray(lua_State* L)
+    {
+        auto _addr = ToInteger(L, 1);
+        auto _len = ToLength(L, 2);
+
+        auto _value = MemoryLib::ReadBytes(_addr, _len, Absolute || ToAbsolute(L, 3));
+
+        lua_createtable(L, _len, 0);
+
+        for (int i = 0; i < _len; i++)
+        {
+            lua_pushinteger(L, _value[i]);
+            lua_rawseti(L, -2, i + 1);
+        }
+
+        ScriptProfile::CountRead(_len);
+        return 1;
+    }
+
+    template <bool Absolute = false>
+    static int ReadString(lua_State* L)
+    {
+        auto _addr = ToInteger(L, 1);
+        auto _len = ToLength(L, 2);
+
+        auto _value = MemoryLib::ReadBytes(_addr, _len, Absolute || ToAbsolute(L, 3));
+
+        lua_pushlstring(L, (const char*)_value.data(), _value.size());
+
+        ScriptProfile::CountRead(_len);
+        return 1;
+    }
+
+    // Writer Functions
+
+    template <typename T, void (*Writer)(uint64_t, T, bool), bool Absolute = false>
+    static int WriteValue(lua_State* L)
+    {
+        auto _addr = ToInteger(L, 1);
+        auto _value = ToValue<T>(L, 2);
+
+        Writer(_addr, _value, Absolute || ToAbsolute(L, 3));
+
+        ScriptProfile::CountWrite(sizeof(T));
+        return 0;
+    }
+
+    template <bool Absolute = false>
+    static int WriteArray(lua_State* L)
+    {
+        auto _addr = ToInteger(L, 1);
+        luaL_checktype(L, 2, LUA_TTABLE);
+
+        auto _len = lua_rawlen(L, 2);
+        vector<uint8_t> _value(_len);
+
+        for (size_t i = 0; i < _len; i++)
+        {
+            lua_rawgeti(L, 2, i + 1);
+            _value[i] = (uint8_t)ToInteger(L, -1);
+            lua_pop(L, 1);
+        }
+
+        MemoryLib::WriteBytes(_addr, _value, Absolute || ToAbsolute(L, 3));
+
+        ScriptProfile::CountWrite(_len);
+        return 0;
+    }
+
+    template <bool Absolute = false>
+    static int WriteString(lua_State* L)
+    {
+        size_t _len = 0;
+
+        auto _addr = ToInteger(L, 1);
+        auto _str = luaL_checklstring(L, 2, &_len);
+
+        MemoryLib::WriteBytes(_addr, vector<uint8_t>(_str, _str + _len), Absolute || ToAbsolute(L, 3));
+
+        ScriptProfile::CountWrite(_len);
+        return 0;
+    }
+
+    // The one table every state gets its memory functions from.
+
+    static inline const luaL_Reg Functions[] =
+    {
+        { "ReadByte", ReadValue<uint8_t, MemoryLib::ReadByte> },
+        { "ReadShort", ReadValue<uint16_t, MemoryLib::ReadShort> },
+        { "ReadInt", ReadValue<uint32_t, MemoryLib::ReadInt> },
+        { "ReadLong", ReadValue<uint64_t, MemoryLib::ReadLong> },
+        { "ReadFloat", ReadValue<float, MemoryLib::ReadFloat> },
+        { "ReadBoolean", ReadValue<bool, MemoryLib::ReadBool> },
+        { "ReadArray", ReadArray<> },
+        { "ReadString", ReadString<> },
+
+        { "WriteByte", WriteValue<uint8_t, MemoryLib::WriteByte> },
+        { "WriteShort", WriteValue<uint16_t, MemoryLib::WriteShort> },
+        { "WriteInt", WriteValue<uint32_t, MemoryLib::WriteInt> },
+        { "WriteLong", WriteValue<uint64_t, MemoryLib::WriteLong> },
+        { "WriteFloat", WriteValue<float, MemoryLib::WriteFloat> },
+        { "WriteBoolean", WriteValue<bool, MemoryLib::WriteBool> },
+        { "WriteArray", WriteArray<> },
+        { "WriteString", WriteString<> },
+
+        // === DEPRECATED, TO BE REMOVED ===
+
+        { "ReadByteA", ReadValue<uint8_t, MemoryLib::ReadByte, true> },
+        { "ReadShortA", ReadValue<uint16_t, MemoryLib::ReadShort, true> },
+        { "ReadIntA", ReadValue<uint32_t, MemoryLib::ReadInt, true> },
+        { "ReadLongA", ReadValue<uint64_t, MemoryLib::ReadLong, true> },
+        { "ReadFloatA", ReadValue<float, MemoryLib::ReadFloat, true> },
+        { "ReadBooleanA", ReadValue<bool, MemoryLib::ReadBool, true> },
+        { "ReadArrayA", ReadArray<true> },
+        { "ReadStringA", ReadString<true> },
+
+        { "WriteByteA", WriteValue<uint8_t, MemoryLib::WriteByte, true> },
+        { "WriteShortA", WriteValue<uint16_t, MemoryLib::WriteShort, true> },
+        { "WriteIntA", WriteValue<uint32_t, MemoryLib::WriteInt, true> },
+        { "WriteLongA", WriteValue<uint64_t, MemoryLib::WriteLong, true> },
+        { "WriteFloatA", WriteValue<float, MemoryLib::WriteFloat, true> },
+        { "WriteBooleanA", WriteValue<bool, MemoryLib::WriteBool, true> },
+        { "WriteArrayA", WriteArray<true> },
+        { "WriteStringA", WriteString<true> },
+
+        { NULL, NULL }
+    };
+
+    static void Register(lua_State* L)
+    {
+        lua_pushglobaltable(L);
+        luaL_setfuncs(L, Functions, 0);
+        lua_pop(L, 1);
+    }
+};
+
+#endif
@@ -0,0 +1,406 @@
+#ifndef MEMORYDUMP
+#define MEMORYDUMP
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_map>
+
+#include <MemorySource.hpp>
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+using namespace std;
+
+// A memory dump to run scripts against, instead of the game. Either a raw
+// image, like an emulator's RAM, which sits at one address, or an ELF core
+// file, which has every segment of the process at its own address.
+//
+// The file is mapped copy-on-write, so reads are a memcpy out of the map
+// and writes only ever touch our own copy of a page. The file itself is
+// never written to. Segments which are larger in memory than in the file
+// (nothing was dumped for them) read as zero, and writes to those go into
+// an overlay of their own.
+
+class MemoryDump : public MemorySource
+{
+    public:
+        enum DumpType { DUMP_NONE, DUMP_RAW, DUMP_CORE };
+
+        struct Segment
+        {
+            uint64_t address;
+            uint64_t memSize;
+            uint64_t fileSize;
+            uint8_t* data;
+        };
+
+        DumpType Type = DUMP_NONE;
+
+        // Reads and writes which fell outside of every segment.
+
+        atomic<uint64_t> MissCount = 0;
+
+        // Opens the dump at the given path. Raw images are placed at
+        // "InputAddress", core files ignore it.
+
+        MemoryDump(const string& InputPath, uint64_t InputAddress = 0)
+        {
+            if (!MapFile(InputPath))
+                return;
+
+            if (_mapSize >= 4 && memcmp(_mapData, "\x7F" "ELF", 4) == 0)
+            {
+                if (ParseCore())
+                    Type = DUMP_CORE;
+            }
+
+            else
+            {
+                _segmentList.push_back({ InputAddress, _mapSize, _mapSize, _mapData });
+                Type = DUMP_RAW;
+            }
+
+            sort(_segmentList.begin(), _segmentList.end(), [](const Segment& _left, const Segment& _right) { return _left.address < _right.address; });
+        }
+
+        ~MemoryDump()
+        {
+            #if defined(_WIN32) || defined(_WIN64)
+                if (_mapData != nullptr)
+                    UnmapViewOfFile(_mapData);
+
+                if (_mapHandle != NULL)
+                    CloseHandle(_mapHandle);
+
+                if (_fileHandle != INVALID_HANDLE_VALUE)
+                    CloseHandle(_fileHandle);
+            #else
+                if (_mapData != nullptr)
+                    munmap(_mapData, _mapSize);
+            #endif
+        }
+
+        MemoryDump(const MemoryDump&) = delete;
+        MemoryDump& operator=(const MemoryDump&) = delete;
+
+        bool IsValid() const { return Type != DUMP_NONE && !_segmentList.empty(); }
+
+        const vector<Segment>& SegmentList() const { return _segmentList; }
+
+        // The lowest address any segment sits at, for core files to be based at.
+
+        uint64_t LowAddress() const { return _segmentList.empty() ? 0 : _segmentList.front().address; }
+
+        // How many bytes were written into pages no segment has in the file.
+
+        size_t OverlaySize()
+        {
+            lock_guard<mutex> _lock(_overlayLock);
+            return _overlayMap.size() * PageSize;
+        }
+
+        static const char* TypeName(DumpType InputType)
+        {
+            switch (InputType)
+            {
+                case DUMP_RAW: return "Raw Image";
+                case DUMP_CORE: return "Core File";
+                default: return "None";
+            }
+        }
+
+        void Read(uint64_t InputAddress, void* OutBuffer, size_t InputSize) override
+        {
+            auto _buffer = (uint8_t*)OutBuffer;
+
+            while (InputSize != 0)
+            {
+                auto _segment = FindSegment(InputAddress);
+
+                if (_segment == nullptr)
+                {
+                    // Nothing there. Fill up to the next segment, or everything.
+
+                    auto _gap = GapSize(InputAddress, InputSize);
+
+                    memset(_buffer, 0, _gap);
+                    MissCount.fetch_add(1, memory_order_relaxed);
+
+                    _buffer += _gap;
+                    InputAddress += _gap;
+                    InputSize -= _gap;
+
+                    continue;
+                }
+
+                auto _offset = InputAddress - _segment->address;
+                auto _size = (size_t)min<uint64_t>(InputSize, _segment->memSize - _offset);
+
+                if (_offset + _size <= _segment->fileSize)
+                    memcpy(_buffer, _segment->data + _offset, _size);
+
+                else
+                    ReadTail(*_segment, _offset, _buffer, _size);
+
+                _buffer += _size;
+                InputAddress += _size;
+                InputSize -= _size;
+            }
+        }
+
+        void Write(uint64_t InputAddress, const void* InputBuffer, size_t InputSize) override
+        {
+            auto _buffer = (const uint8_t*)InputBuffer;
+
+            while (InputSize != 0)
+            {
+                auto _segment = FindSegment(InputAddress);
+
+                if (_segment == nullptr)
+                {
+                    auto _gap = GapSize(InputAddress, InputSize);
+
+                    MissCount.fetch_add(1, memory_order_relaxed);
+
+                    _buffer += _gap;
+                    InputAddress += _gap;
+                    InputSize -= _gap;
+
+                    continue;
+                }
+
+                auto _offset = InputAddress - _segment->address;
+                auto _size = (size_t)min<uint64_t>(InputSize, _segment->memSize - _offset);
+
+                if (_offset + _size <= _segment->fileSize)
+                    memcpy(_segment->data + _offset, _buffer, _size);
+
+                else
+                    WriteTail(*_segment, _offset, _buffer, _size);
+
+                _buffer += _size;
+                InputAddress += _size;
+                InputSize -= _size;
+            }
+        }
+
+    private:
+        static constexpr uint64_t PageSize = 4096;
+
+        uint8_t* _mapData = nullptr;
+        uint64_t _mapSize = 0;
+
+        #if defined(_WIN32) || defined(_WIN64)
+            HANDLE _fileHandle = INVALID_HANDLE_VALUE;
+            HANDLE _mapHandle = NULL;
+        #endif
+
+        vector<Segment> _segmentList;
+
+        // Pages of the parts that are not in the file, by absolute address.
+
+        unordered_map<uint64_t, vector<uint8_t>> _overlayMap;
+        mutex _overlayLock;
+
+        bool MapFile(const string& InputPath)
+        {
+            #if defined(_WIN32) || defined(_WIN64)
+                _fileHandle = CreateFileA(InputPath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+                if (_fileHandle == INVALID_HANDLE_VALUE)
+                    return false;
+
+                LARGE_INTEGER _fileSize;
+
+                if (!GetFileSizeEx(_fileHandle, &_fileSize) || _fileSize.QuadPart == 0)
+                    return false;
+
+                _mapHandle = CreateFileMappingA(_fileHandle, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+
+                if (_mapHandle == NULL)
+                    return false;
+
+                _mapData = (uint8_t*)MapViewOfFile(_mapHandle, FILE_MAP_COPY, 0, 0, 0);
+                _mapSize = (uint64_t)_fileSize.QuadPart;
+            #else
+                auto _file = open(InputPath.c_str(), O_RDONLY);
+
+                if (_file < 0)
+                    return false;
+
+                struct stat _stat;
+
+                if (fstat(_file, &_stat) != 0 || _stat.st_size == 0)
+                {
+                    close(_file);
+                    return false;
+                }
+
+                // The map keeps the file alive on its own.
+
+                auto _map = mmap(nullptr, _stat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, _file, 0);
+                close(_file);
+
+                if (_map == MAP_FAILED)
+                    return false;
+
+                _mapData = (uint8_t*)_map;
+                _mapSize = (uint64_t)_stat.st_size;
+            #endif
+
+            return _mapData != nullptr;
+        }
+
+        // Only little endian ELF files are understood, which is every core
+        // file a PC game or emulator is going to leave behind.
+
+        template <typename T> T Field(uint64_t InputOffset) const
+        {
+            T _value = 0;
+
+            if (InputOffset + sizeof(T) <= _mapSize)
+                memcpy(&_value, _mapData + InputOffset, sizeof(T));
+
+            return _value;
+        }
+
+        bool ParseCore()
+        {
+            enum { ELF_CLASS32 = 1, ELF_CLASS64 = 2, ELF_LITTLE = 1, ELF_CORE = 4, ELF_LOAD = 1 };
+
+            if (_mapSize < 52 || _mapData[5] != ELF_LITTLE || Field<uint16_t>(16) != ELF_CORE)
+                return false;
+
+            bool _wide = _mapData[4] == ELF_CLASS64;
+
+            if (!_wide && _mapData[4] != ELF_CLASS32)
+                return false;
+
+            uint64_t _tableOffset = _wide ? Field<uint64_t>(32) : Field<uint32_t>(28);
+            uint16_t _entrySize = Field<uint16_t>(_wide ? 54 : 42);
+            uint16_t _entryCount = Field<uint16_t>(_wide ? 56 : 44);
+
+            for (uint16_t i = 0; i < _entryCount; i++)
+            {
+                auto _entry = _tableOffset + (uint64_t)i * _entrySize;
+
+                if (_entry + _entrySize > _mapSize || Field<uint32_t>(_entry) != ELF_LOAD)
+                    continue;
+
+                Segment _segment;
+                uint64_t _fileOffset;
+
+                if (_wide)
+                {
+                    _fileOffset = Field<uint64_t>(_entry + 8);
+                    _segment.address = Field<uint64_t>(_entry + 16);
+                    _segment.fileSize = Field<uint64_t>(_entry + 32);
+                    _segment.memSize = Field<uint64_t>(_entry + 40);
+                }
+
+                else
+                {
+                    _fileOffset = Field<uint32_t>(_entry + 4);
+                    _segment.address = Field<uint32_t>(_entry + 8);
+                    _segment.fileSize = Field<uint32_t>(_entry + 16);
+                    _segment.memSize = Field<uint32_t>(_entry + 20);
+                }
+
+                // A truncated core file still gives us what it has.
+
+                if (_fileOffset >= _mapSize)
+                    _segment.fileSize = 0;
+
+                _segment.fileSize = min(_segment.fileSize, _mapSize - min(_fileOffset, _mapSize));
+                _segment.memSize = max(_segment.memSize, _segment.fileSize);
+                _segment.data = _mapData + min(_fileOffset, _mapSize);
+
+                if (_segment.memSize != 0)
+                    _segmentList.push_back(_segment);
+            }
+
+            return !_segmentList.empty();
+        }
+
+        const Segment* FindSegment(uint64_t InputAddress) const
+        {
+            auto _next = upper_bound(_segmentList.begin(), _segmentList.end(), InputAddress,
+                                     [](uint64_t _address, const Segment& _segment) { return _address < _segment.address; });
+
+            if (_next == _segmentList.begin())
+                return nullptr;
+
+            auto _segment = &*(_next - 1);
+            return InputAddress - _segment->address < _segment->memSize ? _segment : nullptr;
+        }
+
+        size_t GapSize(uint64_t InputAddress, size_t InputSize) const
+        {
+            auto _next = upper_bound(_segmentList.begin(), _segmentList.end(), InputAddress,
+                                     [](uint64_t _address, const Segment& _segment) { return _address < _segment.address; });
+
+            if (_next == _segmentList.end())
+                return InputSize;
+
+            return (size_t)min<uint64_t>(InputSize, _next->address - InputAddress);
+        }
+
+        void ReadTail(const Segment& InputSegment, uint64_t InputOffset, uint8_t* OutBuffer, size_t InputSize)
+        {
+            lock_guard<mutex> _lock(_overlayLock);
+
+            for (size_t i = 0; i < InputSize; i++)
+            {
+                auto _offset = InputOffset + i;
+
+                if (_offset < InputSegment.fileSize)
+                    OutBuffer[i] = InputSegment.data[_offset];
+
+                else
+                {
+                    auto _address = InputSegment.address + _offset;
+                    auto _page = _overlayMap.find(_address & ~(PageSize - 1));
+
+                    OutBuffer[i] = _page == _overlayMap.end() ? 0 : _page->second[_address & (PageSize - 1)];
+                }
+            }
+        }
+
+        void WriteTail(const Segment& InputSegment, uint64_t InputOffset, const uint8_t* InputBuffer, size_t InputSize)
+        {
+            lock_guard<mutex> _lock(_overlayLock);
+
+            for (size_t i = 0; i < InputSize; i++)
+            {
+                auto _offset = InputOffset + i;
+
+                if (_offset < InputSegment.fileSize)
+                    InputSegment.data[_offset] = InputBuffer[i];
+
+                else
+                {
+                    auto _address = InputSegment.address + _offset;
+                    auto& _page = _overlayMap[_address & ~(PageSize - 1)];
+
+                    if (_page.empty())
+                        _page.resize(PageSize);
+
+                    _page[_address & (PageSize - 1)] = InputBuffer[i];
+                }
+            }
+        }
+};
+
+#endif
@@ -5,11 +5,19 @@
     #include <windows.h>
     #include <psapi.h>
     #include "TlHelp32.h"
+#else
+    #include <sys/uio.h>
+    #include <unistd.h>
 #endif
 
 #include <iostream>
 #include <string>
 #include <vector>
+#include <cstring>
+
+#include <MemorySource.hpp>
+#include <TimelineTrace.hpp>
+#include <MemoryStats.hpp>
 
 using namespace std;
 
@@ -28,6 +36,10 @@ class MemoryLib
     static inline uint64_t BaseAddress;
     static inline bool BigEndian = false;
 
+    // If set, every read and write goes here instead of the process.
+
+    static inline MemorySource* Source = nullptr;
+
     #if defined(_WIN32) || defined(_WIN64)
         static inline DWORD PIdentifier = 0;
         static inline HANDLE PHandle = NULL;
@@ -128,6 +140,9 @@ class MemoryLib
             BaseAddress = InputAddress;
             ExecAddress = (uint64_t)FindBaseAddr(PHandle, PName);
         };
+    #else
+        static inline pid_t PIdentifier = 0;
+        static inline char PName[4096];
     #endif
 
     static void SetBaseAddr(uint64_t InputAddress)
@@ -135,6 +150,79 @@ class MemoryLib
         BaseAddress = InputAddress;
     }
 
+    // Raw Access, with absolute addresses. Reads which fail come back zeroed.
+    // The Process* ones always go to the process, even with a source set.
+
+    static bool ProcessRead(uint64_t _addr, void* _buffer, size_t _len)
+    {
+        auto _start = MemoryStats::Start();
+
+        #if defined(_WIN32) || defined(_WIN64)
+            auto _success = ReadProcessMemory(PHandle, (void*)(_addr), _buffer, _len, 0) != 0;
+        #else
+            iovec _local = { _buffer, _len };
+            iovec _remote = { (void*)(_addr), _len };
+
+            auto _success = process_vm_readv(PIdentifier, &_local, 1, &_remote, 1, 0) == (ssize_t)_len;
+        #endif
+
+        MemoryStats::Count(MemoryStats::OP_READ, _len, _success, false, _start);
+
+        if (!_success)
+            memset(_buffer, 0, _len);
+
+        return _success;
+    }
+    static void ProcessWrite(uint64_t _addr, const void* _buffer, size_t _len, bool _protect = true)
+    {
+        auto _start = MemoryStats::Start();
+        auto _fallback = false;
+
+        #if defined(_WIN32) || defined(_WIN64)
+            auto _success = WriteProcessMemory(PHandle, (void*)(_addr), _buffer, _len, 0) != 0;
+
+            if (!_success && _protect)
+            {
+                DWORD _protectOld = 0;
+                VirtualProtectEx(PHandle, (void*)(_addr), 256, PAGE_READWRITE, &_protectOld);
+
+                _success = WriteProcessMemory(PHandle, (void*)(_addr), _buffer, _len, 0) != 0;
+                _fallback = true;
+            }
+        #else
+            // No lifting of the protection here, a write to a read-only page just fails.
+
+            (void)_protect;
+
+            iovec _local = { (void*)_buffer, _len };
+            iovec _remote = { (void*)(_addr), _len };
+
+            auto _success = process_vm_writev(PIdentifier, &_local, 1, &_remote, 1, 0) == (ssize_t)_len;
+        #endif
+
+        MemoryStats::Count(MemoryStats::OP_WRITE, _len, _success, _fallback, _start);
+    }
+    static void ReadRaw(uint64_t _addr, void* _buffer, size_t _len)
+    {
+        TimelineTrace::Span _span("Read", "memory", _len, "bytes");
+
+        if (Source != nullptr)
+            Source->Read(_addr, _buffer, _len);
+
+        else
+            ProcessRead(_addr, _buffer, _len);
+    }
+    static void WriteRaw(uint64_t _addr, const void* _buffer, size_t _len, bool _protect = true)
+    {
+        TimelineTrace::Span _span("Write", "memory", _len, "bytes");
+
+        if (Source != nullptr)
+            Source->Write(_addr, _buffer, _len);
+
+        else
+            ProcessWrite(_addr, _buffer, _len, _protect);
+    }
+
     // Reader Functions
 
     static uint8_t ReadByte(uint64_t _addr, bool _absolute = false) { return ReadBytes(_addr, 1, _absolute)[0]; }
@@ -143,7 +231,7 @@ class MemoryLib
         vector<uint8_t> _buffer;
         _buffer.resize(_len);
 
-        ReadProcessMemory(PHandle, _absolute ? (void*)(_addr) : (void*)(_addr + BaseAddress), _buffer.data(), _len, 0);
+        ReadRaw(_absolute ? _addr : _addr + BaseAddress, _buffer.data(), _len);
         return _buffer;
     }
     static uint16_t ReadShort(uint64_t _addr, bool _absolute = false)
@@ -196,21 +284,11 @@ class MemoryLib
 
     static void WriteByte(uint64_t _addr, uint8_t _val, bool _absolute = false)
     { 
-        if (WriteProcessMemory(PHandle, _absolute ? (void*)(_addr) : (void*)(_addr + BaseAddress), &_val, 1, 0) == 0)
-        {
-            DWORD _protectOld = 0;
-            VirtualProtectEx(PHandle, _absolute ? (void*)(_addr) : (void*)(_addr + BaseAddress), 256, PAGE_READWRITE, &_protectOld);
-            WriteProcessMemory(PHandle, _absolute ? (void*)(_addr) : (void*)(_addr + BaseAddress), &_val, 1, 0);
-        }
+        WriteRaw(_absolute ? _addr : _addr + BaseAddress, &_val, 1);
     }
     static void WriteBytes(uint64_t _addr, vector<uint8_t> _val, bool _absolute = false)
     {
-        if (WriteProcessMemory(PHandle, _absolute ? (void*)(_addr) : (void*)(_addr + BaseAddress), _val.data(), _val.size(), 0) == 0)
-        {
-            DWORD _protectOld = 0;
-            VirtualProtectEx(PHandle, _absolute ? (void*)(_addr) : (void*)(_addr + BaseAddress), 256, PAGE_READWRITE, &_protectOld);
-            WriteProcessMemory(PHandle, _absolute ? (void*)(_addr) : (void*)(_addr + BaseAddress), _val.data(), _val.size(), 0);
-        }
+        WriteRaw(_absolute ? _addr : _addr + BaseAddress, _val.data(), _val.size());
     }
     static void WriteShort(uint64_t _addr, uint16_t _val, bool _absolute = false)
     {
@@ -276,7 +354,7 @@ class MemoryLib
 
     static void WriteExec(uint64_t _addr, vector<uint8_t> _val)
     {
-        WriteProcessMemory(PHandle, (void*)(_addr + ExecAddress), _val.data(), _val.size(), 0);
+        WriteRaw(_addr + ExecAddress, _val.data(), _val.size(), false);
     }
 
 };
@@ -0,0 +1,24 @@
+#ifndef MEMORYSOURCE
+#define MEMORYSOURCE
+
+#include <cstddef>
+#include <cstdint>
+
+// Something other than a live process for MemoryLib to read from and write to,
+// like a recorded trace or a dump. Addresses are absolute, the base address
+// is already added. Every Read and Write may come from any worker thread.
+
+class MemorySource
+{
+    public:
+        virtual ~MemorySource() = default;
+
+        virtual void Read(uint64_t, void*, size_t) = 0;
+        virtual void Write(uint64_t, const void*, size_t) = 0;
+
+        // Called at the start of every frame, with the milliseconds since the first.
+
+        virtual void NextFrame(double) { }
+};
+
+#endif
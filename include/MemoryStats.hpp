@@ -0,0 +1,334 @@
+#ifndef MEMORYSTATS
+#define MEMORYSTATS
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// What the reads and writes of the game's memory cost: how many there were,
+// how many bytes they moved, how many failed, how many writes had to lift the
+// page protection first, and how long the calls into the OS took.
+//
+// Every thread counts into a block of its own, so nothing is ever contended.
+// Only its owner writes into a block, and whoever asks adds them all up.
+// Only what goes to the game counts, replays and dumps never get that far.
+
+class MemoryStats
+{
+    public:
+        enum Operation { OP_READ, OP_WRITE, OP_COUNT };
+
+        // The upper edge of every bucket, in nanoseconds. The last is everything else.
+
+        static constexpr size_t BucketCount = 12;
+        static constexpr uint32_t BucketEdges[BucketCount - 1] = { 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000 };
+
+        // Whether the calls are timed at all, and how long, at least, in seconds,
+        // the rates and times are taken over.
+
+        static inline atomic<bool> Timed = true;
+        static inline double WindowLength = 1;
+
+        struct OpStats
+        {
+            uint64_t calls = 0;
+            uint64_t bytes = 0;
+            uint64_t failures = 0;
+            uint64_t fallbacks = 0;
+            uint64_t timeTotal = 0;
+            uint64_t timeCount = 0;
+            uint64_t bucketList[BucketCount] = { };
+        };
+
+        // Since the start, and per second and in microseconds, over the last window.
+
+        struct OpReport
+        {
+            OpStats total;
+
+            float callRate = 0;
+            float byteRate = 0;
+            float failureRate = 0;
+            float fallbackRate = 0;
+
+            float meanTime = 0;
+            float medianTime = 0;
+            float highTime = 0;
+        };
+
+        struct Report
+        {
+            OpReport opList[OP_COUNT];
+            double windowLength = 0;
+        };
+
+        // When a call starts. Zero if it's not timed.
+
+        static uint64_t Start()
+        {
+            return Timed.load(memory_order_relaxed) ? Now() : 0;
+        }
+
+        // A call which started at InputStart just ended.
+
+        static void Count(Operation InputOperation, size_t InputSize, bool InputSuccess, bool InputFallback, uint64_t InputStart)
+        {
+            auto _block = _threadBlock.block;
+
+            if (_block == nullptr)
+                _block = Register();
+
+            auto& _op = _block->opList[InputOperation];
+
+            Bump(_op.calls, 1);
+            Bump(_op.bytes, InputSize);
+
+            if (!InputSuccess)
+                Bump(_op.failures, 1);
+
+            if (InputFallback)
+                Bump(_op.fallbacks, 1);
+
+            if (InputStart != 0)
+            {
+                auto _time = Now() - InputStart;
+                size_t _bucket = 0;
+
+                while (_bucket < BucketCount - 1 && _time > BucketEdges[_bucket])
+                    _bucket++;
+
+                Bump(_op.timeTotal, _time);
+                Bump(_op.timeCount, 1);
+                Bump(_op.bucketList[_bucket], 1);
+            }
+        }
+
+        // Every thread's counts, those which are gone included.
+
+        static void Collect(OpStats (&OutList)[OP_COUNT])
+        {
+            lock_guard<mutex> _lock(RegistryMutex());
+
+            for (size_t i = 0; i < OP_COUNT; i++)
+                OutList[i] = Retired()[i];
+
+            for (auto _block : BlockList())
+                for (size_t i = 0; i < OP_COUNT; i++)
+                    Add(OutList[i], _block->opList[i]);
+        }
+
+        // The totals, with the rates and times over the window which ended last.
+        // A window ends on the first call at least WindowLength after it started,
+        // so asking rarely makes for longer windows, never for wrong rates.
+
+        static Report Current()
+        {
+            static mutex _windowMutex;
+            static OpStats _startList[OP_COUNT];
+            static chrono::steady_clock::time_point _windowStart;
+            static Report _lastReport;
+
+            lock_guard<mutex> _lock(_windowMutex);
+
+            Report _return;
+            OpStats _nowList[OP_COUNT];
+
+            Collect(_nowList);
+
+            auto _now = chrono::steady_clock::now();
+
+            // The first window starts with the first call which was counted.
+
+            if (_windowStart == chrono::steady_clock::time_point())
+            {
+                lock_guard<mutex> _registryLock(RegistryMutex());
+                _windowStart = FirstCount() != chrono::steady_clock::time_point() ? FirstCount() : _now;
+            }
+
+            auto _length = chrono::duration<double>(_now - _windowStart).count();
+
+            if (_length >= WindowLength)
+            {
+                for (size_t i = 0; i < OP_COUNT; i++)
+                {
+                    auto& _report = _lastReport.opList[i];
+                    auto& _start = _startList[i];
+                    auto& _end = _nowList[i];
+
+                    _report.callRate = (float)((_end.calls - _start.calls) / _length);
+                    _report.byteRate = (float)((_end.bytes - _start.bytes) / _length);
+                    _report.failureRate = (float)((_end.failures - _start.failures) / _length);
+                    _report.fallbackRate = (float)((_end.fallbacks - _start.fallbacks) / _length);
+
+                    uint64_t _bucketList[BucketCount];
+
+                    for (size_t b = 0; b < BucketCount; b++)
+                        _bucketList[b] = _end.bucketList[b] - _start.bucketList[b];
+
+                    auto _timeCount = _end.timeCount - _start.timeCount;
+
+                    _report.meanTime = _timeCount != 0 ? (float)((_end.timeTotal - _start.timeTotal) / 1000.0 / _timeCount) : 0;
+                    _report.medianTime = Percentile(_bucketList, 0.5);
+                    _report.highTime = Percentile(_bucketList, 0.95);
+
+                    _start = _end;
+                }
+
+                _lastReport.windowLength = _length;
+                _windowStart = _now;
+            }
+
+            _return = _lastReport;
+
+            for (size_t i = 0; i < OP_COUNT; i++)
+                _return.opList[i].total = _nowList[i];
+
+            return _return;
+        }
+
+    private:
+        struct Counters
+        {
+            atomic<uint64_t> calls = 0;
+            atomic<uint64_t> bytes = 0;
+            atomic<uint64_t> failures = 0;
+            atomic<uint64_t> fallbacks = 0;
+            atomic<uint64_t> timeTotal = 0;
+            atomic<uint64_t> timeCount = 0;
+            atomic<uint64_t> bucketList[BucketCount] = { };
+        };
+
+        struct Block
+        {
+            Counters opList[OP_COUNT];
+        };
+
+        // A thread which exits leaves its counts behind. Only ever
+        // thread_local, so the block starts out as null.
+
+        struct ThreadBlock
+        {
+            Block* block;
+
+            ~ThreadBlock()
+            {
+                if (block == nullptr)
+                    return;
+
+                lock_guard<mutex> _lock(RegistryMutex());
+                auto& _list = BlockList();
+
+                for (size_t i = 0; i < OP_COUNT; i++)
+                    Add(Retired()[i], block->opList[i]);
+
+                for (size_t i = 0; i < _list.size(); i++)
+                {
+                    if (_list[i] == block)
+                    {
+                        _list.erase(_list.begin() + i);
+                        break;
+                    }
+                }
+
+                delete block;
+            }
+        };
+
+        static inline thread_local ThreadBlock _threadBlock;
+
+        static uint64_t Now()
+        {
+            return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        // Only the owner writes, so there is no need to pay for an atomic add.
+
+        static void Bump(atomic<uint64_t>& InputCounter, uint64_t InputValue)
+        {
+            InputCounter.store(InputCounter.load(memory_order_relaxed) + InputValue, memory_order_relaxed);
+        }
+
+        static void Add(OpStats& OutStats, const Counters& InputCounters)
+        {
+            OutStats.calls += InputCounters.calls.load(memory_order_relaxed);
+            OutStats.bytes += InputCounters.bytes.load(memory_order_relaxed);
+            OutStats.failures += InputCounters.failures.load(memory_order_relaxed);
+            OutStats.fallbacks += InputCounters.fallbacks.load(memory_order_relaxed);
+            OutStats.timeTotal += InputCounters.timeTotal.load(memory_order_relaxed);
+            OutStats.timeCount += InputCounters.timeCount.load(memory_order_relaxed);
+
+            for (size_t b = 0; b < BucketCount; b++)
+                OutStats.bucketList[b] += InputCounters.bucketList[b].load(memory_order_relaxed);
+        }
+
+        // The bucket edge below which InputRatio of the calls ended, in microseconds.
+        // The last bucket has no edge, so it gets twice the one before it.
+
+        static float Percentile(const uint64_t (&InputList)[BucketCount], double InputRatio)
+        {
+            uint64_t _total = 0;
+
+            for (auto _bucket : InputList)
+                _total += _bucket;
+
+            if (_total == 0)
+                return 0;
+
+            uint64_t _sum = 0;
+
+            for (size_t i = 0; i < BucketCount - 1; i++)
+            {
+                _sum += InputList[i];
+
+                if (_sum >= _total * InputRatio)
+                    return BucketEdges[i] / 1000.0F;
+            }
+
+            return BucketEdges[BucketCount - 2] * 2 / 1000.0F;
+        }
+
+        static mutex& RegistryMutex()
+        {
+            static mutex _mutex;
+            return _mutex;
+        }
+
+        static vector<Block*>& BlockList()
+        {
+            static vector<Block*> _list;
+            return _list;
+        }
+
+        static OpStats (&Retired())[OP_COUNT]
+        {
+            static OpStats _list[OP_COUNT];
+            return _list;
+        }
+
+        static chrono::steady_clock::time_point& FirstCount()
+        {
+            static chrono::steady_clock::time_point _time;
+            return _time;
+        }
+
+        static Block* Register()
+        {
+            auto _block = new Block();
+
+            lock_guard<mutex> _lock(RegistryMutex());
+            BlockList().push_back(_block);
+
+            if (FirstCount() == chrono::steady_clock::time_point())
+                FirstCount() = chrono::steady_clock::now();
+
+            _threadBlock.block = _block;
+            return _block;
+        }
+};
+
+#endif
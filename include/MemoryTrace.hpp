@@ -0,0 +1,499 @@
+#ifndef MEMORYTRACE
+#define MEMORYTRACE
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <unordered_map>
+
+#include <MemoryLib.hpp>
+
+using namespace std;
+
+// Every read and write the scripts made, frame by frame, so that they can be
+// ran again later without the game. The file starts with a header:
+//
+//     "LFTR", uint32 version, uint64 base address, uint8 big endian
+//
+// Followed by records, each starting with a tag byte:
+//
+//     FRAME => varint microseconds since the last frame started.
+//     READ, WRITE => zigzag varint address, relative to the last record's,
+//                    varint size, then the bytes.
+//
+// A READ with the SAME bit set returned exactly what the last read of that
+// address and size did, and its bytes are left out. Most of what scripts
+// read does not change from frame to frame, so most reads are 2-4 bytes.
+// Anything before the first FRAME happened in _OnInit.
+
+class MemoryTrace
+{
+    public:
+        enum TraceTag : uint8_t { TRACE_FRAME, TRACE_READ, TRACE_WRITE, TRACE_SAME = 0x80 };
+
+        static constexpr uint32_t Version = 1;
+
+    protected:
+        struct RegionKey
+        {
+            uint64_t address;
+            size_t size;
+
+            bool operator==(const RegionKey& InputKey) const { return address == InputKey.address && size == InputKey.size; }
+        };
+
+        struct RegionHash
+        {
+            size_t operator()(const RegionKey& InputKey) const { return hash<uint64_t>()(InputKey.address * 31 + InputKey.size); }
+        };
+
+        // The last value read from every address and size.
+
+        unordered_map<RegionKey, vector<uint8_t>, RegionHash> _lastRead;
+        uint64_t _lastAddress = 0;
+
+        mutex _traceLock;
+
+        static void PutVarint(vector<uint8_t>& OutBuffer, uint64_t InputValue)
+        {
+            while (InputValue >= 0x80)
+            {
+                OutBuffer.push_back((uint8_t)(InputValue | 0x80));
+                InputValue >>= 7;
+            }
+
+            OutBuffer.push_back((uint8_t)InputValue);
+        }
+
+        static bool GetVarint(const uint8_t*& InputPos, const uint8_t* InputEnd, uint64_t& OutValue)
+        {
+            OutValue = 0;
+
+            for (int _shift = 0; _shift < 64; _shift += 7)
+            {
+                if (InputPos >= InputEnd)
+                    return false;
+
+                auto _byte = *InputPos++;
+                OutValue |= (uint64_t)(_byte & 0x7F) << _shift;
+
+                if (!(_byte & 0x80))
+                    return true;
+            }
+
+            return false;
+        }
+
+        static uint64_t ZigZag(int64_t InputValue) { return ((uint64_t)InputValue << 1) ^ (uint64_t)(InputValue >> 63); }
+        static int64_t UnZigZag(uint64_t InputValue) { return (int64_t)(InputValue >> 1) ^ -(int64_t)(InputValue & 1); }
+};
+
+// Passes everything through to the process, and writes it down on the way.
+
+class TraceRecorder : public MemorySource, protected MemoryTrace
+{
+    public:
+        atomic<uint64_t> FrameCount = 0;
+        atomic<uint64_t> ReadCount = 0;
+        atomic<uint64_t> SameCount = 0;
+        atomic<uint64_t> WriteCount = 0;
+        atomic<uint64_t> FileBytes = 0;
+
+        TraceRecorder(const string& InputPath)
+        {
+            _traceFile = fopen(InputPath.c_str(), "wb");
+
+            if (_traceFile == nullptr)
+                return;
+
+            uint8_t _endian = MemoryLib::BigEndian;
+
+            fwrite("LFTR", 1, 4, _traceFile);
+            fwrite(&Version, sizeof(Version), 1, _traceFile);
+            fwrite(&MemoryLib::BaseAddress, sizeof(uint64_t), 1, _traceFile);
+            fwrite(&_endian, 1, 1, _traceFile);
+
+            FileBytes = 17;
+        }
+
+        ~TraceRecorder()
+        {
+            if (_traceFile == nullptr)
+                return;
+
+            Flush();
+            fclose(_traceFile);
+        }
+
+        TraceRecorder(const TraceRecorder&) = delete;
+        TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+        bool IsOpen() const { return _traceFile != nullptr; }
+
+        void Read(uint64_t InputAddress, void* OutBuffer, size_t InputSize) override
+        {
+            MemoryLib::ProcessRead(InputAddress, OutBuffer, InputSize);
+
+            lock_guard<mutex> _lock(_traceLock);
+
+            auto& _last = _lastRead[{ InputAddress, InputSize }];
+            auto _same = _last.size() == InputSize && memcmp(_last.data(), OutBuffer, InputSize) == 0;
+
+            PutRecord(_same ? TRACE_READ | TRACE_SAME : TRACE_READ, InputAddress, InputSize, _same ? nullptr : OutBuffer);
+
+            if (!_same)
+                _last.assign((uint8_t*)OutBuffer, (uint8_t*)OutBuffer + InputSize);
+
+            ReadCount++;
+            SameCount += _same;
+        }
+
+        void Write(uint64_t InputAddress, const void* InputBuffer, size_t InputSize) override
+        {
+            {
+                lock_guard<mutex> _lock(_traceLock);
+
+                PutRecord(TRACE_WRITE, InputAddress, InputSize, InputBuffer);
+                WriteCount++;
+            }
+
+            MemoryLib::ProcessWrite(InputAddress, InputBuffer, InputSize);
+        }
+
+        void NextFrame(double InputTime) override
+        {
+            lock_guard<mutex> _lock(_traceLock);
+
+            auto _time = (uint64_t)(InputTime * 1000);
+
+            _buffer.push_back(TRACE_FRAME);
+            PutVarint(_buffer, _time - _lastTime);
+
+            _lastTime = _time;
+            FrameCount++;
+
+            if (_buffer.size() >= 65536)
+                Flush();
+        }
+
+    private:
+        FILE* _traceFile = nullptr;
+        vector<uint8_t> _buffer;
+        uint64_t _lastTime = 0;
+
+        void PutRecord(uint8_t InputTag, uint64_t InputAddress, size_t InputSize, const void* InputData)
+        {
+            _buffer.push_back(InputTag);
+
+            PutVarint(_buffer, ZigZag((int64_t)(InputAddress - _lastAddress)));
+            PutVarint(_buffer, InputSize);
+
+            if (InputData != nullptr)
+                _buffer.insert(_buffer.end(), (const uint8_t*)InputData, (const uint8_t*)InputData + InputSize);
+
+            _lastAddress = InputAddress;
+        }
+
+        void Flush()
+        {
+            fwrite(_buffer.data(), 1, _buffer.size(), _traceFile);
+
+            FileBytes += _buffer.size();
+            _buffer.clear();
+        }
+};
+
+// Plays a trace back. Every frame, whatever the game had in memory at the time
+// is put back into a sparse image of it, which the scripts then read from.
+// What the scripts write goes into the image too, and is held against what
+// they wrote back then. Anything different, extra, or missing is a divergence.
+
+class TraceReplay : public MemorySource, protected MemoryTrace
+{
+    public:
+        enum DivergenceType { DIVERGE_VALUE, DIVERGE_EXTRA, DIVERGE_MISSING };
+
+        struct Divergence
+        {
+            DivergenceType divergeType;
+            int64_t frameIndex;
+            uint64_t address;
+
+            vector<uint8_t> expectedData;
+            vector<uint8_t> actualData;
+        };
+
+        static constexpr size_t DivergenceLimit = 100;
+
+        uint64_t BaseAddress = 0;
+        bool BigEndian = false;
+
+        atomic<uint64_t> DivergenceCount = 0;
+        atomic<uint64_t> MissCount = 0;
+
+        // The first DivergenceLimit of them.
+
+        vector<Divergence> DivergenceList;
+
+        TraceReplay(const string& InputPath)
+        {
+            auto _traceFile = fopen(InputPath.c_str(), "rb");
+
+            if (_traceFile == nullptr)
+                return;
+
+            fseek(_traceFile, 0, SEEK_END);
+            _traceData.resize(ftell(_traceFile));
+            fseek(_traceFile, 0, SEEK_SET);
+
+            auto _size = fread(_traceData.data(), 1, _traceData.size(), _traceFile);
+            fclose(_traceFile);
+
+            uint32_t _version = 0;
+
+            if (_size != _traceData.size() || _size < 17 || memcmp(_traceData.data(), "LFTR", 4) != 0)
+                return;
+
+            memcpy(&_version, &_traceData[4], 4);
+            memcpy(&BaseAddress, &_traceData[8], 8);
+            BigEndian = _traceData[16] != 0;
+
+            if (_version != Version)
+                return;
+
+            _readPos = _traceData.data() + 17;
+            _valid = true;
+
+            // Whatever _OnInit read and wrote.
+
+            DecodeFrame();
+        }
+
+        TraceReplay(const TraceReplay&) = delete;
+        TraceReplay& operator=(const TraceReplay&) = delete;
+
+        bool IsValid() const { return _valid; }
+        bool Finished() const { return !_valid || _readPos >= _traceData.data() + _traceData.size(); }
+
+        // When the next frame started, in milliseconds since the first.
+
+        double NextTime() const
+        {
+            uint64_t _delta = 0;
+            auto _pos = _readPos + 1;
+
+            if (Finished() || !GetVarint(_pos, _traceData.data() + _traceData.size(), _delta))
+                return _frameTime / 1000.0;
+
+            return (_frameTime + _delta) / 1000.0;
+        }
+
+        int64_t FrameIndex() const { return _frameIndex; }
+
+        void Read(uint64_t InputAddress, void* OutBuffer, size_t InputSize) override
+        {
+            lock_guard<mutex> _lock(_traceLock);
+
+            if (!CopyImage(InputAddress, (uint8_t*)OutBuffer, InputSize, false))
+                MissCount++;
+        }
+
+        void Write(uint64_t InputAddress, const void* InputBuffer, size_t InputSize) override
+        {
+            lock_guard<mutex> _lock(_traceLock);
+
+            CopyImage(InputAddress, (uint8_t*)InputBuffer, InputSize, true);
+
+            // Find the write it was back then. Same address and size
+            // but a different value is still that write, only wrong.
+
+            auto _data = (const uint8_t*)InputBuffer;
+            Expected* _found = nullptr;
+
+            for (auto& _expect : _expectList)
+            {
+                if (_expect.matched || _expect.address != InputAddress || _expect.data.size() != InputSize)
+                    continue;
+
+                if (memcmp(_expect.data.data(), _data, InputSize) == 0)
+                {
+                    _found = &_expect;
+                    break;
+                }
+
+                if (_found == nullptr)
+                    _found = &_expect;
+            }
+
+            if (_found == nullptr)
+            {
+                AddDivergence(DIVERGE_EXTRA, InputAddress, { }, vector<uint8_t>(_data, _data + InputSize));
+                return;
+            }
+
+            _found->matched = true;
+
+            if (memcmp(_found->data.data(), _data, InputSize) != 0)
+                AddDivergence(DIVERGE_VALUE, InputAddress, _found->data, vector<uint8_t>(_data, _data + InputSize));
+        }
+
+        void NextFrame(double) override
+        {
+            lock_guard<mutex> _lock(_traceLock);
+
+            FinishFrame();
+
+            if (Finished())
+                return;
+
+            uint64_t _delta = 0;
+
+            _readPos++;
+            GetVarint(_readPos, _traceData.data() + _traceData.size(), _delta);
+
+            _frameTime += _delta;
+            _frameIndex++;
+
+            DecodeFrame();
+        }
+
+        // Counts whatever the last frame did not write.
+
+        void Finish()
+        {
+            lock_guard<mutex> _lock(_traceLock);
+            FinishFrame();
+        }
+
+        static const char* DivergenceName(DivergenceType InputType)
+        {
+            switch (InputType)
+            {
+                case DIVERGE_EXTRA: return "Extra";
+                case DIVERGE_MISSING: return "Missing";
+                default: return "Value";
+            }
+        }
+
+    private:
+        static constexpr uint64_t PageSize = 4096;
+
+        struct Expected
+        {
+            uint64_t address;
+            vector<uint8_t> data;
+            bool matched;
+        };
+
+        vector<uint8_t> _traceData;
+        const uint8_t* _readPos = nullptr;
+        bool _valid = false;
+
+        int64_t _frameIndex = -1;
+        uint64_t _frameTime = 0;
+
+        unordered_map<uint64_t, unique_ptr<uint8_t[]>> _pageList;
+        vector<Expected> _expectList;
+
+        // Reads the records up to the next FRAME.
+
+        void DecodeFrame()
+        {
+            auto _end = _traceData.data() + _traceData.size();
+
+            while (_readPos < _end && *_readPos != TRACE_FRAME)
+            {
+                auto _tag = *_readPos++;
+                uint64_t _delta = 0, _size = 0;
+
+                if (!GetVarint(_readPos, _end, _delta) || !GetVarint(_readPos, _end, _size))
+                    break;
+
+                auto _address = _lastAddress + (uint64_t)UnZigZag(_delta);
+                auto& _last = _lastRead[{ _address, _size }];
+
+                _lastAddress = _address;
+
+                if ((_tag & ~TRACE_SAME) == TRACE_READ && (_tag & TRACE_SAME))
+                {
+                    _last.resize(_size);
+                    CopyImage(_address, _last.data(), _size, true);
+                    continue;
+                }
+
+                if ((uint64_t)(_end - _readPos) < _size)
+                    break;
+
+                if (_tag == TRACE_READ)
+                {
+                    _last.assign(_readPos, _readPos + _size);
+                    CopyImage(_address, _last.data(), _size, true);
+                }
+
+                else
+                    _expectList.push_back({ _address, vector<uint8_t>(_readPos, _readPos + _size), false });
+
+                _readPos += _size;
+            }
+        }
+
+        void FinishFrame()
+        {
+            for (auto& _expect : _expectList)
+            {
+                if (!_expect.matched)
+                    AddDivergence(DIVERGE_MISSING, _expect.address, _expect.data, { });
+            }
+
+            _expectList.clear();
+        }
+
+        void AddDivergence(DivergenceType InputType, uint64_t InputAddress, vector<uint8_t> InputExpected, vector<uint8_t> InputActual)
+        {
+            if (DivergenceList.size() < DivergenceLimit)
+                DivergenceList.push_back({ InputType, _frameIndex, InputAddress, move(InputExpected), move(InputActual) });
+
+            DivergenceCount++;
+        }
+
+        // Copies between the image and a buffer, in whichever direction. Returns
+        // false if reading from a page nothing was ever recorded in.
+
+        bool CopyImage(uint64_t InputAddress, uint8_t* InputBuffer, size_t InputSize, bool InputStore)
+        {
+            bool _known = true;
+
+            while (InputSize > 0)
+            {
+                auto _offset = InputAddress % PageSize;
+                auto _chunk = min<uint64_t>(InputSize, PageSize - _offset);
+                auto& _page = _pageList[InputAddress / PageSize];
+
+                if (_page == nullptr)
+                {
+                    _page.reset(new uint8_t[PageSize]());
+                    _known = InputStore;
+                }
+
+                if (InputStore)
+                    memcpy(_page.get() + _offset, InputBuffer, _chunk);
+
+                else
+                    memcpy(InputBuffer, _page.get() + _offset, _chunk);
+
+                InputAddress += _chunk;
+                InputBuffer += _chunk;
+                InputSize -= _chunk;
+            }
+
+            return _known;
+        }
+};
+
+#endif
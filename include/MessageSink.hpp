@@ -0,0 +1,20 @@
+#ifndef MESSAGESINK
+#define MESSAGESINK
+
+#include <string>
+
+using namespace std;
+
+// Wherever the backend's messages end up. The GUI prints them to its console,
+// the command line runner to stdout. The type is 0 for a plain message,
+// 1 for success, 2 for a warning and 3 for an error. Messages are HTML,
+// with "<br>" for line breaks, since that is what the console shows.
+
+class MessageSink
+{
+    public:
+        virtual ~MessageSink() = default;
+        virtual void writeMessage(const string&, int type = 0) = 0;
+};
+
+#endif
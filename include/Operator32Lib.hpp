@@ -1,11 +1,10 @@
 #ifndef OP32LIB
 #define OP32LIB
 
-#include <windows.h>
+#include <bitset>
+#include <cstdint>
 #include <iostream>
 #include <string>
-#include <psapi.h>
-#include "TlHelp32.h"
 
 using namespace std;
 
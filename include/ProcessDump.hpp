@@ -0,0 +1,766 @@
+#ifndef PROCESSDUMP
+#define PROCESSDUMP
+
+#include <map>
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <algorithm>
+#include <condition_variable>
+
+#include <MemoryLib.hpp>
+#include <ProcessStats.hpp>
+
+using namespace std;
+
+// Dumps every readable region of the game into one file, to be looked at
+// or ran against later. The regions are cut into chunks, which a number of
+// workers read and compress side by side, while the calling thread writes
+// them out in order. At most a few chunks per worker are in flight, so the
+// memory used stays the same however large the game is.
+//
+// The file looks like this, with every number little endian:
+//
+//     "LFDM", uint32 version, uint32 chunk size, uint32 0
+//     Every chunk, back to back.
+//     uint64 region count, then for every region:
+//         uint64 address, uint64 size
+//     uint64 chunk count, then for every chunk:
+//         uint64 file offset, uint32 stored size, uint32 size, uint8 kind
+//     uint64 offset of the region count, "LFDM", uint32 0
+//
+// Chunks are in region order, every region taking as many as it needs, so
+// where any address is in the file is known without reading anything else.
+
+class DumpCodec
+{
+    public:
+        // A plain LZ77. Every sequence is a varint count of literals, the
+        // literals, then a varint match length and offset. A match length of
+        // 0 ends it. Memory is mostly zeroes and repeated structures, which
+        // this packs well enough, and fast.
+
+        static void Compress(const uint8_t* InputData, size_t InputSize, vector<uint8_t>& OutBuffer)
+        {
+            constexpr int _hashBits = 14;
+            constexpr uint32_t _empty = UINT32_MAX;
+
+            thread_local vector<uint32_t> _table;
+            _table.assign(1 << _hashBits, _empty);
+
+            OutBuffer.clear();
+            OutBuffer.reserve(InputSize / 2);
+
+            size_t _pos = 0;
+            size_t _literal = 0;
+            size_t _missCount = 0;
+
+            while (_pos + 4 <= InputSize)
+            {
+                uint32_t _sequence;
+                memcpy(&_sequence, InputData + _pos, 4);
+
+                auto _hash = (_sequence * 2654435761U) >> (32 - _hashBits);
+                auto _match = _table[_hash];
+
+                _table[_hash] = (uint32_t)_pos;
+
+                if (_match == _empty || memcmp(InputData + _match, InputData + _pos, 4) != 0)
+                {
+                    // The longer nothing matches, the faster we skip ahead.
+
+                    _pos += 1 + (_missCount++ >> 6);
+                    continue;
+                }
+
+                size_t _length = 4;
+
+                while (_pos + _length < InputSize && InputData[_match + _length] == InputData[_pos + _length])
+                    _length++;
+
+                PutLiterals(OutBuffer, InputData + _literal, _pos - _literal);
+                PutVarint(OutBuffer, _length);
+                PutVarint(OutBuffer, _pos - _match);
+
+                _pos += _length;
+                _literal = _pos;
+                _missCount = 0;
+            }
+
+            PutLiterals(OutBuffer, InputData + _literal, InputSize - _literal);
+            PutVarint(OutBuffer, 0);
+        }
+
+        static bool Decompress(const uint8_t* InputData, size_t InputSize, uint8_t* OutData, size_t OutSize)
+        {
+            auto _end = InputData + InputSize;
+            size_t _pos = 0;
+
+            while (true)
+            {
+                uint64_t _literal, _length, _offset;
+
+                if (!GetVarint(InputData, _end, _literal) || _literal > (uint64_t)(_end - InputData) || _literal > OutSize - _pos)
+                    return false;
+
+                memcpy(OutData + _pos, InputData, _literal);
+
+                InputData += _literal;
+                _pos += _literal;
+
+                if (!GetVarint(InputData, _end, _length))
+                    return false;
+
+                if (_length == 0)
+                    return _pos == OutSize;
+
+                if (!GetVarint(InputData, _end, _offset) || _offset == 0 || _offset > _pos || _length > OutSize - _pos)
+                    return false;
+
+                // The match may overlap what it is writing, so byte by byte.
+
+                for (size_t i = 0; i < _length; i++, _pos++)
+                    OutData[_pos] = OutData[_pos - _offset];
+            }
+        }
+
+    private:
+        static void PutVarint(vector<uint8_t>& OutBuffer, uint64_t InputValue)
+        {
+            while (InputValue >= 0x80)
+            {
+                OutBuffer.push_back((uint8_t)(InputValue | 0x80));
+                InputValue >>= 7;
+            }
+
+            OutBuffer.push_back((uint8_t)InputValue);
+        }
+
+        static bool GetVarint(const uint8_t*& InputPos, const uint8_t* InputEnd, uint64_t& OutValue)
+        {
+            OutValue = 0;
+
+            for (int _shift = 0; _shift < 64; _shift += 7)
+            {
+                if (InputPos >= InputEnd)
+                    return false;
+
+                auto _byte = *InputPos++;
+                OutValue |= (uint64_t)(_byte & 0x7F) << _shift;
+
+                if ((_byte & 0x80) == 0)
+                    return true;
+            }
+
+            return false;
+        }
+
+        static void PutLiterals(vector<uint8_t>& OutBuffer, const uint8_t* InputData, size_t InputSize)
+        {
+            PutVarint(OutBuffer, InputSize);
+            OutBuffer.insert(OutBuffer.end(), InputData, InputData + InputSize);
+        }
+};
+
+// Which regions of the game to dump. Only the parts between the two addresses are.
+
+struct DumpFilter
+{
+    uint64_t lowAddress = 0;
+    uint64_t highAddress = UINT64_MAX;
+    bool writableOnly = false;
+};
+
+class ProcessDump
+{
+    public:
+        // STORED chunks are as they were, PACKED ones went through DumpCodec,
+        // and MISSING ones could not be read and are not in the file.
+
+        enum ChunkKind : uint8_t { CHUNK_STORED, CHUNK_PACKED, CHUNK_MISSING };
+
+        static constexpr uint32_t Version = 1;
+
+        struct Region
+        {
+            uint64_t address;
+            uint64_t size;
+        };
+
+        struct Chunk
+        {
+            uint64_t offset;
+            uint32_t storedSize;
+            uint32_t size;
+            ChunkKind kind;
+        };
+
+        struct Result
+        {
+            bool success = false;
+            string errorText;
+
+            size_t regionCount = 0;
+            size_t chunkCount = 0;
+            size_t missingCount = 0;
+
+            uint64_t rawBytes = 0;
+            uint64_t fileBytes = 0;
+            double runTime = 0;
+
+            // The most our buffers held at once, and the most the whole process did.
+
+            uint64_t peakBytes = 0;
+            uint64_t processPeak = 0;
+
+            double Throughput() const { return runTime > 0 ? rawBytes / runTime / 1e9 : 0; }
+        };
+
+        static inline uint32_t ChunkSize = 1 << 20;
+        static inline size_t WorkerCount = 0;
+
+        // Every committed, readable region of the game, in order.
+
+        static vector<Region> ListRegions(const DumpFilter& InputFilter = DumpFilter())
+        {
+            vector<Region> _return;
+
+            auto _addRegion = [&](uint64_t _start, uint64_t _end)
+            {
+                _start = max(_start, InputFilter.lowAddress);
+                _end = min(_end, InputFilter.highAddress);
+
+                if (_end > _start)
+                    _return.push_back({ _start, _end - _start });
+            };
+
+            #if defined(_WIN32) || defined(_WIN64)
+                MEMORY_BASIC_INFORMATION _info;
+                uint64_t _address = 0;
+
+                while (VirtualQueryEx(MemoryLib::PHandle, (LPCVOID)_address, &_info, sizeof(_info)) == sizeof(_info))
+                {
+                    auto _start = (uint64_t)_info.BaseAddress;
+                    auto _end = _start + _info.RegionSize;
+
+                    auto _readable = _info.State == MEM_COMMIT && (_info.Protect & PAGE_NOACCESS) == 0 && (_info.Protect & PAGE_GUARD) == 0;
+                    auto _writable = (_info.Protect & (PAGE_READWRITE | PAGE_WRITECOPY | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY)) != 0;
+
+                    if (_readable && (_writable || !InputFilter.writableOnly))
+                        _addRegion(_start, _end);
+
+                    if (_end <= _address)
+                        break;
+
+                    _address = _end;
+                }
+            #else
+                ifstream _maps("/proc/" + to_string(MemoryLib::PIdentifier) + "/maps");
+                string _line;
+
+                while (getline(_maps, _line))
+                {
+                    unsigned long long _start, _end;
+                    char _perms[5] = { };
+
+                    if (sscanf(_line.c_str(), "%llx-%llx %4s", &_start, &_end, _perms) != 3)
+                        continue;
+
+                    if (_perms[0] == 'r' && (_perms[1] == 'w' || !InputFilter.writableOnly))
+                        _addRegion(_start, _end);
+                }
+            #endif
+
+            return _return;
+        }
+
+        // Dumps the regions the filter lets through into "InputPath". The
+        // progress, in bytes read, can be watched from another thread, and
+        // setting the cancel flag stops it after the chunks in flight.
+
+        static Result DumpProcess(const string& InputPath, const DumpFilter& InputFilter = DumpFilter(),
+                                  atomic<uint64_t>* OutProgress = nullptr, atomic<bool>* InputCancel = nullptr)
+        {
+            Result _result;
+            auto _runStart = chrono::steady_clock::now();
+
+            if (ChunkSize == 0)
+            {
+                _result.errorText = "The chunk size cannot be zero.";
+                return _result;
+            }
+
+            auto _regionList = ListRegions(InputFilter);
+            _result.regionCount = _regionList.size();
+
+            if (_regionList.empty())
+            {
+                _result.errorText = "There is nothing readable to dump.";
+                return _result;
+            }
+
+            // Every chunk of every region, in the order they go into the file.
+
+            struct ChunkJob
+            {
+                uint64_t address;
+                uint32_t size;
+
+                ChunkKind kind;
+                vector<uint8_t> data;
+                bool ready;
+            };
+
+            vector<ChunkJob> _jobList;
+
+            for (auto& _region : _regionList)
+                for (uint64_t _offset = 0; _offset < _region.size; _offset += ChunkSize)
+                    _jobList.push_back({ _region.address + _offset, (uint32_t)min<uint64_t>(ChunkSize, _region.size - _offset), CHUNK_MISSING, { }, false });
+
+            FILE* _file = fopen(InputPath.c_str(), "wb");
+
+            if (_file == nullptr)
+            {
+                _result.errorText = "The file \"" + InputPath + "\" cannot be written.";
+                return _result;
+            }
+
+            uint32_t _header[4] = { 0, Version, ChunkSize, 0 };
+            memcpy(_header, "LFDM", 4);
+            fwrite(_header, sizeof(_header), 1, _file);
+
+            auto _workerCount = WorkerCount != 0 ? WorkerCount : max<size_t>(2, std::thread::hardware_concurrency());
+            auto _windowSize = _workerCount * 2;
+
+            mutex _jobLock;
+            condition_variable _jobSignal;
+
+            atomic<size_t> _nextJob = 0;
+            size_t _written = 0;
+
+            atomic<uint64_t> _heldBytes = 0;
+            atomic<uint64_t> _peakBytes = 0;
+
+            auto _hold = [&](int64_t _bytes)
+            {
+                auto _held = _heldBytes.fetch_add(_bytes) + _bytes;
+                auto _peak = _peakBytes.load();
+
+                while (_held > _peak && !_peakBytes.compare_exchange_weak(_peak, _held)) { }
+            };
+
+            // Read and compress, never getting more than the window ahead of the writer.
+
+            auto _worker = [&]()
+            {
+                vector<uint8_t> _raw;
+
+                while (true)
+                {
+                    auto _index = _nextJob++;
+
+                    if (_index >= _jobList.size())
+                        return;
+
+                    {
+                        unique_lock<mutex> _lock(_jobLock);
+                        _jobSignal.wait(_lock, [&] { return _index < _written + _windowSize || (InputCancel != nullptr && *InputCancel); });
+                    }
+
+                    auto& _job = _jobList[_index];
+                    vector<uint8_t> _stored;
+                    ChunkKind _kind = CHUNK_MISSING;
+
+                    if (InputCancel == nullptr || !*InputCancel)
+                    {
+                        _raw.resize(_job.size);
+                        _hold(_raw.capacity());
+
+                        if (MemoryLib::ProcessRead(_job.address, _raw.data(), _job.size))
+                        {
+                            DumpCodec::Compress(_raw.data(), _job.size, _stored);
+                            _kind = CHUNK_PACKED;
+
+                            if (_stored.size() >= _job.size)
+                            {
+                                _stored = _raw;
+                                _kind = CHUNK_STORED;
+                            }
+
+                            _hold(_stored.capacity());
+                        }
+
+                        _hold(-(int64_t)_raw.capacity());
+
+                        if (OutProgress != nullptr)
+                            OutProgress->fetch_add(_job.size, memory_order_relaxed);
+                    }
+
+                    lock_guard<mutex> _lock(_jobLock);
+
+                    _job.kind = _kind;
+                    _job.data = move(_stored);
+                    _job.ready = true;
+
+                    _jobSignal.notify_all();
+                }
+            };
+
+            vector<std::thread> _workerList;
+
+            for (size_t i = 0; i < _workerCount; i++)
+                _workerList.emplace_back(_worker);
+
+            // Write the chunks out in order, as they come in.
+
+            vector<Chunk> _chunkList;
+            uint64_t _fileOffset = sizeof(_header);
+
+            for (size_t i = 0; i < _jobList.size(); i++)
+            {
+                unique_lock<mutex> _lock(_jobLock);
+                _jobSignal.wait(_lock, [&] { return _jobList[i].ready; });
+
+                auto _data = move(_jobList[i].data);
+                auto _kind = _jobList[i].kind;
+
+                _lock.unlock();
+
+                if (!_data.empty())
+                    fwrite(_data.data(), 1, _data.size(), _file);
+
+                _chunkList.push_back({ _fileOffset, (uint32_t)_data.size(), _jobList[i].size, _kind });
+
+                _fileOffset += _data.size();
+                _result.rawBytes += _kind != CHUNK_MISSING ? _jobList[i].size : 0;
+                _result.missingCount += _kind == CHUNK_MISSING;
+
+                _hold(-(int64_t)_data.capacity());
+
+                _lock.lock();
+                _written = i + 1;
+                _jobSignal.notify_all();
+            }
+
+            for (auto& _thread : _workerList)
+                _thread.join();
+
+            // The index, then where it starts.
+
+            auto _indexOffset = _fileOffset;
+
+            auto _putValue = [&](auto _value)
+            {
+                fwrite(&_value, sizeof(_value), 1, _file);
+                _fileOffset += sizeof(_value);
+            };
+
+            _putValue((uint64_t)_regionList.size());
+
+            for (auto& _region : _regionList)
+            {
+                _putValue(_region.address);
+                _putValue(_region.size);
+            }
+
+            _putValue((uint64_t)_chunkList.size());
+
+            for (auto& _chunk : _chunkList)
+            {
+                _putValue(_chunk.offset);
+                _putValue(_chunk.storedSize);
+                _putValue(_chunk.size);
+                _putValue((uint8_t)_chunk.kind);
+            }
+
+            _putValue(_indexOffset);
+            fwrite("LFDM", 4, 1, _file);
+            _fileOffset += 4;
+            _putValue((uint32_t)0);
+
+            // ftell is 32 bits on Windows, so count instead. A write which
+            // failed anywhere along the way, say on a full disk, fails it all.
+
+            auto _writeFailed = ferror(_file) != 0;
+
+            _result.fileBytes = _fileOffset;
+            _result.success = fclose(_file) == 0 && !_writeFailed && (InputCancel == nullptr || !*InputCancel);
+
+            if (!_result.success)
+                _result.errorText = InputCancel != nullptr && *InputCancel ? "The dump was cancelled." : "The dump could not be written out.";
+
+            _result.chunkCount = _chunkList.size();
+            _result.runTime = chrono::duration<double>(chrono::steady_clock::now() - _runStart).count();
+            _result.peakBytes = _peakBytes;
+            _result.processPeak = ProcessPeak();
+
+            return _result;
+        }
+
+        // The most memory this process has used at once, in bytes.
+
+        static uint64_t ProcessPeak() { return ProcessStats::PeakBytes(); }
+};
+
+// A dump written by ProcessDump, to run scripts against. Chunks are read
+// and unpacked the first time anything in them is, and the last few are
+// kept around. Writes go into a copy of the chunk and stay in memory.
+
+class DumpArchive : public MemorySource
+{
+    public:
+        atomic<uint64_t> MissCount = 0;
+
+        // Whether the file at the path starts like a ProcessDump file.
+
+        static bool IsArchive(const string& InputPath)
+        {
+            char _magic[4] = { };
+            ifstream(InputPath, ios::binary).read(_magic, 4);
+
+            return memcmp(_magic, "LFDM", 4) == 0;
+        }
+
+        DumpArchive(const string& InputPath, size_t InputCacheSize = 64) : _cacheSize(max<size_t>(InputCacheSize, 1))
+        {
+            _file.open(InputPath, ios::binary);
+
+            if (!_file)
+                return;
+
+            uint32_t _header[4];
+
+            _file.seekg(0, ios::end);
+            auto _fileSize = (uint64_t)_file.tellg();
+
+            if (_fileSize < sizeof(_header) + 16)
+                return;
+
+            _file.seekg(0);
+            _file.read((char*)_header, sizeof(_header));
+
+            if (memcmp(_header, "LFDM", 4) != 0 || _header[1] != ProcessDump::Version || _header[2] == 0)
+                return;
+
+            _chunkSize = _header[2];
+
+            uint64_t _indexOffset;
+            char _magic[4];
+
+            _file.seekg(_fileSize - 16);
+            _file.read((char*)&_indexOffset, 8);
+            _file.read(_magic, 4);
+
+            if (memcmp(_magic, "LFDM", 4) != 0 || _indexOffset >= _fileSize)
+                return;
+
+            _file.seekg(_indexOffset);
+
+            uint64_t _regionCount = GetValue<uint64_t>();
+
+            for (uint64_t i = 0; i < _regionCount && _file; i++)
+            {
+                RegionEntry _entry;
+
+                _entry.address = GetValue<uint64_t>();
+                _entry.size = GetValue<uint64_t>();
+                _entry.firstChunk = _chunkCount;
+
+                _chunkCount += (_entry.size + _chunkSize - 1) / _chunkSize;
+                _regionList.push_back(_entry);
+            }
+
+            if (GetValue<uint64_t>() != _chunkCount)
+                return;
+
+            _chunkList.resize(_chunkCount);
+
+            for (auto& _chunk : _chunkList)
+            {
+                _chunk.offset = GetValue<uint64_t>();
+                _chunk.storedSize = GetValue<uint32_t>();
+                _chunk.size = GetValue<uint32_t>();
+                _chunk.kind = (ProcessDump::ChunkKind)GetValue<uint8_t>();
+            }
+
+            _valid = (bool)_file;
+        }
+
+        DumpArchive(const DumpArchive&) = delete;
+        DumpArchive& operator=(const DumpArchive&) = delete;
+
+        bool IsValid() const { return _valid; }
+
+        vector<ProcessDump::Region> RegionList() const
+        {
+            vector<ProcessDump::Region> _return;
+
+            for (auto& _region : _regionList)
+                _return.push_back({ _region.address, _region.size });
+
+            return _return;
+        }
+
+        void Read(uint64_t InputAddress, void* OutBuffer, size_t InputSize) override
+        {
+            Access(InputAddress, (uint8_t*)OutBuffer, InputSize, false);
+        }
+
+        void Write(uint64_t InputAddress, const void* InputBuffer, size_t InputSize) override
+        {
+            Access(InputAddress, (uint8_t*)InputBuffer, InputSize, true);
+        }
+
+    private:
+        struct RegionEntry
+        {
+            uint64_t address;
+            uint64_t size;
+            uint64_t firstChunk;
+        };
+
+        ifstream _file;
+        bool _valid = false;
+
+        uint32_t _chunkSize = 0;
+        uint64_t _chunkCount = 0;
+
+        vector<RegionEntry> _regionList;
+        vector<ProcessDump::Chunk> _chunkList;
+
+        // Unpacked chunks, the most recently used first. Written ones are never let go of.
+
+        size_t _cacheSize;
+        list<pair<uint64_t, vector<uint8_t>>> _cacheList;
+        map<uint64_t, decltype(_cacheList)::iterator> _cacheMap;
+        map<uint64_t, vector<uint8_t>> _writtenMap;
+
+        mutex _accessLock;
+
+        template <typename T> T GetValue()
+        {
+            T _value = 0;
+            _file.read((char*)&_value, sizeof(T));
+
+            return _value;
+        }
+
+        void Access(uint64_t InputAddress, uint8_t* InputBuffer, size_t InputSize, bool InputWrite)
+        {
+            lock_guard<mutex> _lock(_accessLock);
+
+            while (InputSize != 0)
+            {
+                auto _next = upper_bound(_regionList.begin(), _regionList.end(), InputAddress,
+                                         [](uint64_t _address, const RegionEntry& _region) { return _address < _region.address; });
+
+                auto _region = _next == _regionList.begin() ? nullptr : &*(_next - 1);
+
+                if (_region == nullptr || InputAddress - _region->address >= _region->size)
+                {
+                    auto _gap = _next == _regionList.end() ? InputSize : (size_t)min<uint64_t>(InputSize, _next->address - InputAddress);
+
+                    if (!InputWrite)
+                        memset(InputBuffer, 0, _gap);
+
+                    MissCount.fetch_add(1, memory_order_relaxed);
+
+                    InputBuffer += _gap;
+                    InputAddress += _gap;
+                    InputSize -= _gap;
+
+                    continue;
+                }
+
+                auto _offset = InputAddress - _region->address;
+                auto _index = _region->firstChunk + _offset / _chunkSize;
+                auto _inChunk = (size_t)(_offset % _chunkSize);
+                auto _size = min<size_t>(InputSize, _chunkList[_index].size - _inChunk);
+
+                auto& _data = ChunkData(_index, InputWrite);
+
+                if (InputWrite)
+                    memcpy(_data.data() + _inChunk, InputBuffer, _size);
+
+                else
+                    memcpy(InputBuffer, _data.data() + _inChunk, _size);
+
+                InputBuffer += _size;
+                InputAddress += _size;
+                InputSize -= _size;
+            }
+        }
+
+        vector<uint8_t>& ChunkData(uint64_t InputIndex, bool InputWrite)
+        {
+            auto _written = _writtenMap.find(InputIndex);
+
+            if (_written != _writtenMap.end())
+                return _written->second;
+
+            auto _cached = _cacheMap.find(InputIndex);
+
+            if (_cached == _cacheMap.end())
+            {
+                if (_cacheList.size() >= _cacheSize)
+                {
+                    _cacheMap.erase(_cacheList.back().first);
+                    _cacheList.pop_back();
+                }
+
+                _cacheList.emplace_front(InputIndex, LoadChunk(InputIndex));
+                _cached = _cacheMap.emplace(InputIndex, _cacheList.begin()).first;
+            }
+
+            else
+                _cacheList.splice(_cacheList.begin(), _cacheList, _cached->second);
+
+            if (!InputWrite)
+                return _cached->second->second;
+
+            auto& _copy = _writtenMap[InputIndex] = move(_cached->second->second);
+
+            _cacheList.erase(_cached->second);
+            _cacheMap.erase(_cached);
+
+            return _copy;
+        }
+
+        // Missing or broken chunks read as zero.
+
+        vector<uint8_t> LoadChunk(uint64_t InputIndex)
+        {
+            auto& _chunk = _chunkList[InputIndex];
+            vector<uint8_t> _return(_chunk.size);
+
+            if (_chunk.kind == ProcessDump::CHUNK_MISSING)
+                return _return;
+
+            vector<uint8_t> _stored(_chunk.storedSize);
+
+            _file.clear();
+            _file.seekg(_chunk.offset);
+            _file.read((char*)_stored.data(), _stored.size());
+
+            if (!_file)
+                fill(_return.begin(), _return.end(), 0);
+
+            else if (_chunk.kind == ProcessDump::CHUNK_STORED && _stored.size() == _return.size())
+                _return = move(_stored);
+
+            else if (_chunk.kind != ProcessDump::CHUNK_PACKED || !DumpCodec::Decompress(_stored.data(), _stored.size(), _return.data(), _return.size()))
+                fill(_return.begin(), _return.end(), 0);
+
+            return _return;
+        }
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef PROCESSSTATS
+#define PROCESSSTATS
+
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <windows.h>
+    #include <psapi.h>
+    #include "TlHelp32.h"
+#else
+    #include <unistd.h>
+    #include <sys/resource.h>
+#endif
+
+using namespace std;
+
+// What this process itself is using, to tell if something is
+// piling up over a long run. Zero if it cannot be told.
+
+class ProcessStats
+{
+    public:
+        // The memory which is in RAM right now, in bytes.
+
+        static uint64_t ResidentBytes()
+        {
+            #if defined(_WIN32) || defined(_WIN64)
+                PROCESS_MEMORY_COUNTERS _counters = { };
+                _counters.cb = sizeof(_counters);
+
+                return GetProcessMemoryInfo(GetCurrentProcess(), &_counters, sizeof(_counters)) ? _counters.WorkingSetSize : 0;
+            #else
+                auto _file = fopen("/proc/self/statm", "r");
+
+                if (_file == nullptr)
+                    return 0;
+
+                unsigned long long _totalPages = 0, _residentPages = 0;
+                auto _count = fscanf(_file, "%llu %llu", &_totalPages, &_residentPages);
+                fclose(_file);
+
+                return _count == 2 ? _residentPages * (uint64_t)sysconf(_SC_PAGESIZE) : 0;
+            #endif
+        }
+
+        // The most memory this process has had in RAM at once, in bytes.
+
+        static uint64_t PeakBytes()
+        {
+            #if defined(_WIN32) || defined(_WIN64)
+                PROCESS_MEMORY_COUNTERS _counters = { };
+                _counters.cb = sizeof(_counters);
+
+                return GetProcessMemoryInfo(GetCurrentProcess(), &_counters, sizeof(_counters)) ? _counters.PeakWorkingSetSize : 0;
+            #else
+                rusage _usage = { };
+                return getrusage(RUSAGE_SELF, &_usage) == 0 ? (uint64_t)_usage.ru_maxrss * 1024 : 0;
+            #endif
+        }
+
+        // How many threads this process has, including the calling one.
+
+        static size_t ThreadCount()
+        {
+            size_t _return = 0;
+
+            #if defined(_WIN32) || defined(_WIN64)
+                auto _snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+
+                if (_snapshot == INVALID_HANDLE_VALUE)
+                    return 0;
+
+                THREADENTRY32 _entry;
+                _entry.dwSize = sizeof(_entry);
+
+                auto _processID = GetCurrentProcessId();
+
+                for (auto _valid = Thread32First(_snapshot, &_entry); _valid; _valid = Thread32Next(_snapshot, &_entry))
+                    if (_entry.th32OwnerProcessID == _processID)
+                        _return++;
+
+                CloseHandle(_snapshot);
+            #else
+                auto _file = fopen("/proc/self/status", "r");
+
+                if (_file == nullptr)
+                    return 0;
+
+                char _line[256];
+
+                while (fgets(_line, sizeof(_line), _file) != nullptr)
+                {
+                    if (strncmp(_line, "Threads:", 8) == 0)
+                    {
+                        _return = strtoull(_line + 8, nullptr, 10);
+                        break;
+                    }
+                }
+
+                fclose(_file);
+            #endif
+
+            return _return;
+        }
+};
+
+#endif
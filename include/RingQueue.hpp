@@ -0,0 +1,104 @@
+#ifndef RINGQUEUE
+#define RINGQUEUE
+
+#include <atomic>
+#include <cstddef>
+
+using namespace std;
+
+// A bounded lock-free queue, for passing things between threads without
+// ever blocking either side. Any number of threads may push and pop.
+// Every cell carries a sequence number telling whether it is free to be
+// written or ready to be read for the current lap around the ring.
+// Capacity has to be a power of two.
+
+template <typename T, size_t Capacity = 1024>
+class RingQueue
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity has to be a power of two.");
+
+    private:
+        struct Cell
+        {
+            atomic<size_t> sequence;
+            T data;
+        };
+
+        Cell _cellList[Capacity];
+
+        alignas(64) atomic<size_t> _pushPos;
+        alignas(64) atomic<size_t> _popPos;
+
+    public:
+        RingQueue()
+        {
+            for (size_t i = 0; i < Capacity; i++)
+                _cellList[i].sequence.store(i, memory_order_relaxed);
+
+            _pushPos.store(0, memory_order_relaxed);
+            _popPos.store(0, memory_order_relaxed);
+        }
+
+        RingQueue(const RingQueue&) = delete;
+        RingQueue& operator=(const RingQueue&) = delete;
+
+        // Returns false if the queue is full.
+
+        bool Push(T InputItem)
+        {
+            auto _pos = _pushPos.load(memory_order_relaxed);
+
+            while (true)
+            {
+                auto& _cell = _cellList[_pos & (Capacity - 1)];
+                auto _diff = (ptrdiff_t)_cell.sequence.load(memory_order_acquire) - (ptrdiff_t)_pos;
+
+                if (_diff == 0)
+                {
+                    if (_pushPos.compare_exchange_weak(_pos, _pos + 1, memory_order_relaxed))
+                    {
+                        _cell.data = move(InputItem);
+                        _cell.sequence.store(_pos + 1, memory_order_release);
+                        return true;
+                    }
+                }
+
+                else if (_diff < 0)
+                    return false;
+
+                else
+                    _pos = _pushPos.load(memory_order_relaxed);
+            }
+        }
+
+        // Returns false if the queue is empty.
+
+        bool Pop(T& OutItem)
+        {
+            auto _pos = _popPos.load(memory_order_relaxed);
+
+            while (true)
+            {
+                auto& _cell = _cellList[_pos & (Capacity - 1)];
+                auto _diff = (ptrdiff_t)_cell.sequence.load(memory_order_acquire) - (ptrdiff_t)(_pos + 1);
+
+                if (_diff == 0)
+                {
+                    if (_popPos.compare_exchange_weak(_pos, _pos + 1, memory_order_relaxed))
+                    {
+                        OutItem = move(_cell.data);
+                        _cell.sequence.store(_pos + Capacity, memory_order_release);
+                        return true;
+                    }
+                }
+
+                else if (_diff < 0)
+                    return false;
+
+                else
+                    _pos = _popPos.load(memory_order_relaxed);
+            }
+        }
+};
+
+#endif
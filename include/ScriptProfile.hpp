@@ -0,0 +1,183 @@
+#ifndef SCRIPTPROFILE
+#define SCRIPTPROFILE
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// How long a script's _OnFrame calls take, and how much of the game's memory
+// they touch. Only whoever runs the script writes into it, one call at a time,
+// but any thread may read it at any time.
+//
+// The percentiles are of the last full window, a second by default, so they
+// follow the script as it goes instead of averaging over the whole run.
+
+class ScriptProfile
+{
+    public:
+        // The upper edge of every bucket, in microseconds. The last is everything else.
+
+        static constexpr size_t BucketCount = 14;
+        static constexpr uint32_t BucketEdges[BucketCount - 1] = { 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000 };
+
+        static inline double WindowLength = 1;
+
+        // What the memory functions did during a single call. They count into
+        // whatever the thread they are called on points at, if anything.
+
+        struct FrameIO
+        {
+            uint64_t readCalls = 0;
+            uint64_t writeCalls = 0;
+            uint64_t readBytes = 0;
+            uint64_t writeBytes = 0;
+        };
+
+        static inline thread_local FrameIO* CurrentIO = nullptr;
+
+        static void CountRead(size_t InputSize)
+        {
+            if (CurrentIO != nullptr)
+            {
+                CurrentIO->readCalls++;
+                CurrentIO->readBytes += InputSize;
+            }
+        }
+
+        static void CountWrite(size_t InputSize)
+        {
+            if (CurrentIO != nullptr)
+            {
+                CurrentIO->writeCalls++;
+                CurrentIO->writeBytes += InputSize;
+            }
+        }
+
+        // Since the script was loaded. Times are in microseconds.
+
+        atomic<uint64_t> FrameCount = 0;
+        atomic<double> FrameTime = 0;
+
+        atomic<uint64_t> ReadCalls = 0;
+        atomic<uint64_t> WriteCalls = 0;
+        atomic<uint64_t> ReadBytes = 0;
+        atomic<uint64_t> WriteBytes = 0;
+
+        // The last full window. The percentiles are in microseconds,
+        // and the I/O is what a single call did on average.
+
+        atomic<uint64_t> WindowFrames = 0;
+        atomic<float> WindowMean = 0;
+        atomic<float> WindowMedian = 0;
+        atomic<float> WindowHigh = 0;
+        atomic<float> WindowMax = 0;
+
+        atomic<float> WindowReads = 0;
+        atomic<float> WindowWrites = 0;
+        atomic<float> WindowReadBytes = 0;
+        atomic<float> WindowWriteBytes = 0;
+
+        // A call which started at InputStart just ended at InputEnd.
+
+        void Record(chrono::steady_clock::time_point InputStart, chrono::steady_clock::time_point InputEnd, const FrameIO& InputIO)
+        {
+            auto _time = (float)chrono::duration<double, micro>(InputEnd - InputStart).count();
+
+            FrameCount.store(FrameCount.load(memory_order_relaxed) + 1, memory_order_relaxed);
+            FrameTime.store(FrameTime.load(memory_order_relaxed) + _time, memory_order_relaxed);
+
+            ReadCalls.store(ReadCalls.load(memory_order_relaxed) + InputIO.readCalls, memory_order_relaxed);
+            WriteCalls.store(WriteCalls.load(memory_order_relaxed) + InputIO.writeCalls, memory_order_relaxed);
+            ReadBytes.store(ReadBytes.load(memory_order_relaxed) + InputIO.readBytes, memory_order_relaxed);
+            WriteBytes.store(WriteBytes.load(memory_order_relaxed) + InputIO.writeBytes, memory_order_relaxed);
+
+            size_t _bucket = 0;
+
+            while (_bucket < BucketCount - 1 && _time > BucketEdges[_bucket])
+                _bucket++;
+
+            _bucketList[_bucket]++;
+            _windowTime += _time;
+            _windowMax = _time > _windowMax ? _time : _windowMax;
+            _windowIO.readCalls += InputIO.readCalls;
+            _windowIO.writeCalls += InputIO.writeCalls;
+            _windowIO.readBytes += InputIO.readBytes;
+            _windowIO.writeBytes += InputIO.writeBytes;
+
+            if (_windowStart == chrono::steady_clock::time_point())
+                _windowStart = InputStart;
+
+            if (InputEnd - _windowStart >= chrono::duration<double>(WindowLength))
+                Publish(InputEnd);
+        }
+
+        float MeanTime() const
+        {
+            auto _count = FrameCount.load();
+            return _count > 0 ? (float)(FrameTime / _count) : 0;
+        }
+
+    private:
+        uint64_t _bucketList[BucketCount] = { };
+        double _windowTime = 0;
+        float _windowMax = 0;
+        FrameIO _windowIO;
+
+        chrono::steady_clock::time_point _windowStart;
+
+        // The bucket edge below which InputRatio of the calls ended, but
+        // never more than the slowest one, so the last bucket has an edge too.
+
+        float WindowPercentile(double InputRatio) const
+        {
+            uint64_t _total = 0;
+
+            for (auto _bucket : _bucketList)
+                _total += _bucket;
+
+            uint64_t _sum = 0;
+
+            for (size_t i = 0; i < BucketCount - 1; i++)
+            {
+                _sum += _bucketList[i];
+
+                if (_sum >= _total * InputRatio)
+                    return BucketEdges[i] < _windowMax ? BucketEdges[i] : _windowMax;
+            }
+
+            return _windowMax;
+        }
+
+        void Publish(chrono::steady_clock::time_point InputTime)
+        {
+            uint64_t _count = 0;
+
+            for (auto _bucket : _bucketList)
+                _count += _bucket;
+
+            WindowMedian = WindowPercentile(0.5);
+            WindowHigh = WindowPercentile(0.95);
+            WindowMax = _windowMax;
+            WindowMean = (float)(_windowTime / _count);
+
+            WindowReads = (float)_windowIO.readCalls / _count;
+            WindowWrites = (float)_windowIO.writeCalls / _count;
+            WindowReadBytes = (float)_windowIO.readBytes / _count;
+            WindowWriteBytes = (float)_windowIO.writeBytes / _count;
+
+            WindowFrames = _count;
+
+            for (auto& _bucket : _bucketList)
+                _bucket = 0;
+
+            _windowTime = 0;
+            _windowMax = 0;
+            _windowIO = FrameIO();
+            _windowStart = InputTime;
+        }
+};
+
+#endif
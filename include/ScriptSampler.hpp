@@ -0,0 +1,347 @@
+#ifndef SCRIPTSAMPLER
+#define SCRIPTSAMPLER
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#include <lua.hpp>
+
+using namespace std;
+
+// Where a script spends its time, down to the line. Whenever the budget hook
+// fires, every 1000 Lua instructions, and at least SamplePeriod of the script's
+// own running time went by, the stack it is at gets the time since the last
+// sample. The stacks are merged into a trie as they come in, so it stays
+// small however long it runs.
+//
+// It can be turned on and off from any thread at any time, and written out
+// as collapsed stacks for flamegraph.pl and the likes, or for speedscope.
+
+class ScriptSampler
+{
+    public:
+        // How much running time a sample stands for, at least, in microseconds.
+        // And how deep a stack is followed, the outermost calls are dropped.
+
+        static inline uint32_t SamplePeriod = 250;
+        static inline int StackDepth = 64;
+
+        atomic<bool> Enabled = false;
+
+        void Enable(bool InputState)
+        {
+            _resetTick = true;
+            Enabled = InputState;
+        }
+
+        void Clear()
+        {
+            lock_guard<mutex> _lock(_sampleMutex);
+
+            _frameList.clear();
+            _frameIndex.clear();
+            _nodeList.clear();
+            _totalTime = 0;
+            _sampleCount = 0;
+        }
+
+        uint64_t SampleCount()
+        {
+            lock_guard<mutex> _lock(_sampleMutex);
+            return _sampleCount;
+        }
+
+        // Microseconds.
+
+        uint64_t TotalTime()
+        {
+            lock_guard<mutex> _lock(_sampleMutex);
+            return _totalTime;
+        }
+
+        // A call on the script's frame coroutine starts at InputTime.
+        // Whatever happened between its calls does not count.
+
+        void Begin(chrono::steady_clock::time_point InputTime)
+        {
+            _lastTick = InputTime;
+
+            if (_resetTick.exchange(false))
+                _pendingTime = 0;
+        }
+
+        // The hook fired on InputState at InputTime.
+
+        void Tick(lua_State* InputState, chrono::steady_clock::time_point InputTime)
+        {
+            // Just turned on? Start counting from here.
+
+            if (_resetTick)
+            {
+                Begin(InputTime);
+                return;
+            }
+
+            _pendingTime += chrono::duration<double, micro>(InputTime - _lastTick).count();
+            _lastTick = InputTime;
+
+            if (_pendingTime < SamplePeriod)
+                return;
+
+            auto _weight = (uint64_t)_pendingTime;
+            _pendingTime -= _weight;
+
+            // Innermost call first.
+
+            lua_Debug _debug;
+            _stackTemp.clear();
+
+            for (int i = 0; i < StackDepth && lua_getstack(InputState, i, &_debug); i++)
+            {
+                lua_getinfo(InputState, "Sln", &_debug);
+                _stackTemp.push_back(_debug);
+            }
+
+            lock_guard<mutex> _lock(_sampleMutex);
+
+            if (_nodeList.empty())
+                _nodeList.emplace_back();
+
+            uint32_t _node = 0;
+
+            for (auto _iter = _stackTemp.rbegin(); _iter != _stackTemp.rend(); _iter++)
+            {
+                auto _frame = FrameOf(*_iter);
+                auto _child = _nodeList[_node].childList.find(_frame);
+
+                if (_child == _nodeList[_node].childList.end())
+                {
+                    Node _new;
+
+                    _new.frame = _frame;
+                    _new.parent = _node;
+
+                    _nodeList.push_back(move(_new));
+                    _child = _nodeList[_node].childList.emplace(_frame, (uint32_t)_nodeList.size() - 1).first;
+                }
+
+                _node = _child->second;
+            }
+
+            _nodeList[_node].selfTime += _weight;
+            _totalTime += _weight;
+            _sampleCount++;
+        }
+
+        // One line per stack, outermost call first, and the microseconds spent
+        // right at the end of it. What flamegraph.pl and inferno take.
+
+        bool WriteCollapsed(const string& InputPath)
+        {
+            ofstream _file(InputPath, ios::binary);
+
+            if (!_file)
+                return false;
+
+            lock_guard<mutex> _lock(_sampleMutex);
+            vector<uint32_t> _stack;
+
+            for (uint32_t i = 1; i < _nodeList.size(); i++)
+            {
+                if (_nodeList[i].selfTime == 0)
+                    continue;
+
+                StackOf(i, _stack);
+
+                for (size_t s = 0; s < _stack.size(); s++)
+                {
+                    if (s > 0)
+                        _file << ';';
+
+                    _file << _frameList[_stack[s]].name << ' ' << _frameList[_stack[s]].file << ':' << _frameList[_stack[s]].line;
+                }
+
+                _file << ' ' << _nodeList[i].selfTime << '\n';
+            }
+
+            return (bool)_file;
+        }
+
+        // A sampled profile in speedscope's own format.
+
+        bool WriteSpeedscope(const string& InputPath, const string& InputName)
+        {
+            ofstream _file(InputPath, ios::binary);
+
+            if (!_file)
+                return false;
+
+            lock_guard<mutex> _lock(_sampleMutex);
+
+            _file << "{\"$schema\":\"https://www.speedscope.app/file-format-schema.json\",";
+            _file << "\"name\":\"" << Escape(InputName) << "\",\"exporter\":\"LuaFrontend\",\"shared\":{\"frames\":[";
+
+            for (size_t i = 0; i < _frameList.size(); i++)
+            {
+                auto& _frame = _frameList[i];
+
+                _file << (i > 0 ? "," : "") << "{\"name\":\"" << Escape(_frame.name) << "\",\"file\":\"" << Escape(_frame.file) << "\"";
+
+                if (_frame.line > 0)
+                    _file << ",\"line\":" << _frame.line;
+
+                _file << "}";
+            }
+
+            _file << "]},\"profiles\":[{\"type\":\"sampled\",\"name\":\"" << Escape(InputName) << "\",\"unit\":\"microseconds\",";
+            _file << "\"startValue\":0,\"endValue\":" << _totalTime << ",\"samples\":[";
+
+            vector<uint32_t> _stack;
+            string _weightList;
+
+            for (uint32_t i = 1; i < _nodeList.size(); i++)
+            {
+                if (_nodeList[i].selfTime == 0)
+                    continue;
+
+                StackOf(i, _stack);
+
+                if (!_weightList.empty())
+                {
+                    _file << ",";
+                    _weightList += ",";
+                }
+
+                _file << "[";
+
+                for (size_t s = 0; s < _stack.size(); s++)
+                    _file << (s > 0 ? "," : "") << _stack[s];
+
+                _file << "]";
+                _weightList += to_string(_nodeList[i].selfTime);
+            }
+
+            _file << "],\"weights\":[" << _weightList << "]}]}\n";
+
+            return (bool)_file;
+        }
+
+        // Speedscope if the path ends in .json, collapsed stacks otherwise.
+
+        bool Write(const string& InputPath, const string& InputName)
+        {
+            auto _json = InputPath.size() >= 5 && InputPath.compare(InputPath.size() - 5, 5, ".json") == 0;
+            return _json ? WriteSpeedscope(InputPath, InputName) : WriteCollapsed(InputPath);
+        }
+
+    private:
+        struct Frame
+        {
+            string name;
+            string file;
+            int line;
+        };
+
+        struct Node
+        {
+            uint32_t frame = 0;
+            uint32_t parent = 0;
+            uint64_t selfTime = 0;
+
+            unordered_map<uint32_t, uint32_t> childList;
+        };
+
+        // Only touched by whoever runs the script.
+
+        chrono::steady_clock::time_point _lastTick;
+        double _pendingTime = 0;
+        atomic<bool> _resetTick = true;
+        vector<lua_Debug> _stackTemp;
+
+        // Node zero is the root, and has no frame.
+
+        mutex _sampleMutex;
+        vector<Frame> _frameList;
+        unordered_map<string, uint32_t> _frameIndex;
+        vector<Node> _nodeList;
+        uint64_t _totalTime = 0;
+        uint64_t _sampleCount = 0;
+
+        uint32_t FrameOf(const lua_Debug& InputDebug)
+        {
+            auto _line = InputDebug.currentline;
+            string _name;
+
+            if (InputDebug.name != nullptr)
+                _name = InputDebug.name;
+            else if (InputDebug.what != nullptr && strcmp(InputDebug.what, "main") == 0)
+                _name = "(main)";
+            else
+                _name = "(anonymous)";
+
+            // The collapsed format splits on these.
+
+            string _file = InputDebug.short_src;
+
+            for (auto& _char : _name)
+                _char = _char == ';' || _char == ' ' ? '_' : _char;
+
+            for (auto& _char : _file)
+                _char = _char == ';' || _char == ' ' ? '_' : _char;
+
+            auto _key = _file + ':' + to_string(_line) + ':' + _name;
+            auto _find = _frameIndex.find(_key);
+
+            if (_find != _frameIndex.end())
+                return _find->second;
+
+            _frameList.push_back(Frame{ _name, _file, _line });
+            _frameIndex.emplace(_key, (uint32_t)_frameList.size() - 1);
+
+            return (uint32_t)_frameList.size() - 1;
+        }
+
+        // The frames from the root down to InputNode.
+
+        void StackOf(uint32_t InputNode, vector<uint32_t>& OutStack) const
+        {
+            OutStack.clear();
+
+            for (auto _node = InputNode; _node != 0; _node = _nodeList[_node].parent)
+                OutStack.insert(OutStack.begin(), _nodeList[_node].frame);
+        }
+
+        static string Escape(const string& InputString)
+        {
+            string _return;
+
+            for (auto _char : InputString)
+            {
+                if (_char == '"' || _char == '\\')
+                    _return += '\\';
+
+                if ((unsigned char)_char < 0x20)
+                {
+                    char _code[8];
+                    snprintf(_code, sizeof(_code), "\\u%04x", _char);
+
+                    _return += _code;
+                    continue;
+                }
+
+                _return += _char;
+            }
+
+            return _return;
+        }
+};
+
+#endif
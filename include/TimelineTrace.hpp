@@ -0,0 +1,307 @@
+#ifndef TIMELINETRACE
+#define TIMELINETRACE
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <fstream>
+#include <unordered_set>
+
+using namespace std;
+
+// A timeline of what every thread did and when: the ticks, every _OnFrame call,
+// the garbage collection, every read and write of the game's memory, and the
+// console. Written out as a Chrome trace, for chrome://tracing or Perfetto.
+//
+// Every thread records into a ring of its own, with no locks, and the oldest
+// spans make way for new ones once it's full. Each span is a single complete
+// event, so a ring which wrapped around never leaves a begin without an end.
+// While it's off, a span costs one relaxed load and a branch.
+
+class TimelineTrace
+{
+    public:
+        // How many spans every thread keeps, for the rings made after it's set.
+
+        static inline size_t Capacity = 32768;
+        static inline atomic<bool> Enabled = false;
+
+        // Strings which live as long as we do, for the names of
+        // things which may not, like scripts and threads.
+
+        static const char* Intern(const string& InputString)
+        {
+            static mutex _internMutex;
+            static unordered_set<string> _internSet;
+
+            lock_guard<mutex> _lock(_internMutex);
+            return _internSet.insert(InputString).first->c_str();
+        }
+
+        // What the calling thread shows up as. Must be interned, or a literal.
+
+        static void NameThread(const char* InputName)
+        {
+            _threadName = InputName;
+
+            if (_threadRing.ring != nullptr)
+                _threadRing.ring->name.store(InputName);
+        }
+
+        // Times the scope it's in. The names must be interned, or literals.
+
+        class Span
+        {
+            public:
+                Span(const char* InputName, const char* InputCategory, uint64_t InputArg = 0, const char* InputArgName = nullptr)
+                {
+                    if (!Enabled.load(memory_order_relaxed))
+                        return;
+
+                    _name = InputName;
+                    _category = InputCategory;
+                    _arg = InputArg;
+                    _argName = InputArgName;
+                    _start = Now();
+                }
+
+                ~Span()
+                {
+                    if (_name != nullptr)
+                        Record(_name, _category, _start, Now() - _start, _arg, _argName);
+                }
+
+                Span(const Span&) = delete;
+                Span& operator=(const Span&) = delete;
+
+            private:
+                const char* _name = nullptr;
+                const char* _category = nullptr;
+                const char* _argName = nullptr;
+                uint64_t _arg = 0;
+                uint64_t _start = 0;
+        };
+
+        // Nanoseconds since the first time anyone asked.
+
+        static uint64_t Now()
+        {
+            static const auto _epoch = chrono::steady_clock::now();
+            return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - _epoch).count();
+        }
+
+        static void Record(const char* InputName, const char* InputCategory, uint64_t InputStart, uint64_t InputDuration, uint64_t InputArg = 0, const char* InputArgName = nullptr)
+        {
+            auto _ring = _threadRing.ring.get();
+
+            if (_ring == nullptr)
+                _ring = Register();
+
+            auto _head = _ring->head.load(memory_order_relaxed);
+            auto& _entry = _ring->entryList[_head % _ring->entryList.size()];
+
+            _entry.name = InputName;
+            _entry.category = InputCategory;
+            _entry.argName = InputArgName;
+            _entry.arg = InputArg;
+            _entry.start = InputStart;
+            _entry.duration = InputDuration;
+
+            _ring->head.store(_head + 1, memory_order_release);
+        }
+
+        // Everything the rings hold right now, of the threads which
+        // are still around and the last few which are not.
+
+        static bool Write(const string& InputPath, size_t* OutCount = nullptr)
+        {
+            ofstream _file(InputPath, ios::binary);
+
+            if (!_file)
+                return false;
+
+            vector<shared_ptr<Ring>> _ringList;
+
+            {
+                lock_guard<mutex> _lock(RegistryMutex());
+                _ringList = RingList();
+            }
+
+            size_t _count = 0;
+            char _number[64];
+
+            _file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+            for (auto& _ring : _ringList)
+            {
+                _file << (_count > 0 ? "," : "") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << _ring->index << ",\"args\":{\"name\":\"";
+                _file << Escape(_ring->name.load()) << "\"}}";
+
+                _count++;
+
+                // A writer may go over the oldest entries while we copy them. Those
+                // which it may have got to by the time we are done are left out,
+                // and so is the one it may be writing into before it moves on.
+
+                auto _size = _ring->entryList.size();
+                auto _head = _ring->head.load(memory_order_acquire);
+                auto _first = _head > _size ? _head - _size : 0;
+
+                vector<Entry> _entryList;
+                _entryList.reserve(_head - _first);
+
+                for (auto i = _first; i < _head; i++)
+                    _entryList.push_back(_ring->entryList[i % _size]);
+
+                atomic_thread_fence(memory_order_acquire);
+
+                auto _after = _ring->head.load(memory_order_relaxed);
+                auto _valid = _after + 1 > _size ? _after + 1 - _size : 0;
+
+                for (auto i = _first; i < _head; i++)
+                {
+                    if (i < _valid)
+                        continue;
+
+                    auto& _entry = _entryList[i - _first];
+
+                    _file << ",{\"name\":\"" << Escape(_entry.name) << "\",\"cat\":\"" << Escape(_entry.category) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << _ring->index;
+
+                    snprintf(_number, sizeof(_number), ",\"ts\":%.3f,\"dur\":%.3f", _entry.start / 1000.0, _entry.duration / 1000.0);
+                    _file << _number;
+
+                    if (_entry.argName != nullptr)
+                        _file << ",\"args\":{\"" << Escape(_entry.argName) << "\":" << _entry.arg << "}";
+
+                    _file << "}";
+                    _count++;
+                }
+            }
+
+            _file << "]}\n";
+
+            if (OutCount != nullptr)
+                *OutCount = _count;
+
+            return (bool)_file;
+        }
+
+    private:
+        struct Entry
+        {
+            const char* name;
+            const char* category;
+            const char* argName;
+            uint64_t arg;
+            uint64_t start;
+            uint64_t duration;
+        };
+
+        struct Ring
+        {
+            vector<Entry> entryList;
+            atomic<uint64_t> head = 0;
+            atomic<const char*> name = nullptr;
+            atomic<bool> retired = false;
+            size_t index = 0;
+        };
+
+        // The ring of a thread outlives it, so what it did can still be written out.
+        // Only the last RetiredLimit of those are kept, so threads which come and
+        // go, like the ones of Multi-Threading on every reload, do not pile up.
+
+        static constexpr size_t RetiredLimit = 16;
+
+        struct ThreadRing
+        {
+            shared_ptr<Ring> ring;
+
+            ~ThreadRing()
+            {
+                if (ring != nullptr)
+                    ring->retired = true;
+            }
+        };
+
+        static inline thread_local ThreadRing _threadRing;
+        static inline thread_local const char* _threadName = nullptr;
+
+        static mutex& RegistryMutex()
+        {
+            static mutex _mutex;
+            return _mutex;
+        }
+
+        static vector<shared_ptr<Ring>>& RingList()
+        {
+            static vector<shared_ptr<Ring>> _list;
+            return _list;
+        }
+
+        static Ring* Register()
+        {
+            static size_t _ringCount = 0;
+
+            auto _ring = make_shared<Ring>();
+            _ring->entryList.resize(Capacity > 0 ? Capacity : 1);
+
+            lock_guard<mutex> _lock(RegistryMutex());
+            auto& _list = RingList();
+
+            _ring->index = ++_ringCount;
+            _ring->name = _threadName != nullptr ? _threadName : Intern("Thread " + to_string(_ring->index));
+
+            size_t _retiredCount = 0;
+
+            for (auto& _other : _list)
+                _retiredCount += _other->retired ? 1 : 0;
+
+            for (auto _iter = _list.begin(); _iter != _list.end() && _retiredCount >= RetiredLimit;)
+            {
+                if ((*_iter)->retired)
+                {
+                    _iter = _list.erase(_iter);
+                    _retiredCount--;
+                }
+
+                else
+                    _iter++;
+            }
+
+            _list.push_back(_ring);
+            _threadRing.ring = _ring;
+
+            return _ring.get();
+        }
+
+        static string Escape(const char* InputString)
+        {
+            string _return;
+
+            for (auto _char = InputString; _char != nullptr && *_char != 0; _char++)
+            {
+                if (*_char == '"' || *_char == '\\')
+                    _return += '\\';
+
+                if ((unsigned char)*_char < 0x20)
+                {
+                    char _code[8];
+                    snprintf(_code, sizeof(_code), "\\u%04x", *_char);
+
+                    _return += _code;
+                    continue;
+                }
+
+                _return += *_char;
+            }
+
+            return _return;
+        }
+};
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef TIMINGWHEEL
+#define TIMINGWHEEL
+
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+// A hashed timing wheel. Items are scheduled on an absolute tick, and
+// land in the slot "tick % SlotCount". Advancing the wheel only visits the
+// slots between the last tick and the current one, so items which are not
+// due are never looked at, no matter how many there are.
+
+template <typename T, size_t SlotCount = 256>
+class TimingWheel
+{
+    private:
+        struct Entry
+        {
+            uint64_t tick;
+            T item;
+        };
+
+        vector<Entry> _slotList[SlotCount];
+
+        uint64_t _currTick = 0;
+        size_t _itemCount = 0;
+
+    public:
+        uint64_t CurrentTick() const { return _currTick; }
+        size_t Size() const { return _itemCount; }
+
+        // Anything scheduled in the past is due on the next advance.
+
+        void Schedule(T InputItem, uint64_t InputTick)
+        {
+            if (InputTick <= _currTick)
+                InputTick = _currTick + 1;
+
+            _slotList[InputTick % SlotCount].push_back({ InputTick, InputItem });
+            _itemCount++;
+        }
+
+        void Advance(uint64_t InputTick, vector<T>& OutDue)
+        {
+            if (InputTick <= _currTick)
+                return;
+
+            // If we fell a whole turn behind, every slot is visited once.
+
+            auto _stepCount = InputTick - _currTick;
+
+            if (_stepCount > SlotCount)
+                _stepCount = SlotCount;
+
+            for (uint64_t i = 1; i <= _stepCount; i++)
+            {
+                auto& _slot = _slotList[(_currTick + i) % SlotCount];
+
+                for (size_t e = 0; e < _slot.size(); )
+                {
+                    if (_slot[e].tick <= InputTick)
+                    {
+                        OutDue.push_back(_slot[e].item);
+
+                        _slot[e] = _slot.back();
+                        _slot.pop_back();
+
+                        _itemCount--;
+                    }
+
+                    else
+                        e++;
+                }
+            }
+
+            _currTick = InputTick;
+        }
+
+        // Starts over from tick zero, for whoever starts counting time over.
+
+        void Clear()
+        {
+            for (auto& _slot : _slotList)
+                _slot.clear();
+
+            _currTick = 0;
+            _itemCount = 0;
+        }
+};
+
+#endif
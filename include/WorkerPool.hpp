@@ -0,0 +1,245 @@
+#ifndef WORKERPOOL
+#define WORKERPOOL
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+
+#include <TimelineTrace.hpp>
+
+using namespace std;
+
+// A fixed-size work-stealing pool, for running a batch of tasks and waiting
+// on all of them. Every task is queued on the worker its affinity points to,
+// so the same task keeps landing on the same worker batch after batch.
+// A worker which runs out of tasks steals from the back of the others.
+//
+// Tasks may also depend on each other. A task is only queued once every
+// task before it is done, by whichever worker finished the last of those.
+
+class WorkerPool
+{
+    private:
+        struct Worker
+        {
+            mutex queueLock;
+            deque<size_t> taskQueue;
+        };
+
+        size_t _workerCount;
+
+        unique_ptr<Worker[]> _workerList;
+        vector<thread> _threadList;
+
+        mutex _batchLock;
+        condition_variable _batchStart;
+        condition_variable _batchDone;
+
+        const function<size_t(size_t)>* _batchAffinity = nullptr;
+        const function<void(size_t)>* _batchTask = nullptr;
+        const vector<vector<size_t>>* _batchNext = nullptr;
+
+        unique_ptr<atomic<size_t>[]> _waitList;
+        size_t _waitSize = 0;
+
+        vector<size_t> _readyList;
+
+        uint64_t _readyID = 0;
+        atomic<size_t> _pendingCount = 0;
+        bool _stopping = false;
+
+        void PushTask(size_t InputTask)
+        {
+            auto& _worker = _workerList[(*_batchAffinity)(InputTask) % _workerCount];
+            lock_guard<mutex> _lock(_worker.queueLock);
+
+            _worker.taskQueue.push_back(InputTask);
+        }
+
+        // Wakes up the workers, as there is something new in the queues.
+
+        void SignalReady()
+        {
+            {
+                lock_guard<mutex> _lock(_batchLock);
+                _readyID++;
+            }
+
+            _batchStart.notify_all();
+        }
+
+        bool PopTask(size_t InputWorker, size_t& OutTask)
+        {
+            // Our own queue first, from the front...
+
+            {
+                auto& _worker = _workerList[InputWorker];
+                lock_guard<mutex> _lock(_worker.queueLock);
+
+                if (!_worker.taskQueue.empty())
+                {
+                    OutTask = _worker.taskQueue.front();
+                    _worker.taskQueue.pop_front();
+                    return true;
+                }
+            }
+
+            // ...then everyone else's, from the back.
+
+            for (size_t i = 1; i < _workerCount; i++)
+            {
+                auto& _victim = _workerList[(InputWorker + i) % _workerCount];
+                lock_guard<mutex> _lock(_victim.queueLock);
+
+                if (!_victim.taskQueue.empty())
+                {
+                    OutTask = _victim.taskQueue.back();
+                    _victim.taskQueue.pop_back();
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        void WorkerLoop(size_t InputWorker)
+        {
+            TimelineTrace::NameThread(TimelineTrace::Intern("Worker " + to_string(InputWorker)));
+
+            uint64_t _seenID = 0;
+
+            while (true)
+            {
+                {
+                    unique_lock<mutex> _lock(_batchLock);
+                    _batchStart.wait(_lock, [&] { return _stopping || _readyID != _seenID; });
+
+                    if (_stopping)
+                        return;
+
+                    _seenID = _readyID;
+                }
+
+                size_t _task = 0;
+
+                while (PopTask(InputWorker, _task))
+                {
+                    (*_batchTask)(_task);
+
+                    // Queue up whatever was only waiting on this task.
+
+                    if (_batchNext != nullptr)
+                    {
+                        bool _readyAny = false;
+
+                        for (auto _next : (*_batchNext)[_task])
+                        {
+                            if (--_waitList[_next] == 0)
+                            {
+                                PushTask(_next);
+                                _readyAny = true;
+                            }
+                        }
+
+                        if (_readyAny)
+                            SignalReady();
+                    }
+
+                    if (--_pendingCount == 0)
+                    {
+                        lock_guard<mutex> _lock(_batchLock);
+                        _batchDone.notify_all();
+                    }
+                }
+            }
+        }
+
+    public:
+        WorkerPool(size_t InputCount = 0)
+        {
+            _workerCount = InputCount != 0 ? InputCount : thread::hardware_concurrency();
+
+            if (_workerCount == 0)
+                _workerCount = 1;
+
+            _workerList.reset(new Worker[_workerCount]);
+
+            for (size_t i = 0; i < _workerCount; i++)
+                _threadList.emplace_back(&WorkerPool::WorkerLoop, this, i);
+        }
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        ~WorkerPool()
+        {
+            {
+                lock_guard<mutex> _lock(_batchLock);
+                _stopping = true;
+            }
+
+            _batchStart.notify_all();
+
+            for (auto& _thread : _threadList)
+                _thread.join();
+        }
+
+        size_t Size() const { return _workerCount; }
+
+        // Runs InputTask for every index below InputCount, and returns
+        // once all of them are done. InputAffinity picks the worker of each.
+        // If given, InputNext lists the tasks which have to wait on each task.
+
+        void Run(size_t InputCount, const function<size_t(size_t)>& InputAffinity, const function<void(size_t)>& InputTask,
+                 const vector<vector<size_t>>* InputNext = nullptr)
+        {
+            if (InputCount == 0)
+                return;
+
+            _batchAffinity = &InputAffinity;
+            _batchTask = &InputTask;
+            _batchNext = InputNext;
+
+            _pendingCount = InputCount;
+
+            if (InputNext != nullptr)
+            {
+                if (_waitSize < InputCount)
+                {
+                    _waitList.reset(new atomic<size_t>[InputCount]);
+                    _waitSize = InputCount;
+                }
+
+                for (size_t i = 0; i < InputCount; i++)
+                    _waitList[i] = 0;
+
+                for (size_t i = 0; i < InputCount; i++)
+                    for (auto _next : (*InputNext)[i])
+                        _waitList[_next]++;
+            }
+
+            // Pick the first tasks before queueing any of them. Once queued,
+            // they may already be done and counting down their followers.
+
+            _readyList.clear();
+
+            for (size_t i = 0; i < InputCount; i++)
+                if (InputNext == nullptr || _waitList[i] == 0)
+                    _readyList.push_back(i);
+
+            for (auto _task : _readyList)
+                PushTask(_task);
+
+            SignalReady();
+
+            unique_lock<mutex> _lock(_batchLock);
+            _batchDone.wait(_lock, [&] { return _pendingCount == 0; });
+        }
+};
+
+#endif